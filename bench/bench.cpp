@@ -0,0 +1,246 @@
+/**
+ * @file bench.cpp
+ * @author Fern Lane
+ * @brief Cycle-count benchmark firmware for ISRs and hot paths. Replaces main.cpp in uno_bench env
+ * Run it with bench/run.sh (under simavr) and compare results with bench/baseline.tsv
+ *
+ * Cycles are counted with Timer 1 running without prescaler. ISR latency is measured by arming Timer 1 compare B
+ * interrupt at different points inside the benchmarked function and reading how late it actually started
+ *
+ * @copyright Copyright (c) 2024 Fern Lane
+ *
+ * This file is part of the in17clock distribution.
+ * See <https://github.com/F33RNI/in17clock> for more info.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * long with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <avr/sleep.h>
+
+#include "../include/hal.h"
+
+#include "../include/config.h"
+#include "../include/decimal.h"
+#include "../include/pins.h"
+
+#include "../include/buttons.h"
+#include "../include/buzzer.h"
+#include "../include/digits.h"
+#include "../include/power.h"
+#include "../include/temp_humid.h"
+
+#define BENCH_SERIAL     Serial
+#define BENCH_BAUD_RATE  115200UL
+#define BENCH_ITERATIONS 64U
+
+// Latency probe is armed this many cycles after the start of the function plus (iteration * step)
+#define _PROBE_OFFSET 16U
+#define _PROBE_STEP   97U
+
+// Multiplexing, dimming and core's millis() interrupts (masked while counting cycles)
+#define _TIMER_0_INTERRUPTS (_BV(OCIE0A) | _BV(OCIE0B) | _BV(TOIE0))
+
+typedef void (*BenchFunction)(void);
+
+static volatile uint16_t probe_latency;
+static volatile boolean probe_fired;
+
+static void bench_digits_isr(void) { Digits::_isr_callback(); }
+
+static void bench_buttons_pcint(void) { Buttons::_isr(hal.pin_change_group(PIN_BTN_UP)); }
+
+static void bench_power_regulate(void) { power.regulate(); }
+
+static void bench_temp_humid_read(void) { temp_humid.read(); }
+
+static void bench_buzzer_note_change(void) {
+    static uint8_t note = 60U;
+    note = note == 60U ? 61U : 60U;
+    buzzer.play_note(note, BUZZER_PWM_START);
+}
+
+static void bench_buzzer_note_same(void) { buzzer.play_note(60U, BUZZER_PWM_START); }
+
+// Decimal decomposition of a changing value (volatile, so it's not folded) with libgcc division and with decimal.h
+static volatile uint8_t decimal_value_8, decimal_digits[5];
+static volatile uint16_t decimal_value_16;
+
+static void bench_decimal_8_divide(void) {
+    uint8_t value = decimal_value_8++;
+    decimal_digits[0] = value / 100U;
+    decimal_digits[1] = value / 10U % 10U;
+    decimal_digits[2] = value % 10U;
+}
+
+static void bench_decimal_8_reciprocal(void) {
+    uint8_t digits[3];
+    decimal_split(decimal_value_8++, digits);
+    for (uint8_t i = 0; i < 3U; ++i)
+        decimal_digits[i] = digits[i];
+}
+
+static void bench_decimal_16_divide(void) {
+    uint16_t value = decimal_value_16;
+    decimal_value_16 += 257U;
+    for (uint8_t i = 4U; i > 0U; --i) {
+        decimal_digits[i] = value % 10U;
+        value /= 10U;
+    }
+    decimal_digits[0] = value;
+}
+
+static void bench_decimal_16_reciprocal(void) {
+    uint8_t digits[5];
+    decimal_split_16(decimal_value_16, digits);
+    decimal_value_16 += 257U;
+    for (uint8_t i = 0; i < 5U; ++i)
+        decimal_digits[i] = digits[i];
+}
+
+/**
+ * @brief Runs function BENCH_ITERATIONS times without Timer 0 interrupts and then with all interrupts and latency
+ * probe and prints one result line:
+ * bench <name> <iterations> <min> <avg> <max> <latency min> <latency max> (all in CPU cycles)
+ * max is 65535 if any call took longer than Timer 1 period
+ *
+ * @param name scenario name
+ * @param function function to benchmark
+ * @param delay_ms delay between calls (outside of measurement) for functions with internal timers
+ */
+static void bench_run(const __FlashStringHelper *name, BenchFunction function, uint8_t delay_ms) {
+    uint16_t cycles_min = 0xFFFFU, cycles_max = 0;
+    uint32_t cycles_sum = 0;
+
+    // Without Timer 0 interrupts. They are masked only around the call, so hal.delay() keeps working and pending
+    // overflow is handled right after it (dimming is never enabled here, because brightness is 255)
+    for (uint8_t i = 0; i < BENCH_ITERATIONS; ++i) {
+        if (delay_ms)
+            hal.delay(delay_ms);
+        uint16_t cycles;
+        uint8_t timsk0 = TIMSK0;
+        ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+            TIMSK0 = timsk0 & ~_TIMER_0_INTERRUPTS;
+            TCNT1 = 0;
+            TIFR1 = _BV(TOV1);
+        }
+        function();
+        cycles = TCNT1;
+        TIMSK0 = (TIMSK0 & ~_TIMER_0_INTERRUPTS) | (timsk0 & _TIMER_0_INTERRUPTS);
+        if (TIFR1 & _BV(TOV1))
+            cycles = 0xFFFFU;
+        if (cycles < cycles_min)
+            cycles_min = cycles;
+        if (cycles > cycles_max)
+            cycles_max = cycles;
+        cycles_sum += cycles;
+    }
+
+    // With all interrupts and probe armed at different points inside the function
+    uint16_t latency_min = 0xFFFFU, latency_max = 0;
+    for (uint8_t i = 0; i < BENCH_ITERATIONS; ++i) {
+        if (delay_ms)
+            hal.delay(delay_ms);
+        uint16_t span = cycles_min > _PROBE_OFFSET ? cycles_min : 1U;
+        uint16_t offset = _PROBE_OFFSET + (uint16_t) ((i * _PROBE_STEP) % span);
+        ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+            probe_fired = false;
+            TCNT1 = 0;
+            OCR1B = offset;
+            TIFR1 = _BV(OCF1B);
+            TIMSK1 |= _BV(OCIE1B);
+        }
+        function();
+
+        // Probe could be armed after the end of a short function
+        while (!probe_fired && TCNT1 < offset + 1024U)
+            ;
+        TIMSK1 &= ~_BV(OCIE1B);
+        if (!probe_fired)
+            continue;
+        if (probe_latency < latency_min)
+            latency_min = probe_latency;
+        if (probe_latency > latency_max)
+            latency_max = probe_latency;
+    }
+
+    BENCH_SERIAL.print(F("bench\t"));
+    BENCH_SERIAL.print(name);
+    BENCH_SERIAL.print('\t');
+    BENCH_SERIAL.print(BENCH_ITERATIONS);
+    BENCH_SERIAL.print('\t');
+    BENCH_SERIAL.print(cycles_min);
+    BENCH_SERIAL.print('\t');
+    BENCH_SERIAL.print(cycles_sum / BENCH_ITERATIONS);
+    BENCH_SERIAL.print('\t');
+    BENCH_SERIAL.print(cycles_max);
+    BENCH_SERIAL.print('\t');
+    BENCH_SERIAL.print(latency_min);
+    BENCH_SERIAL.print('\t');
+    BENCH_SERIAL.println(latency_max);
+    BENCH_SERIAL.flush();
+}
+
+void setup() {
+    BENCH_SERIAL.begin(BENCH_BAUD_RATE);
+
+    power.init();
+    digits.init();
+    temp_humid.init();
+    buzzer.init();
+    buttons.init();
+    power.set_voltage(CONVERTER_SETPOINT_MIN);
+    digits.set(1U, 2U, 3U, 4U);
+
+    // Reuse Timer 1 as free-running cycle counter (normal mode, no prescaler, PWM pin disconnected)
+    TCCR1A = 0;
+    TCCR1B = _BV(CS10);
+    TIMSK1 = 0;
+
+    bench_run(F("digits_isr"), bench_digits_isr, 0U);
+    bench_run(F("buttons_pcint"), bench_buttons_pcint, 0U);
+    bench_run(F("power_regulate"), bench_power_regulate, 0U);
+    bench_run(F("temp_humid_read"), bench_temp_humid_read, READ_INTERVAL);
+    bench_run(F("buzzer_note_change"), bench_buzzer_note_change, 0U);
+    bench_run(F("buzzer_note_same"), bench_buzzer_note_same, 0U);
+    bench_run(F("decimal_8_divide"), bench_decimal_8_divide, 0U);
+    bench_run(F("decimal_8_reciprocal"), bench_decimal_8_reciprocal, 0U);
+    bench_run(F("decimal_16_divide"), bench_decimal_16_divide, 0U);
+    bench_run(F("decimal_16_reciprocal"), bench_decimal_16_reciprocal, 0U);
+
+    // Deepest stack usage of all scenarios above (including nested interrupts)
+    BENCH_SERIAL.print(F("memory\t"));
+    BENCH_SERIAL.print(hal.memory_static());
+    BENCH_SERIAL.print('\t');
+    BENCH_SERIAL.print(hal.memory_heap());
+    BENCH_SERIAL.print('\t');
+    BENCH_SERIAL.println(hal.memory_stack_free_min());
+
+    // Sleeping with interrupts disabled stops simavr
+    BENCH_SERIAL.println(F("bench\tdone"));
+    BENCH_SERIAL.flush();
+    cli();
+    set_sleep_mode(SLEEP_MODE_PWR_DOWN);
+    sleep_enable();
+    sleep_cpu();
+}
+
+void loop() {}
+
+/**
+ * @brief Latency probe. TCNT1 - OCR1B is the number of cycles between compare match and this line
+ */
+ISR(TIMER1_COMPB_vect) {
+    probe_latency = TCNT1 - OCR1B;
+    probe_fired = true;
+}
@@ -0,0 +1,83 @@
+#!/usr/bin/env bash
+#
+# Builds firmware and benchmark firmware with every build profile (see platformio.ini) and prints a table of flash and
+# SRAM usage versus worst-case CPU cycles of each benchmark scenario
+#
+# Usage: bench/matrix.sh [profile...]
+#   profile  default, nolto, o2, call_prologues or relax (all of them if not specified)
+#
+# Requires PlatformIO (pio) and simavr in PATH. Profile envs only report footprint (don't enforce budgets), so the
+# table shows how far each profile is from them
+#
+# Copyright (c) 2024 Fern Lane
+#
+# This file is part of the in17clock distribution.
+# See <https://github.com/F33RNI/in17clock> for more info.
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU Affero General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU Affero General Public License for more details.
+#
+# You should have received a copy of the GNU Affero General Public License
+# long with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+set -euo pipefail
+
+BENCH_DIR="$(cd "$(dirname "${BASH_SOURCE[0]}")" && pwd)"
+PROJECT_DIR="$(dirname "$BENCH_DIR")"
+PROFILES=("$@")
+if ((${#PROFILES[@]} == 0)); then
+    PROFILES=(default nolto o2 call_prologues relax)
+fi
+
+# Env name of the profile: env_name <uno|uno_bench> <profile>
+env_name() {
+    if [[ "$2" == "default" ]]; then
+        echo "$1"
+    else
+        echo "$1_$2"
+    fi
+}
+
+declare -A table
+scenarios=()
+for profile in "${PROFILES[@]}"; do
+    # "total" row of scripts/footprint.py report: total code progmem data bss flash/budget sram/budget
+    read -r _ _ _ _ _ flash sram < <(pio run -d "$PROJECT_DIR" -e "$(env_name uno "$profile")" | grep '^total ')
+    table["$profile,flash"]="${flash%%/*}"
+    table["$profile,sram"]="${sram%%/*}"
+
+    env="$(env_name uno_bench "$profile")"
+    pio run -d "$PROJECT_DIR" -e "$env" >/dev/null
+    output="$(timeout 120 simavr -m atmega328p -f 16000000 "$PROJECT_DIR/.pio/build/$env/firmware.elf" 2>&1 |
+        sed -e 's/\x1b\[[0-9;]*m//g' | tr -d '\r' || true)"
+    if ! grep -q 'bench	done' <<<"$output"; then
+        echo "Benchmark of $profile profile didn't finish" >&2
+        exit 1
+    fi
+
+    # bench <name> <iterations> <min> <avg> <max> <latency_min> <latency_max>
+    while IFS=$'\t' read -r _ name _ _ _ max _; do
+        [[ "$name" == "done" ]] && continue
+        [[ " ${scenarios[*]} " == *" $name "* ]] || scenarios+=("$name")
+        table["$profile,$name"]="$max"
+    done < <(grep -o 'bench	.*' <<<"$output")
+done
+
+# Rows are flash, SRAM and max cycles of each scenario, columns are profiles
+printf '%-28s' "profile"
+printf '%16s' "${PROFILES[@]}"
+printf '\n'
+for row in flash sram "${scenarios[@]}"; do
+    printf '%-28s' "$row"
+    for profile in "${PROFILES[@]}"; do
+        printf '%16s' "${table[$profile,$row]:--}"
+    done
+    printf '\n'
+done
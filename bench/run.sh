@@ -0,0 +1,71 @@
+#!/usr/bin/env bash
+#
+# Builds benchmark firmware (uno_bench env), runs it under simavr and compares results with the baseline
+#
+# Usage: bench/run.sh [--update]
+#   --update  overwrite bench/baseline.tsv with the current results
+#
+# Requires PlatformIO (pio) and simavr in PATH. Exits with 1 if results differ from the baseline, if there is no
+# baseline (without --update) or if minimal free stack is less than STACK_HEADROOM_MIN bytes (environment variable,
+# 256 by default)
+#
+# Copyright (c) 2024 Fern Lane
+#
+# This file is part of the in17clock distribution.
+# See <https://github.com/F33RNI/in17clock> for more info.
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU Affero General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU Affero General Public License for more details.
+#
+# You should have received a copy of the GNU Affero General Public License
+# long with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+set -euo pipefail
+
+BENCH_DIR="$(cd "$(dirname "${BASH_SOURCE[0]}")" && pwd)"
+PROJECT_DIR="$(dirname "$BENCH_DIR")"
+BASELINE="$BENCH_DIR/baseline.tsv"
+STACK_HEADROOM_MIN="${STACK_HEADROOM_MIN:-256}"
+ELF="$PROJECT_DIR/.pio/build/uno_bench/firmware.elf"
+HEADER="# name	iterations	min	avg	max	latency_min	latency_max"
+
+pio run -d "$PROJECT_DIR" -e uno_bench
+
+# simavr prints UART output to stdout (possibly with color codes) and exits when MCU sleeps with interrupts disabled
+output="$(timeout 120 simavr -m atmega328p -f 16000000 "$ELF" 2>&1 | sed -e 's/\x1b\[[0-9;]*m//g' | tr -d '\r' || true)"
+results="$(grep -o 'bench	.*' <<<"$output" || true)"
+
+if ! grep -q '^bench	done$' <<<"$results"; then
+    echo "Benchmark didn't finish" >&2
+    echo "$results" >&2
+    exit 1
+fi
+current="$(printf '%s\n' "$HEADER"; grep -v '^bench	done$' <<<"$results" | cut -f 2-)"
+echo "$current"
+
+# memory <static> <heap> <stack free min>
+read -r _ static heap stack_free_min < <(grep -o 'memory	.*' <<<"$output" || echo "memory 0 0 0")
+echo "SRAM: static $static, heap $heap, minimal free stack $stack_free_min (at least $STACK_HEADROOM_MIN required)"
+if ((stack_free_min < STACK_HEADROOM_MIN)); then
+    echo "Not enough stack headroom" >&2
+    exit 1
+fi
+
+if [[ "${1:-}" == "--update" ]]; then
+    echo "$current" >"$BASELINE"
+    echo "Baseline saved into $BASELINE"
+    exit 0
+fi
+if [[ ! -f "$BASELINE" ]]; then
+    echo "No baseline in $BASELINE (run with --update to save the current results)" >&2
+    exit 1
+fi
+
+diff -u --label baseline --label current "$BASELINE" <(echo "$current")
@@ -25,6 +25,11 @@
 #include "include/buttons.h"
 
 #include "include/pins.h"
+#include "include/recorder.h"
+
+// Pins of BUTTON_UP, BUTTON_DOWN, ... (index = bit)
+const uint8_t BUTTONS_PINS[BUTTONS_NUM] PROGMEM = {PIN_BTN_UP, PIN_BTN_DOWN, PIN_BTN_WEATHER, PIN_BTN_SET,
+                                                   PIN_SW_ALARM};
 
 // Preinstantiate
 Buttons buttons;
@@ -34,83 +39,78 @@ Buttons buttons;
  */
 void Buttons::init(void) {
     // Setup all pins with pullup resistors enabled
-    pinMode(PIN_BTN_UP, INPUT_PULLUP);
-    pinMode(PIN_BTN_DOWN, INPUT_PULLUP);
-    pinMode(PIN_BTN_WEATHER, INPUT_PULLUP);
-    pinMode(PIN_BTN_SET, INPUT_PULLUP);
-    pinMode(PIN_SW_ALARM, INPUT_PULLUP);
-
-    // Convert pins into input registers and masks for faster access
-    btn_up_pin_mask = digitalPinToBitMask(PIN_BTN_UP);
-    btn_up_port = portInputRegister(digitalPinToPort(PIN_BTN_UP));
-    btn_down_pin_mask = digitalPinToBitMask(PIN_BTN_DOWN);
-    btn_down_port = portInputRegister(digitalPinToPort(PIN_BTN_DOWN));
-    btn_weather_pin_mask = digitalPinToBitMask(PIN_BTN_WEATHER);
-    btn_weather_port = portInputRegister(digitalPinToPort(PIN_BTN_WEATHER));
-    btn_set_pin_mask = digitalPinToBitMask(PIN_BTN_SET);
-    btn_set_port = portInputRegister(digitalPinToPort(PIN_BTN_SET));
-    sw_alarm_pin_mask = digitalPinToBitMask(PIN_SW_ALARM);
-    sw_alarm_port = portInputRegister(digitalPinToPort(PIN_SW_ALARM));
+    for (uint8_t button = 0; button < BUTTONS_NUM; ++button)
+        hal.pin_input_pullup(pgm_read_byte(&BUTTONS_PINS[button]));
 
     // Read all buttons at startup (because PCINT only fires on change)
     read(255U);
 
     // Enable interrupts on all pins
-    *digitalPinToPCMSK(PIN_BTN_UP) |= (1 << digitalPinToPCMSKbit(PIN_BTN_UP));
-    *digitalPinToPCICR(PIN_BTN_UP) |= (1 << digitalPinToPCICRbit(PIN_BTN_UP));
-    *digitalPinToPCMSK(PIN_BTN_DOWN) |= (1 << digitalPinToPCMSKbit(PIN_BTN_DOWN));
-    *digitalPinToPCICR(PIN_BTN_DOWN) |= (1 << digitalPinToPCICRbit(PIN_BTN_DOWN));
-    *digitalPinToPCMSK(PIN_BTN_WEATHER) |= (1 << digitalPinToPCMSKbit(PIN_BTN_WEATHER));
-    *digitalPinToPCICR(PIN_BTN_WEATHER) |= (1 << digitalPinToPCICRbit(PIN_BTN_WEATHER));
-    *digitalPinToPCMSK(PIN_BTN_SET) |= (1 << digitalPinToPCMSKbit(PIN_BTN_SET));
-    *digitalPinToPCICR(PIN_BTN_SET) |= (1 << digitalPinToPCICRbit(PIN_BTN_SET));
-    *digitalPinToPCMSK(PIN_SW_ALARM) |= (1 << digitalPinToPCMSKbit(PIN_SW_ALARM));
-    *digitalPinToPCICR(PIN_SW_ALARM) |= (1 << digitalPinToPCICRbit(PIN_SW_ALARM));
+    for (uint8_t button = 0; button < BUTTONS_NUM; ++button)
+        hal.pin_change_attach(pgm_read_byte(&BUTTONS_PINS[button]), _isr);
 }
 
 /**
  * @return boolean true if UP button is pressed
  */
-boolean Buttons::get_up(void) {
-    boolean up_;
-    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) { up_ = up; }
-    DEBOUNCING_RETURN(up_, up_state, up_last)
-}
+boolean Buttons::get_up(void) { return debounce(BUTTON_UP); }
 
 /**
  * @return boolean true if DOWN button is pressed
  */
-boolean Buttons::get_down(void) {
-    boolean down_;
-    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) { down_ = down; }
-    DEBOUNCING_RETURN(down_, down_state, down_last)
-}
+boolean Buttons::get_down(void) { return debounce(BUTTON_DOWN); }
 
 /**
  * @return boolean true if WEATHER button is pressed
  */
-boolean Buttons::get_weather(void) {
-    boolean weather_;
-    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) { weather_ = weather; }
-    DEBOUNCING_RETURN(weather_, weather_state, weather_last)
-}
+boolean Buttons::get_weather(void) { return debounce(BUTTON_WEATHER); }
 
 /**
  * @return boolean true if SET button is pressed
  */
-boolean Buttons::get_set(void) {
-    boolean set_;
-    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) { set_ = set; }
-    DEBOUNCING_RETURN(set_, set_state, set_last)
-}
+boolean Buttons::get_set(void) { return debounce(BUTTON_SET); }
 
 /**
  * @return boolean true if alarm switch is ON
  */
-boolean Buttons::get_alarm(void) {
-    boolean alarm_;
-    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) { alarm_ = alarm; }
-    DEBOUNCING_RETURN(alarm_, alarm_state, alarm_last)
+boolean Buttons::get_alarm(void) { return debounce(BUTTON_ALARM); }
+
+/**
+ * @return boolean true if any button (not the alarm switch) is pressed right now (without debouncing)
+ */
+boolean Buttons::get_any(void) { return pressed & ~_BV(BUTTON_ALARM); }
+
+/**
+ * @return boolean debounced state of the alarm switch (without shifting its history, unlike get_alarm())
+ */
+boolean Buttons::is_alarm_on(void) { return debounced & _BV(BUTTON_ALARM); }
+
+/**
+ * @brief Makes currently pressed buttons (not the alarm switch) read as released until they are actually released
+ * (ex. so the press that wakes the display doesn't do anything else)
+ */
+void Buttons::suppress(void) { suppressed |= pressed & ~_BV(BUTTON_ALARM); }
+
+/**
+ * @brief Shifts current state into the button's history. State changes only after 16 equal states in a row
+ *
+ * @param button BUTTON_UP, BUTTON_DOWN, ...
+ * @return boolean debounced state
+ */
+boolean Buttons::debounce(uint8_t button) {
+    uint8_t mask = _BV(button);
+
+    // Single byte is read atomically
+    history[button] = (history[button] << 1U) | ((pressed & mask) ? 1U : 0U);
+    if (history[button] == 0xFFFFU ? !(debounced & mask) : !history[button] && (debounced & mask)) {
+        debounced ^= mask;
+        RECORD_BUTTON(button, (debounced & mask) != 0);
+    }
+
+    // Suppressed button is released (both raw and debounced state)
+    if (!(debounced & mask) && !(pressed & mask))
+        suppressed &= ~mask;
+    return (debounced & ~suppressed) & mask;
 }
 
 /**
@@ -119,16 +119,17 @@ boolean Buttons::get_alarm(void) {
  * @param pcicr_bit index of fired PCINT vector to prevent multiple reads of the same pin or 255 to read all
  */
 void Buttons::read(uint8_t pcicr_bit) {
-    if (pcicr_bit == digitalPinToPCICRbit(PIN_BTN_UP) || pcicr_bit == 255U)
-        up = !(*btn_up_port & btn_up_pin_mask);
-    if (pcicr_bit == digitalPinToPCICRbit(PIN_BTN_DOWN) || pcicr_bit == 255U)
-        down = !(*btn_down_port & btn_down_pin_mask);
-    if (pcicr_bit == digitalPinToPCICRbit(PIN_BTN_WEATHER) || pcicr_bit == 255U)
-        weather = !(*btn_weather_port & btn_weather_pin_mask);
-    if (pcicr_bit == digitalPinToPCICRbit(PIN_BTN_SET) || pcicr_bit == 255U)
-        set = !(*btn_set_port & btn_set_pin_mask);
-    if (pcicr_bit == digitalPinToPCICRbit(PIN_SW_ALARM) || pcicr_bit == 255U)
-        alarm = !(*sw_alarm_port & sw_alarm_pin_mask);
+    uint8_t pressed_ = pressed;
+    for (uint8_t button = 0; button < BUTTONS_NUM; ++button) {
+        uint8_t pin = pgm_read_byte(&BUTTONS_PINS[button]);
+        if (pcicr_bit != hal.pin_change_group(pin) && pcicr_bit != 255U)
+            continue;
+        if (hal.pin_read(pin))
+            pressed_ &= ~_BV(button);
+        else
+            pressed_ |= _BV(button);
+    }
+    pressed = pressed_;
 }
 
 /**
@@ -137,28 +138,3 @@ void Buttons::read(uint8_t pcicr_bit) {
  * @param pcicr_bit index of fired PCINT vector to prevent multiple reads of the same pin
  */
 void Buttons::_isr(uint8_t pcicr_bit) { buttons.read(pcicr_bit); }
-
-#ifdef PCINT0_vect
-ISR(PCINT0_vect) { buttons._isr(0U); }
-#endif
-#ifdef PCINT1_vect
-ISR(PCINT1_vect) { buttons._isr(1U); }
-#endif
-#ifdef PCINT2_vect
-ISR(PCINT2_vect) { buttons._isr(2U); }
-#endif
-#ifdef PCINT3_vect
-ISR(PCINT3_vect) { buttons._isr(3U); }
-#endif
-#ifdef PCINT4_vect
-ISR(PCINT4_vect) { buttons._isr(4U); }
-#endif
-#ifdef PCINT5_vect
-ISR(PCINT5_vect) { buttons._isr(5U); }
-#endif
-#ifdef PCINT6_vect
-ISR(PCINT6_vect) { buttons._isr(6U); }
-#endif
-#ifdef PCINT7_vect
-ISR(PCINT7_vect) { buttons._isr(7U); }
-#endif
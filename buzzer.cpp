@@ -26,30 +26,18 @@
 
 #include "include/config.h"
 #include "include/pins.h"
+#include "include/settings.h"
 
 // Preinstantiate
 Buzzer buzzer;
 
 void Buzzer::init(void) {
-
-    // Mode 5 "PWM phase correct", OCRA as top counter value
-    // See "17.11.1" in Atmega328P datasheet for more info
-    TCCR2A = _BV(WGM20);
-    TCCR2B = _BV(WGM22);
+    // Mode 5 "PWM phase correct" on pin 3
+    hal.buzzer_pwm_init();
 
     // Set prescaler and TOP counter
     set_frequency(1000.f);
 
-    // Enable PWM
-    // See "Table 17-4. Compare Output Mode, Phase Correct PWM Mode" for more info
-    pinMode(_TIMER_2_B_PIN, OUTPUT);
-    TCCR2A |= _BV(COM2B1);
-
-    // Enable inverted mode if needed
-#ifdef BUZZER_PWM_INVERTED
-    TCCR2A |= _BV(COM2B0);
-#endif
-
     // Turn buzzer OFF
     set_duty_cycle(0);
 }
@@ -68,21 +56,18 @@ void Buzzer::play_note(uint8_t note_number, uint8_t pwm) {
     }
     attack_pwm_value = note_number != 0 ? pwm : 0U;
     set_duty_cycle(attack_pwm_value);
-    decay_timer = millis();
+    decay_timer = hal.millis();
 }
 
 void Buzzer::play_chime(void) {
-    uint64_t millis_current = millis();
-    if (chime_timer > millis_current)
-        chime_timer = millis_current;
+    uint32_t millis_current = hal.millis();
 
     // New note
     if (millis_current - chime_timer >= chime_note_duration) {
         chime_timer = millis_current;
 
-        // Select random velocity
-        attack_pwm_value =
-            BUZZER_PWM_START + ((int16_t) (random() % BUZZER_PWM_DEVIATION * 2) - ((int16_t) BUZZER_PWM_DEVIATION / 2));
+        // Select random velocity (BUZZER_PWM_START +/- BUZZER_PWM_DEVIATION)
+        attack_pwm_value = BUZZER_PWM_START - BUZZER_PWM_DEVIATION + random() % (BUZZER_PWM_DEVIATION * 2U + 1U);
 
         // Select random note
         play_note(pgm_read_byte(&ALARM_CHIME_NOTES[random() % ALARM_CHIME_NOTES_N]), attack_pwm_value);
@@ -105,19 +90,18 @@ void Buzzer::play_chime(void) {
  * NOTE: Must be called in a main loop without any delays (has internal timer)
  */
 void Buzzer::decay(void) {
-    uint64_t millis_current = millis();
-    if (decay_timer > millis_current)
-        decay_timer = millis_current;
+    uint32_t millis_current = hal.millis();
+    uint16_t decay_time = CONFIG(DECAY_TIME);
 
     // Fully decayed
-    if (decay_timer != 0 && millis_current - decay_timer >= DECAY_TIME) {
+    if (decay_timer != 0 && millis_current - decay_timer >= decay_time) {
         decay_timer = 0;
         set_duty_cycle(0);
     }
 
     // Decaying
-    else if (millis_current - decay_timer < DECAY_TIME) {
-        uint8_t duty_cycle = map(millis_current - decay_timer, 0UL, DECAY_TIME, attack_pwm_value, 0UL);
+    else if (millis_current - decay_timer < decay_time) {
+        uint8_t duty_cycle = map(millis_current - decay_timer, 0UL, decay_time, attack_pwm_value, 0UL);
         set_duty_cycle(duty_cycle);
     }
 }
@@ -132,24 +116,25 @@ void Buzzer::set_frequency(float frequency) {
     uint32_t cycles = (F_CPU / 2000000UL) * (1.e6f / frequency);
 
     // Calculate prescaler
+    uint8_t prescaler_bits = HAL_TIMER_2_PRESCALER_1024;
     if (cycles < _RESOLUTION)
-        prescaler_bits = _PRESCALER_1;
+        prescaler_bits = HAL_TIMER_2_PRESCALER_1;
     else if ((cycles >>= 3U) < _RESOLUTION)
-        prescaler_bits = _PRESCALER_8;
+        prescaler_bits = HAL_TIMER_2_PRESCALER_8;
     else if ((cycles >>= 2U) < _RESOLUTION)
-        prescaler_bits = _PRESCALER_32;
+        prescaler_bits = HAL_TIMER_2_PRESCALER_32;
     else if ((cycles >>= 1U) < _RESOLUTION)
-        prescaler_bits = _PRESCALER_64;
+        prescaler_bits = HAL_TIMER_2_PRESCALER_64;
     else if ((cycles >>= 1U) < _RESOLUTION)
-        prescaler_bits = _PRESCALER_128;
+        prescaler_bits = HAL_TIMER_2_PRESCALER_128;
     else if ((cycles >>= 1U) < _RESOLUTION)
-        prescaler_bits = _PRESCALER_256;
+        prescaler_bits = HAL_TIMER_2_PRESCALER_256;
     else if ((cycles >>= 2U) < _RESOLUTION)
-        prescaler_bits = _PRESCALER_1024;
+        prescaler_bits = HAL_TIMER_2_PRESCALER_1024;
 
     // Set prescaler and TOP counter
-    TCCR2B = _BV(WGM22) | prescaler_bits;
-    OCR2A = cycles;
+    top = cycles;
+    hal.buzzer_pwm_frequency(prescaler_bits, top);
 }
 
 /**
@@ -157,4 +142,4 @@ void Buzzer::set_frequency(float frequency) {
  *
  * @param duty_cycle 0 to 255 (255 - always HIGH)
  */
-void Buzzer::set_duty_cycle(uint8_t duty_cycle) { OCR2B = (OCR2A * duty_cycle) >> 8U; }
+void Buzzer::set_duty_cycle(uint8_t duty_cycle) { hal.buzzer_pwm_write((top * duty_cycle) >> 8U); }
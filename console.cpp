@@ -0,0 +1,614 @@
+/**
+ * @file console.cpp
+ * @author Fern Lane
+ * @brief Non-blocking serial command console for configuration and diagnostics
+ *
+ * @copyright Copyright (c) 2024 Fern Lane
+ *
+ * This file is part of the in17clock distribution.
+ * See <https://github.com/F33RNI/in17clock> for more info.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * long with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "include/console.h"
+
+#ifdef CONSOLE
+
+#include <stddef.h>
+
+#include "include/config.h"
+
+#include "include/digits.h"
+#include "include/light.h"
+#include "include/power.h"
+#include "include/profiler.h"
+#include "include/recorder.h"
+#include "include/rtc.h"
+#include "include/self_test.h"
+#include "include/settings.h"
+#include "include/temp_humid.h"
+#include "include/tube_hours.h"
+#include "include/watchdog.h"
+
+// Preinstantiate
+Console console;
+
+// All commands. Each handler prints one line per call
+const ConsoleCommand Console::commands[] PROGMEM = {
+    {"help", cmd_help},     {"get", cmd_get},     {"set", cmd_set},       {"save", cmd_save},
+    {"time", cmd_time},     {"date", cmd_date},   {"alarm", cmd_alarm},   {"power", cmd_power},
+    {"sensor", cmd_sensor}, {"faults", cmd_faults}, {"mem", cmd_mem},     {"boot", cmd_boot},
+    {"tubes", cmd_tubes},   {"heat", cmd_heat},
+#ifdef CONFIG_OVERLAY
+    {"cfg", cmd_cfg},
+#endif
+#ifdef LIGHT_SENSOR
+    {"light", cmd_light},
+#endif
+#ifdef PROFILER
+    {"prof", cmd_prof},
+#endif
+#ifdef RECORDER
+    {"rec", cmd_rec},
+#endif
+#ifdef SELF_TEST
+    {"test", cmd_test},
+#endif
+};
+#define COMMANDS_N (sizeof(Console::commands) / sizeof(ConsoleCommand))
+
+// Settings for get / set commands
+const ConsoleSetting Console::settings_list[] PROGMEM = {
+    {"voltage", offsetof(SettingsData, voltage), CONVERTER_SETPOINT_MIN, CONVERTER_SETPOINT_MAX},
+    {"alarm_h", offsetof(SettingsData, alarm_hours), 0U, 23U},
+    {"alarm_m", offsetof(SettingsData, alarm_minutes), 0U, 59U},
+    {"night_on", offsetof(SettingsData, night_on), 0U, 23U},
+    {"night_off", offsetof(SettingsData, night_off), 0U, 23U},
+    {"trim1", offsetof(SettingsData, tube_trim[0]), 0U, TUBE_TRIM_MAX},
+    {"trim2", offsetof(SettingsData, tube_trim[1]), 0U, TUBE_TRIM_MAX},
+    {"trim3", offsetof(SettingsData, tube_trim[2]), 0U, TUBE_TRIM_MAX},
+    {"trim4", offsetof(SettingsData, tube_trim[3]), 0U, TUBE_TRIM_MAX},
+    {"heat_base", offsetof(SettingsData, heat_base), 0U, 255U},
+    {"heat_conv", offsetof(SettingsData, heat_converter), 0U, 255U},
+    {"heat_disp", offsetof(SettingsData, heat_display), 0U, 255U},
+    {"heat_tau", offsetof(SettingsData, heat_tau), 1U, 255U},
+    {"dst", offsetof(SettingsData, dst), 0U, DST_RULES_N},
+};
+#define SETTINGS_LIST_N (sizeof(Console::settings_list) / sizeof(ConsoleSetting))
+
+/**
+ * @brief Opens serial port
+ */
+void Console::init(void) {
+    CONSOLE_SERIAL.begin(CONSOLE_BAUD_RATE);
+    CONSOLE_SERIAL.println(F("in17clock console. Type help to see all commands"));
+}
+
+/**
+ * @brief Prints next line of the current response or reads a few received characters and executes command
+ * NOTE: Must be called in a main loop without any delays
+ */
+void Console::update(void) {
+    // Print response line by line without blocking on a full TX buffer
+    if (handler) {
+        if (CONSOLE_SERIAL.availableForWrite() < (int) CONSOLE_TX_FREE)
+            return;
+        if (!handler(step++))
+            handler = NULL;
+        return;
+    }
+
+    for (uint8_t i = 0; i < CONSOLE_CHARS_PER_LOOP && CONSOLE_SERIAL.available(); ++i) {
+        char c = CONSOLE_SERIAL.read();
+
+        // End of line -> execute command (response will be printed on the next calls)
+        if (c == '\r' || c == '\n') {
+            if (line_overflow)
+                print_error();
+            else if (line_length) {
+                line[line_length] = '\0';
+                execute();
+            }
+            line_length = 0;
+            line_overflow = false;
+            if (handler)
+                return;
+            continue;
+        }
+
+        if (line_length < CONSOLE_LINE_LENGTH - 1U)
+            line[line_length++] = c;
+        else
+            line_overflow = true;
+    }
+}
+
+/**
+ * @brief Splits line into arguments and finds command handler
+ */
+void Console::execute(void) {
+    args_n = 0;
+    char *token = strtok(line, " ");
+    while (token && args_n < CONSOLE_ARGS_MAX) {
+        args[args_n++] = token;
+        token = strtok(NULL, " ");
+    }
+    if (!args_n)
+        return;
+
+    for (uint8_t i = 0; i < COMMANDS_N; ++i) {
+        if (strcmp_P(args[0], commands[i].name) == 0) {
+            handler = (ConsoleHandler) pgm_read_ptr(&commands[i].handler);
+            step = 0;
+            return;
+        }
+    }
+    CONSOLE_SERIAL.println(F("unknown command"));
+}
+
+/**
+ * @brief Parses unsigned decimal number
+ *
+ * @param arg string to parse
+ * @param min minimal allowed value
+ * @param max maximal allowed value
+ * @param number pointer to the result
+ * @return boolean true if parsed and within limits
+ */
+boolean Console::parse_number(const char *arg, uint8_t min, uint8_t max, uint8_t *number) {
+    uint16_t result;
+    if (!parse_number(arg, (uint16_t) min, (uint16_t) max, &result))
+        return false;
+    *number = result;
+    return true;
+}
+
+boolean Console::parse_number(const char *arg, uint16_t min, uint16_t max, uint16_t *number) {
+    uint32_t result = 0;
+    uint8_t length = 0;
+    for (; *arg; ++arg, ++length) {
+        if (*arg < '0' || *arg > '9' || length == 5U)
+            return false;
+        result = result * 10U + (*arg - '0');
+    }
+    if (!length || result < min || result > max)
+        return false;
+    *number = result;
+    return true;
+}
+
+/**
+ * @brief Prints number with leading zero
+ *
+ * @param number 0-99
+ */
+void Console::print_two_digits(uint8_t number) {
+    if (number < 10U)
+        CONSOLE_SERIAL.print('0');
+    CONSOLE_SERIAL.print(number);
+}
+
+void Console::print_ok(void) { CONSOLE_SERIAL.println(F("ok")); }
+
+void Console::print_error(void) { CONSOLE_SERIAL.println(F("error")); }
+
+/**
+ * @brief help - prints list of all commands
+ */
+boolean Console::cmd_help(uint8_t step) {
+    CONSOLE_SERIAL.println((const __FlashStringHelper *) commands[step].name);
+    return step + 1U < COMMANDS_N;
+}
+
+/**
+ * @brief get [name] - prints one or all settings
+ */
+boolean Console::cmd_get(uint8_t step) {
+    // Find setting by name or print one setting per step
+    uint8_t index = step;
+    if (console.args_n > 1) {
+        for (index = 0; index < SETTINGS_LIST_N; ++index)
+            if (strcmp_P(console.args[1], settings_list[index].name) == 0)
+                break;
+        if (index == SETTINGS_LIST_N) {
+            print_error();
+            return false;
+        }
+    }
+
+    CONSOLE_SERIAL.print((const __FlashStringHelper *) settings_list[index].name);
+    CONSOLE_SERIAL.print('=');
+    CONSOLE_SERIAL.println(((const uint8_t *) &settings.data)[pgm_read_byte(&settings_list[index].offset)]);
+    return console.args_n == 1 && step + 1U < SETTINGS_LIST_N;
+}
+
+/**
+ * @brief set <name> <value> - changes setting (will be saved after SETTINGS_COMMIT_DELAY)
+ */
+boolean Console::cmd_set(uint8_t step) {
+    if (console.args_n != 3) {
+        print_error();
+        return false;
+    }
+
+    for (uint8_t i = 0; i < SETTINGS_LIST_N; ++i) {
+        if (strcmp_P(console.args[1], settings_list[i].name) != 0)
+            continue;
+        uint8_t value, offset = pgm_read_byte(&settings_list[i].offset), dst = settings.data.dst;
+        if (!parse_number(console.args[2], pgm_read_byte(&settings_list[i].min), pgm_read_byte(&settings_list[i].max),
+                          &value))
+            break;
+
+        // Shown time with the old DST rule (cached one can be up to a second old or not include just set time)
+        if (offset == offsetof(SettingsData, dst) && value != dst)
+            rtc.read();
+        ((uint8_t *) &settings.data)[offset] = value;
+        settings.mark_dirty();
+
+        // Apply settings that are copied into modules
+        power.set_voltage(settings.data.voltage);
+        digits.set_trims(settings.data.tube_trim);
+
+        // Keep shown time with the new DST rule (rewrite it in new standard time)
+        if (settings.data.dst != dst)
+            rtc.set(rtc.get_hours(), rtc.get_minutes(), rtc.get_seconds());
+        print_ok();
+        return false;
+    }
+    print_error();
+    return false;
+}
+
+/**
+ * @brief save - writes settings to EEPROM immediately
+ */
+boolean Console::cmd_save(uint8_t step) {
+    settings.commit();
+    print_ok();
+    return false;
+}
+
+/**
+ * @brief time [hh mm [ss]] - prints (with "dst" if DST is in effect) or sets current local time
+ */
+boolean Console::cmd_time(uint8_t step) {
+    if (console.args_n == 1) {
+        print_two_digits(rtc.get_hours());
+        CONSOLE_SERIAL.print(':');
+        print_two_digits(rtc.get_minutes());
+        CONSOLE_SERIAL.print(':');
+        print_two_digits(rtc.get_seconds());
+        CONSOLE_SERIAL.println(rtc.is_dst() ? F(" dst") : F(""));
+        return false;
+    }
+
+    uint8_t hours, minutes, seconds = 0;
+    if (console.args_n < 3 || !parse_number(console.args[1], 0U, 23U, &hours) ||
+        !parse_number(console.args[2], 0U, 59U, &minutes) ||
+        (console.args_n > 3 && !parse_number(console.args[3], 0U, 59U, &seconds))) {
+        print_error();
+        return false;
+    }
+    rtc.set(hours, minutes, seconds);
+    print_ok();
+    return false;
+}
+
+/**
+ * @brief date [dd mm yy] - prints or sets current date
+ */
+boolean Console::cmd_date(uint8_t step) {
+    if (console.args_n == 1) {
+        print_two_digits(rtc.get_day());
+        CONSOLE_SERIAL.print('.');
+        print_two_digits(rtc.get_month());
+        CONSOLE_SERIAL.print(F(".20"));
+        print_two_digits(rtc.get_year());
+        CONSOLE_SERIAL.println();
+        return false;
+    }
+
+    uint8_t day, month, year;
+    if (console.args_n != 4 || !parse_number(console.args[1], 1U, 31U, &day) ||
+        !parse_number(console.args[2], 1U, 12U, &month) || !parse_number(console.args[3], 0U, 99U, &year) ||
+        day > RTC::days_in_month(month, year)) {
+        print_error();
+        return false;
+    }
+    rtc.set_date(day, month, year);
+    print_ok();
+    return false;
+}
+
+/**
+ * @brief alarm [hh mm] - prints alarm time and state or sets alarm time
+ */
+boolean Console::cmd_alarm(uint8_t step) {
+    if (console.args_n == 1) {
+        print_two_digits(settings.data.alarm_hours);
+        CONSOLE_SERIAL.print(':');
+        print_two_digits(settings.data.alarm_minutes);
+        CONSOLE_SERIAL.println(settings.data.alarm_active ? F(" ringing") : F(""));
+        return false;
+    }
+
+    uint8_t hours, minutes;
+    if (console.args_n != 3 || !parse_number(console.args[1], 0U, 23U, &hours) ||
+        !parse_number(console.args[2], 0U, 59U, &minutes)) {
+        print_error();
+        return false;
+    }
+    settings.data.alarm_hours = hours;
+    settings.data.alarm_minutes = minutes;
+    settings.mark_dirty();
+    print_ok();
+    return false;
+}
+
+/**
+ * @brief power - prints converter telemetry
+ */
+boolean Console::cmd_power(uint8_t step) {
+    if (step == 0) {
+        CONSOLE_SERIAL.print(F("setpoint="));
+        CONSOLE_SERIAL.print(power.get_voltage());
+        CONSOLE_SERIAL.print(F("V soft_start="));
+        CONSOLE_SERIAL.print(power.get_setpoint_current());
+        CONSOLE_SERIAL.println('V');
+        return true;
+    }
+    CONSOLE_SERIAL.print(F("measured="));
+    CONSOLE_SERIAL.print(power.get_measured_voltage(), 1);
+    CONSOLE_SERIAL.print(F("V duty="));
+    CONSOLE_SERIAL.print(power.get_duty_cycle());
+    CONSOLE_SERIAL.println(F("/1024"));
+    return false;
+}
+
+/**
+ * @brief sensor - prints filtered (compensated for self-heating) and raw temperature and humidity
+ */
+boolean Console::cmd_sensor(uint8_t step) {
+    CONSOLE_SERIAL.print(step == 0 ? F("filtered=") : F("raw="));
+    CONSOLE_SERIAL.print(step == 0 ? temp_humid.get_temperature() : temp_humid.get_temperature_raw(), 2);
+    CONSOLE_SERIAL.print(F("C "));
+    CONSOLE_SERIAL.print(step == 0 ? temp_humid.get_humidity() : temp_humid.get_humidity_raw(), 2);
+    CONSOLE_SERIAL.println('%');
+    return step == 0;
+}
+
+/**
+ * @brief faults - prints error counters and last reset cause
+ */
+boolean Console::cmd_faults(uint8_t step) {
+    if (step == 1) {
+        watchdog.report(CONSOLE_SERIAL);
+        return false;
+    }
+    CONSOLE_SERIAL.print(F("rtc_bus="));
+    CONSOLE_SERIAL.print(rtc.get_bus_errors());
+    CONSOLE_SERIAL.print(F(" sensor_bus="));
+    CONSOLE_SERIAL.print(temp_humid.get_bus_errors());
+    CONSOLE_SERIAL.print(F(" sensor_crc="));
+    CONSOLE_SERIAL.println(temp_humid.get_crc_errors());
+    return true;
+}
+
+/**
+ * @brief mem - prints SRAM usage: static data, heap, current and minimal free stack
+ */
+boolean Console::cmd_mem(uint8_t step) {
+    CONSOLE_SERIAL.print(F("static="));
+    CONSOLE_SERIAL.print(hal.memory_static());
+    CONSOLE_SERIAL.print(F(" heap="));
+    CONSOLE_SERIAL.print(hal.memory_heap());
+    CONSOLE_SERIAL.print(F(" stack_free="));
+    CONSOLE_SERIAL.print(hal.memory_stack_free());
+    CONSOLE_SERIAL.print(F(" stack_free_min="));
+    CONSOLE_SERIAL.println(hal.memory_stack_free_min());
+    return false;
+}
+
+/**
+ * @brief boot - prints time from startup to the first shown number and to the lighting voltage (0 - not yet)
+ * Digits are visible after both of them
+ */
+boolean Console::cmd_boot(uint8_t step) {
+    CONSOLE_SERIAL.print(F("first_digit="));
+    CONSOLE_SERIAL.print(digits.get_boot_time());
+    CONSOLE_SERIAL.print(F("ms converter_ready="));
+    CONSOLE_SERIAL.print(power.get_ready_time());
+    CONSOLE_SERIAL.println(F("ms"));
+    return false;
+}
+
+/**
+ * @brief tubes [reset <1-4>] - prints lit time and wear (in % of TUBE_HOURS_LIFETIME) of each tube and converter
+ * voltage compensation or resets lit time of the replaced tube
+ */
+boolean Console::cmd_tubes(uint8_t step) {
+    if (console.args_n > 1) {
+        uint8_t tube;
+        if (console.args_n != 3 || strcmp_P(console.args[1], PSTR("reset")) ||
+            !parse_number(console.args[2], 1U, DIGITS_NUM, &tube)) {
+            print_error();
+            return false;
+        }
+        tube_hours.reset(tube - 1U);
+        print_ok();
+        return false;
+    }
+
+    if (step == DIGITS_NUM) {
+        CONSOLE_SERIAL.print(F("compensation="));
+        CONSOLE_SERIAL.print(tube_hours.get_compensation());
+        CONSOLE_SERIAL.println('V');
+        return false;
+    }
+
+    uint16_t hours_10 = tube_hours.get_hours_10(step);
+    CONSOLE_SERIAL.print(F("tube"));
+    CONSOLE_SERIAL.print(step + 1U);
+    CONSOLE_SERIAL.print(F(" lit="));
+    CONSOLE_SERIAL.print(hours_10 / 10U);
+    CONSOLE_SERIAL.print('.');
+    CONSOLE_SERIAL.print(hours_10 % 10U);
+    CONSOLE_SERIAL.print(F("h wear="));
+    CONSOLE_SERIAL.print(tube_hours.get_wear(step));
+    CONSOLE_SERIAL.println(tube_hours.is_worn(step) ? F("% worn") : F("%"));
+    return true;
+}
+
+/**
+ * @brief heat [ref <degrees>] - prints current and steady state excess temperature of the sensor caused by
+ * self-heating or calibrates heat_base, heat_conv and heat_disp against the reference temperature (ex. 23.5)
+ */
+boolean Console::cmd_heat(uint8_t step) {
+    if (console.args_n > 1) {
+        // Whole degrees and optional tenths
+        uint8_t degrees, tenths = 0;
+        char *point = console.args_n == 3 ? strchr(console.args[2], '.') : NULL;
+        if (point)
+            *point = '\0';
+        if (console.args_n != 3 || strcmp_P(console.args[1], PSTR("ref")) ||
+            !parse_number(console.args[2], 0U, 99U, &degrees) || (point && !parse_number(point + 1, 0U, 9U, &tenths)) ||
+            !temp_humid.calibrate_heating(degrees + tenths / 10.f)) {
+            print_error();
+            return false;
+        }
+        print_ok();
+        return false;
+    }
+
+    CONSOLE_SERIAL.print(F("heating="));
+    CONSOLE_SERIAL.print(temp_humid.get_heating(), 2);
+    CONSOLE_SERIAL.print(F("C target="));
+    CONSOLE_SERIAL.print(temp_humid.get_heating_target(), 2);
+    CONSOLE_SERIAL.println('C');
+    return false;
+}
+
+#ifdef LIGHT_SENSOR
+/**
+ * @brief light - prints filtered light (raw ADC value) and current brightness of the tubes and the separator
+ */
+boolean Console::cmd_light(uint8_t step) {
+    CONSOLE_SERIAL.print(F("light="));
+    CONSOLE_SERIAL.print(light.get_light());
+    CONSOLE_SERIAL.print(F(" tubes="));
+    CONSOLE_SERIAL.print(light.get_tubes());
+    CONSOLE_SERIAL.print(F("/255 separator="));
+    CONSOLE_SERIAL.print(light.get_separator());
+    CONSOLE_SERIAL.println(F("/255"));
+    return false;
+}
+#endif
+
+#ifdef CONFIG_OVERLAY
+/**
+ * @brief cfg [name [value | -]] - prints one or all values from CONFIG_OVERLAY_LIST, overrides value or resets it
+ * to the compile-time one (will be saved after SETTINGS_COMMIT_DELAY)
+ */
+boolean Console::cmd_cfg(uint8_t step) {
+    // Find value by name or print one value per step
+    uint8_t index = step;
+    if (console.args_n > 1) {
+        for (index = 0; index < CONFIG_OVERLAY_NUM; ++index)
+            if (strcmp_P(console.args[1], settings.overlay_list[index].name) == 0)
+                break;
+        if (index == CONFIG_OVERLAY_NUM || console.args_n > 3) {
+            print_error();
+            return false;
+        }
+    }
+
+    // Override or reset
+    if (console.args_n == 3) {
+        uint16_t value = 0;
+        if (strcmp_P(console.args[2], PSTR("-")) != 0 &&
+            !parse_number(console.args[2], pgm_read_word(&settings.overlay_list[index].min),
+                          pgm_read_word(&settings.overlay_list[index].max), &value)) {
+            print_error();
+            return false;
+        }
+        settings.data.overlay[index] = value;
+        settings.mark_dirty();
+        print_ok();
+        return false;
+    }
+
+    uint16_t value = pgm_read_word(&settings.overlay_list[index].value);
+    CONSOLE_SERIAL.print((const __FlashStringHelper *) settings.overlay_list[index].name);
+    CONSOLE_SERIAL.print('=');
+    CONSOLE_SERIAL.print(settings.config(index, value));
+    if (settings.data.overlay[index]) {
+        CONSOLE_SERIAL.print(F(" (default "));
+        CONSOLE_SERIAL.print(value);
+        CONSOLE_SERIAL.print(')');
+    }
+    CONSOLE_SERIAL.println();
+    return console.args_n == 1 && step + 1U < CONFIG_OVERLAY_NUM;
+}
+#endif
+
+#ifdef PROFILER
+/**
+ * @brief prof - prints and resets profiler report
+ */
+boolean Console::cmd_prof(uint8_t step) {
+    if (profiler.report(CONSOLE_SERIAL, step))
+        return true;
+    profiler.reset();
+    return false;
+}
+#endif
+
+#ifdef RECORDER
+/**
+ * @brief rec [clear] - prints recorded input events or clears them
+ */
+boolean Console::cmd_rec(uint8_t step) {
+    if (console.args_n > 1) {
+        if (strcmp_P(console.args[1], PSTR("clear")))
+            print_error();
+        else {
+            recorder.clear();
+            print_ok();
+        }
+        return false;
+    }
+    return recorder.dump(CONSOLE_SERIAL, step);
+}
+#endif
+
+#ifdef SELF_TEST
+/**
+ * @brief test [start] - prints self-test progress or result (fault map) or starts it
+ */
+boolean Console::cmd_test(uint8_t step) {
+    if (console.args_n > 1) {
+        if (strcmp_P(console.args[1], PSTR("start")))
+            print_error();
+        else {
+            self_test.start();
+            print_ok();
+        }
+        return false;
+    }
+    return self_test.report(CONSOLE_SERIAL, step);
+}
+#endif
+
+#endif
@@ -25,34 +25,26 @@
 #include "include/digits.h"
 
 #include "include/config.h"
+#include "include/decimal.h"
 #include "include/pins.h"
+#include "include/watchdog.h"
 
 // Preinstantiate
 Digits digits;
 
 void Digits::init(void) {
-    // Initialize latch pin for using with fast digital write
-    latch_pin_mask = digitalPinToBitMask(PIN_LATCH);
-    latch_pin_p_out = portOutputRegister(digitalPinToPort(PIN_LATCH));
-    pinMode(PIN_LATCH, OUTPUT);
+    // Initialize SPI and latch pin
+    hal.spi_init(PIN_LATCH);
 
-    // Initialize SPI
-    spi_settings = SPISettings(SPI_CLOCK_DIV16, MSBFIRST, SPI_MODE0);
-    SPI.begin();
+    // Full brightness (dimming interrupt is disabled)
+    brightness_limit = 255U;
+    dim_on_time = 255U;
+    dim_on_time_next = 255U;
+    set_brightness(255U, 255U);
 
-    // CTC mode
-    // See "Table 14-8. Waveform Generation Mode Bit Description" in Atmega328P datasheet for more info
-    TCCR0A |= _BV(WGM01);
-
-    // Set prescaler
-    TCCR0B |= TIMER0_PRESCALER;
-
-    // Output Compare Match A Interrupt Enable
-    TIMSK0 |= _BV(OCIE0A);
-    OCR0A = OCR0A_VALUE;
-
-    // Enable interrupts
-    sei();
+    // Start multiplexing timer interrupt
+    hal.multiplex_timer_init(_isr_callback);
+    hal.multiplex_dim_init(_dim_callback);
 
     // Disable everything
     set();
@@ -67,12 +59,33 @@ void Digits::init(void) {
  * @param digit_4 nixie 4 (0-9). If larger will be turned OFF
  */
 void Digits::set(uint8_t digit_1, uint8_t digit_2, uint8_t digit_3, uint8_t digit_4) {
+    // Remember when the first number was shown
+    if (!boot_time && (digit_1 < 10U || digit_2 < 10U || digit_3 < 10U || digit_4 < 10U)) {
+        uint32_t time = hal.millis();
+        boot_time = time > 0xFFFFUL ? 0xFFFFU : (time ? time : 1U);
+    }
+
     current_numbers[0] = digit_1;
     current_numbers[1] = digit_2;
     current_numbers[2] = digit_3;
     current_numbers[3] = digit_4;
 }
 
+/**
+ * @brief Sets two 2-digit numbers (ex. hours and minutes) to the left and right pair of nixies
+ *
+ * @param left 0-99 (tens digit is turned OFF for larger numbers)
+ * @param right 0-99 (tens digit is turned OFF for larger numbers)
+ * @param left_on false to turn left pair OFF
+ * @param right_on false to turn right pair OFF
+ */
+void Digits::set_pair(uint8_t left, uint8_t right, boolean left_on, boolean right_on) {
+    uint8_t numbers[4];
+    decimal_split_pair(left, right, numbers);
+    set(left_on ? numbers[0] : 255U, left_on ? numbers[1] : 255U, right_on ? numbers[2] : 255U,
+        right_on ? numbers[3] : 255U);
+}
+
 /**
  * @brief Sets separator state
  *
@@ -80,14 +93,154 @@ void Digits::set(uint8_t digit_1, uint8_t digit_2, uint8_t digit_3, uint8_t digi
  */
 void Digits::set_separator(boolean state) { current_separator_state = state; }
 
+/**
+ * @brief Sets brightness of the tubes (part of each multiplexing slot they are ON) and the separator (part of
+ * multiplexing slots it is ON, so it has only DIGITS_NUM + 1 levels)
+ *
+ * @param tubes 0 (dimmest, but still ON for the multiplexing interrupt time) to 255 (not dimmed)
+ * @param separator 0 (OFF) to 255
+ */
+void Digits::set_brightness(uint8_t tubes, uint8_t separator) {
+    brightness_tubes = tubes;
+    brightness_separator = separator;
+    apply_brightness();
+}
+
+/**
+ * @brief Limits brightness from set_brightness() (ex. at night)
+ *
+ * @param limit 0 (tubes and separator are OFF) to 255 (no limit)
+ */
+void Digits::set_brightness_limit(uint8_t limit) {
+    brightness_limit = limit;
+    apply_brightness();
+}
+
+/**
+ * @brief Sets relative duty of each tube (to match brightness of different tubes)
+ *
+ * @param trims duty reduction of each tube: 0 (full duty) to 255 (OFF). Relative duty is (255 - trim) / 255
+ */
+void Digits::set_trims(const uint8_t trims[4]) {
+    for (uint8_t i = 0; i < DIGITS_NUM; ++i)
+        this->trims[i] = trims[i];
+    apply_brightness();
+}
+
+/**
+ * @param tube 0 to DIGITS_NUM - 1
+ * @return uint8_t part of the multiplexing slot the tube is ON (0-255, 255 - not dimmed)
+ */
+uint8_t Digits::get_on_time(uint8_t tube) { return slot_on_times[tube]; }
+
+/**
+ * @return uint8_t average part of the time each tube glows (0-255, 255 - all tubes show numbers without dimming)
+ */
+uint8_t Digits::get_load(void) {
+    if (testing)
+        return 255U / DIGITS_NUM;
+    if (!brightness_limit)
+        return 0U;
+    uint16_t load = 0;
+    for (uint8_t i = 0; i < DIGITS_NUM; ++i)
+        if (current_numbers[i] < 10U)
+            load += slot_on_times[i];
+    return load / DIGITS_NUM;
+}
+
+/**
+ * @brief Reads and resets number of multiplexing slots in which the tube was lit (showed a number)
+ *
+ * @param tube 0 to DIGITS_NUM - 1
+ * @return uint16_t number of slots since the previous call (overflows after 65535)
+ */
+uint16_t Digits::take_lit_slots(uint8_t tube) {
+    uint16_t slots;
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        slots = lit_slots[tube];
+        lit_slots[tube] = 0;
+    }
+    return slots;
+}
+
+/**
+ * @brief Shows single element in every multiplexing slot (without dimming) instead of the numbers (ex. for self-test)
+ *
+ * @param anode 0 to DIGITS_NUM - 1 or DIGITS_NUM for none
+ * @param number 0-9 or 255 for none
+ * @param separator true to turn on the separator
+ */
+void Digits::set_test(uint8_t anode, uint8_t number, boolean separator) {
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        test_anode = anode;
+        test_number = number;
+        test_separator = separator;
+        testing = true;
+    }
+}
+
+/**
+ * @brief Shows numbers again (after set_test())
+ */
+void Digits::stop_test(void) { testing = false; }
+
+/**
+ * @return uint16_t time from startup to the first shown number in milliseconds (0 if nothing was shown yet)
+ */
+uint16_t Digits::get_boot_time(void) { return boot_time; }
+
 /**
  * @brief Handles interrupt (writes current_numbers and current_separator_state to each nixie tube)
  */
 void Digits::isr_callback_handler(void) {
-    write(digit_counter, current_numbers[digit_counter], current_separator_state);
+    // Same element in every slot (see set_test())
+    if (testing) {
+        write(test_anode, test_number, test_separator);
+        watchdog.check_in_isr(WATCHDOG_TASK_DISPLAY);
+        return;
+    }
+
+    slot_separator = current_separator_state && digit_counter < separator_slots;
+    uint8_t number = brightness_limit ? current_numbers[digit_counter] : 255U;
+    if (number < 10U)
+        lit_slots[digit_counter]++;
+    write(digit_counter, number, slot_separator);
+
+    // Next slot's on time is passed as well because Arduino HAL can only program it in advance
+    // Dimming interrupt is reprogrammed only if one of them differs from the previous slot
+    uint8_t on_time = slot_on_times[digit_counter];
     digit_counter++;
     if (digit_counter == DIGITS_NUM)
         digit_counter = 0;
+    uint8_t on_time_next = slot_on_times[digit_counter];
+    if (on_time != dim_on_time || on_time_next != dim_on_time_next) {
+        dim_on_time = on_time;
+        dim_on_time_next = on_time_next;
+        hal.multiplex_dim_write(on_time, on_time_next);
+    }
+    watchdog.check_in_isr(WATCHDOG_TASK_DISPLAY);
+}
+
+/**
+ * @brief Handles dimming interrupt (turns tubes OFF until the next multiplexing slot, separator stays as it is)
+ */
+void Digits::dim_callback_handler(void) {
+    if (!testing)
+        write(DIGITS_NUM, 255U, slot_separator);
+}
+
+/**
+ * @brief Precomputes on time of each multiplexing slot from set_brightness() limited by set_brightness_limit() and
+ * scaled by set_trims()
+ */
+void Digits::apply_brightness(void) {
+    uint8_t tubes = brightness_tubes < brightness_limit ? brightness_tubes : brightness_limit;
+    uint8_t separator = brightness_separator < brightness_limit ? brightness_separator : brightness_limit;
+    separator_slots = ((uint16_t) separator * DIGITS_NUM + 254U) / 255U;
+
+    // Limit 0 turns tubes OFF in the multiplexing interrupt, so dimming interrupt is not needed
+    for (uint8_t i = 0; i < DIGITS_NUM; ++i)
+        slot_on_times[i] = brightness_limit ? ((uint16_t) tubes * (255U - trims[i])) / 255U : 255U;
 }
 
 /**
@@ -106,7 +259,7 @@ void Digits::write(uint8_t anode, uint8_t number, boolean separator) {
     if (anode < DIGITS_NUM)
         anode_mask &= ~pgm_read_word(&PINS_ANODES[anode]);
 #else
-    uint16_t anode_mask = anode < anodes_num ? pgm_read_word(&PINS_ANODES[anode]) : 0U;
+    uint16_t anode_mask = anode < DIGITS_NUM ? pgm_read_word(&PINS_ANODES[anode]) : 0U;
 #endif
 
         // Calculate which numbers (cathodes) to activate
@@ -136,20 +289,15 @@ void Digits::write(uint8_t anode, uint8_t number, boolean separator) {
         mask &= ~PIN_SEPARATOR;
 
     // Write to the shift registers
-    SPI.beginTransaction(spi_settings);
-    *latch_pin_p_out &= ~latch_pin_mask;
-    SPI.transfer(mask & 0xFF);
-    SPI.transfer((mask >> 8) & 0xFF);
-    *latch_pin_p_out |= latch_pin_mask;
-    SPI.endTransaction();
+    hal.spi_write_word(mask);
 }
 
 /**
- * @brief Redirects interrupt to static member of Digits instance
+ * @brief Redirects static to a non-static isr_callback_handler()
  */
-ISR(TIMER0_COMPA_vect) { digits._isr_callback(); }
+void Digits::_isr_callback(void) { digits.isr_callback_handler(); }
 
 /**
- * @brief Redirects static to a non-static isr_callback_handler()
+ * @brief Redirects static to a non-static dim_callback_handler()
  */
-void Digits::_isr_callback(void) { digits.isr_callback_handler(); }
+void Digits::_dim_callback(void) { digits.dim_callback_handler(); }
@@ -0,0 +1,201 @@
+/**
+ * @file hal_arduino.cpp
+ * @author Fern Lane
+ * @brief Arduino core part of the Atmega328P hardware abstraction layer: time, external interrupts, ADC, SPI and TWI
+ * (SPI and Wire libraries). Not compiled with HAL_BARE_METAL (see hal_bare.cpp)
+ *
+ * @copyright Copyright (c) 2024 Fern Lane
+ *
+ * This file is part of the in17clock distribution.
+ * See <https://github.com/F33RNI/in17clock> for more info.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * long with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "include/hal.h"
+
+#if defined(__AVR__) && !defined(HAL_BARE_METAL)
+
+#include <SPI.h>
+#include <Wire.h>
+
+#include "include/config.h"
+
+static HALCallback multiplex_callback, dim_callback;
+static boolean twi_initialized;
+static SPISettings spi_settings;
+static volatile uint8_t latch_pin_mask, *latch_pin_p_out;
+
+/**
+ * @return uint32_t milliseconds since startup
+ */
+uint32_t HAL::millis(void) { return ::millis(); }
+
+/**
+ * @return uint32_t microseconds since startup (4us resolution)
+ */
+uint32_t HAL::micros(void) { return ::micros(); }
+
+/**
+ * @brief Blocking delay
+ *
+ * @param milliseconds time to wait
+ */
+void HAL::delay(uint32_t milliseconds) { ::delay(milliseconds); }
+
+/**
+ * @brief Attaches falling edge interrupt to pin 2 or 3
+ *
+ * @param pin Arduino pin number
+ * @param callback interrupt handler
+ */
+void HAL::external_interrupt_attach(uint8_t pin, HALCallback callback) {
+    attachInterrupt(digitalPinToInterrupt(pin), callback, FALLING);
+}
+
+/**
+ * @brief Enables Timer 0 compare A interrupt once per timer period
+ * Core keeps Timer 0 in fast PWM mode for its own millis(), so the period is always 256 ticks and multiplexing
+ * runs at F_CPU / 64 / 256 (976.5625Hz at 16MHz) instead of MULTIPLEXING_FREQUENCY
+ *
+ * @param callback interrupt handler
+ */
+void HAL::multiplex_timer_init(HALCallback callback) {
+    multiplex_callback = callback;
+
+    // Set prescaler
+    TCCR0B |= TIMER0_PRESCALER;
+
+    // Output Compare Match A Interrupt Enable
+    // Match is placed at BOTTOM where double-buffered OCR0B is loaded.
+    // This way OCR0B written inside the interrupt always belongs to the next slot
+    TIMSK0 |= _BV(OCIE0A);
+    OCR0A = 0U;
+
+    // Enable interrupts
+    sei();
+}
+
+/**
+ * @brief Sets Timer 0 compare B interrupt handler (see multiplex_dim_write())
+ *
+ * @param callback interrupt handler
+ */
+void HAL::multiplex_dim_init(HALCallback callback) { dim_callback = callback; }
+
+/**
+ * @brief Fires dim callback after on_time / 256 of each multiplexing slot. Safe to call from interrupts
+ *
+ * @param on_time 0-254 or 255 to disable dim interrupt in the current slot
+ * @param on_time_next 0-254 or 255 to disable dim interrupt in the next slot
+ */
+void HAL::multiplex_dim_write(uint8_t on_time, uint8_t on_time_next) {
+    // OCR0B is double-buffered in fast PWM mode and is loaded only at BOTTOM (start of the next slot)
+    if (on_time_next != 255U)
+        OCR0B = on_time_next;
+
+    // Interrupt mask is not buffered and applies to the current slot
+    if (on_time == 255U) {
+        TIMSK0 &= ~_BV(OCIE0B);
+        return;
+    }
+    if (!(TIMSK0 & _BV(OCIE0B))) {
+        TIFR0 = _BV(OCF0B);
+        TIMSK0 |= _BV(OCIE0B);
+    }
+}
+
+/**
+ * @brief Sets analog reference to internal 1.1V
+ */
+void HAL::adc_init(void) { analogReference(INTERNAL); }
+
+/**
+ * @param pin analog pin (A0-A7)
+ * @return uint16_t 0-1023
+ */
+uint16_t HAL::adc_read(uint8_t pin) { return analogRead(pin); }
+
+/**
+ * @brief Initializes SPI and latch pin for using with fast digital write
+ *
+ * @param latch_pin Arduino pin number
+ */
+void HAL::spi_init(uint8_t latch_pin) {
+    latch_pin_mask = pin_mask(latch_pin);
+    latch_pin_p_out = pin_port(latch_pin);
+    pin_output(latch_pin);
+    spi_settings = SPISettings(SPI_CLOCK_DIV16, MSBFIRST, SPI_MODE0);
+    SPI.begin();
+}
+
+/**
+ * @brief Writes 16 bits into the shift registers (LSB byte first) and latches them. Safe to call from interrupts
+ *
+ * @param data data to write
+ */
+void HAL::spi_write_word(uint16_t data) {
+    SPI.beginTransaction(spi_settings);
+    *latch_pin_p_out &= ~latch_pin_mask;
+    SPI.transfer(data & 0xFF);
+    SPI.transfer((data >> 8) & 0xFF);
+    *latch_pin_p_out |= latch_pin_mask;
+    SPI.endTransaction();
+}
+
+/**
+ * @brief Initializes I2C bus (only once)
+ */
+void HAL::twi_init(void) {
+    if (twi_initialized)
+        return;
+    Wire.begin();
+    twi_initialized = true;
+}
+
+/**
+ * @brief Writes data to the I2C device
+ *
+ * @param address 7-bit address
+ * @param data pointer to the data
+ * @param length number of bytes
+ * @return uint8_t 0 in case of success
+ */
+uint8_t HAL::twi_write(uint8_t address, const uint8_t *data, uint8_t length) {
+    Wire.beginTransmission(address);
+    Wire.write(data, length);
+    return Wire.endTransmission();
+}
+
+/**
+ * @brief Reads data from the I2C device
+ *
+ * @param address 7-bit address
+ * @param data pointer to the buffer
+ * @param length number of bytes to read
+ * @return uint8_t number of bytes actually read
+ */
+uint8_t HAL::twi_read(uint8_t address, uint8_t *data, uint8_t length) {
+    uint8_t received = Wire.requestFrom(address, length);
+    for (uint8_t i = 0; i < received; ++i)
+        data[i] = Wire.read();
+    return received;
+}
+
+ISR(TIMER0_COMPA_vect) { multiplex_callback(); }
+
+ISR(TIMER0_COMPB_vect) { dim_callback(); }
+
+#endif
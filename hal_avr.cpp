@@ -0,0 +1,324 @@
+/**
+ * @file hal_avr.cpp
+ * @author Fern Lane
+ * @brief Atmega328P implementation of the hardware abstraction layer: GPIO, pin change interrupts, PWM, EEPROM,
+ * watchdog and SRAM usage (register-level, shared by both variants). Time, ADC, SPI and TWI are implemented in
+ * hal_arduino.cpp (Arduino core) or hal_bare.cpp (HAL_BARE_METAL)
+ *
+ * @copyright Copyright (c) 2024 Fern Lane
+ *
+ * This file is part of the in17clock distribution.
+ * See <https://github.com/F33RNI/in17clock> for more info.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * long with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "include/hal.h"
+
+#ifdef __AVR__
+
+#include <avr/eeprom.h>
+
+#include "include/config.h"
+#include "include/pins.h"
+
+// Timer 1 channel A pin on Atmega328P
+#define _TIMER_1_A_PIN 9U
+
+// Timer 2 channel B pin on Atmega328P
+#define _TIMER_2_B_PIN 3U
+
+// Preinstantiate
+HAL hal;
+
+static HALCallback watchdog_callback;
+static HALPinChangeCallback pin_change_callback;
+static boolean converter_inverted;
+
+// Survives reset (not cleared by startup code)
+static uint8_t mcusr_mirror __attribute__((section(".noinit")));
+
+// Free SRAM is filled with this value at startup. Stack overwrites it
+#define _STACK_CANARY 0xC5U
+
+// End of .data, .bss and .noinit (from the linker script) and end of heap (only if malloc() is linked)
+extern uint8_t __heap_start;
+extern char *__brkval __attribute__((weak));
+
+/**
+ * @brief Saves reset cause, disables watchdog and paints free SRAM before anything else
+ * (Watchdog stays enabled after watchdog reset, so it must be disabled before slow initialization)
+ * Stack is still empty here, so everything between static data and RAMEND is painted
+ * NOTE: Bootloaders (ex. optiboot) may clear MCUSR before this
+ */
+void hal_early_init(void) __attribute__((naked, used, section(".init3")));
+void hal_early_init(void) {
+    mcusr_mirror = MCUSR;
+    MCUSR = 0;
+    wdt_disable();
+    for (uint8_t *address = &__heap_start; address <= (uint8_t *) RAMEND; ++address)
+        *address = _STACK_CANARY;
+}
+
+/**
+ * @return uint8_t* first byte above static data and heap
+ */
+static uint8_t *heap_end(void) { return &__brkval && __brkval ? (uint8_t *) __brkval : &__heap_start; }
+
+/**
+ * @param pin Arduino pin number (0-7: PORTD, 8-13: PORTB, 14-19: PORTC)
+ * @return volatile uint8_t* PORTx register of the pin (DDRx and PINx are right below it)
+ */
+volatile uint8_t *HAL::pin_port(uint8_t pin) { return pin < 8U ? &PORTD : (pin < 14U ? &PORTB : &PORTC); }
+
+/**
+ * @param pin Arduino pin number
+ * @return uint8_t bit mask of the pin in its port registers
+ */
+uint8_t HAL::pin_mask(uint8_t pin) { return _BV(pin < 8U ? pin : (pin < 14U ? pin - 8U : pin - 14U)); }
+
+void HAL::pin_output(uint8_t pin) {
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) { *(pin_port(pin) - 1) |= pin_mask(pin); }
+}
+
+void HAL::pin_input_pullup(uint8_t pin) {
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        *(pin_port(pin) - 1) &= ~pin_mask(pin);
+        *pin_port(pin) |= pin_mask(pin);
+    }
+}
+
+/**
+ * @brief Sets output pin state. Safe to call from interrupts
+ */
+void HAL::pin_write(uint8_t pin, boolean state) {
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        if (state)
+            *pin_port(pin) |= pin_mask(pin);
+        else
+            *pin_port(pin) &= ~pin_mask(pin);
+    }
+}
+
+/**
+ * @brief Reads pin directly from input register (safe to call from interrupts)
+ *
+ * @param pin Arduino pin number
+ * @return boolean true if pin is HIGH
+ */
+boolean HAL::pin_read(uint8_t pin) { return *(pin_port(pin) - 2) & pin_mask(pin); }
+
+/**
+ * @param pin Arduino pin number
+ * @return uint8_t index of PCINT vector (group) of this pin
+ */
+uint8_t HAL::pin_change_group(uint8_t pin) { return pin < 8U ? 2U : (pin < 14U ? 0U : 1U); }
+
+/**
+ * @brief Enables pin change interrupt on pin. All pins share the same callback
+ *
+ * @param pin Arduino pin number
+ * @param callback will be called with index of fired PCINT vector (group)
+ */
+void HAL::pin_change_attach(uint8_t pin, HALPinChangeCallback callback) {
+    pin_change_callback = callback;
+    (&PCMSK0)[pin_change_group(pin)] |= pin_mask(pin);
+    PCICR |= _BV(pin_change_group(pin));
+}
+
+/**
+ * @brief Configures Timer 1 and PWM on pin 9
+ *
+ * @param period_cycles Timer 1 TOP value
+ * @param inverted true if HIGH on pin means converter is OFF
+ */
+void HAL::converter_pwm_init(uint16_t period_cycles, boolean inverted) {
+    converter_inverted = inverted;
+
+    // Phase and frequency correct mode, ICR1 as top counter value
+    // See "Table 15-5. Waveform Generation Mode Bit Description" in Atmega328P datasheet for more info
+    TCCR1B = _BV(WGM13);
+    ICR1 = period_cycles;
+
+    // No prescaler
+    TCCR1B |= _BV(CS10);
+
+    // Reset control register A
+    TCCR1A = 0;
+
+    // Enable PWM
+    pin_output(_TIMER_1_A_PIN);
+    converter_pwm_start();
+}
+
+/**
+ * @param compare Timer 1 compare value (0 to period_cycles)
+ */
+void HAL::converter_pwm_write(uint16_t compare) { OCR1A = compare; }
+
+/**
+ * @brief Disconnects PWM from the pin 9 and drives it to the OFF level. Safe to call from interrupts
+ */
+void HAL::converter_pwm_stop(void) {
+    TCCR1A &= ~(_BV(COM1A1) | _BV(COM1A0));
+    pin_write(_TIMER_1_A_PIN, converter_inverted);
+}
+
+/**
+ * @brief Connects PWM back to the pin 9 (after converter_pwm_stop())
+ */
+void HAL::converter_pwm_start(void) {
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        TCCR1A |= _BV(COM1A1);
+
+        // Enable inverted mode if needed
+        if (converter_inverted)
+            TCCR1A |= _BV(COM1A0);
+    }
+}
+
+/**
+ * @brief Configures Timer 2 and PWM on pin 3
+ */
+void HAL::buzzer_pwm_init(void) {
+    // Mode 5 "PWM phase correct", OCRA as top counter value
+    // See "17.11.1" in Atmega328P datasheet for more info
+    TCCR2A = _BV(WGM20);
+    TCCR2B = _BV(WGM22);
+
+    // Enable PWM
+    // See "Table 17-4. Compare Output Mode, Phase Correct PWM Mode" for more info
+    pin_output(_TIMER_2_B_PIN);
+    TCCR2A |= _BV(COM2B1);
+
+    // Enable inverted mode if needed
+#ifdef BUZZER_PWM_INVERTED
+    TCCR2A |= _BV(COM2B0);
+#endif
+}
+
+/**
+ * @brief Sets Timer 2 prescaler and TOP counter
+ *
+ * @param prescaler HAL_TIMER_2_PRESCALER_...
+ * @param top TOP counter value
+ */
+void HAL::buzzer_pwm_frequency(uint8_t prescaler, uint8_t top) {
+    TCCR2B = _BV(WGM22) | prescaler;
+    OCR2A = top;
+}
+
+/**
+ * @param compare Timer 2 compare value (0 to top)
+ */
+void HAL::buzzer_pwm_write(uint8_t compare) { OCR2B = compare; }
+
+uint8_t HAL::eeprom_read(uint16_t address) { return eeprom_read_byte((const uint8_t *) address); }
+
+/**
+ * @brief Starts writing byte if it differs from the current one. Doesn't wait for the end of writing
+ * (call eeprom_ready() before to not block)
+ */
+void HAL::eeprom_update(uint16_t address, uint8_t value) { eeprom_update_byte((uint8_t *) address, value); }
+
+/**
+ * @return boolean true if EEPROM is ready for the next write
+ */
+boolean HAL::eeprom_ready(void) { return eeprom_is_ready(); }
+
+/**
+ * @return uint8_t HAL_RESET_... bits
+ */
+uint8_t HAL::reset_cause(void) { return mcusr_mirror; }
+
+/**
+ * @brief Enables watchdog in interrupt (first timeout) and system reset (next timeout) modes
+ *
+ * @param timeout WDTO_...
+ * @param callback will be called on the first timeout
+ */
+void HAL::watchdog_enable(uint8_t timeout, HALCallback callback) {
+    watchdog_callback = callback;
+    wdt_enable(timeout);
+    WDTCSR |= _BV(WDIE);
+}
+
+void HAL::watchdog_reset(void) { wdt_reset(); }
+
+/**
+ * @brief Resets MCU in 15ms using watchdog
+ */
+void HAL::watchdog_restart(void) {
+    wdt_enable(WDTO_15MS);
+    for (;;)
+        ;
+}
+
+/**
+ * @return uint16_t size of .data, .bss and .noinit in bytes
+ */
+uint16_t HAL::memory_static(void) { return &__heap_start - (uint8_t *) RAMSTART; }
+
+/**
+ * @return uint16_t bytes allocated by malloc() (0 if it's not used)
+ */
+uint16_t HAL::memory_heap(void) { return heap_end() - &__heap_start; }
+
+/**
+ * @return uint16_t bytes between the end of heap and the current stack pointer
+ */
+uint16_t HAL::memory_stack_free(void) { return (uint8_t *) SP - heap_end(); }
+
+/**
+ * @return uint16_t minimal number of bytes that were ever free between heap and stack (painted bytes that stack
+ * never reached). 0 means that stack has reached static data or heap
+ */
+uint16_t HAL::memory_stack_free_min(void) {
+    uint8_t *address = heap_end();
+    while (address <= (uint8_t *) RAMEND && *address == _STACK_CANARY)
+        address++;
+    return address - heap_end();
+}
+
+ISR(WDT_vect) {
+    if (watchdog_callback)
+        watchdog_callback();
+}
+
+#ifdef PCINT0_vect
+ISR(PCINT0_vect) { pin_change_callback(0U); }
+#endif
+#ifdef PCINT1_vect
+ISR(PCINT1_vect) { pin_change_callback(1U); }
+#endif
+#ifdef PCINT2_vect
+ISR(PCINT2_vect) { pin_change_callback(2U); }
+#endif
+#ifdef PCINT3_vect
+ISR(PCINT3_vect) { pin_change_callback(3U); }
+#endif
+#ifdef PCINT4_vect
+ISR(PCINT4_vect) { pin_change_callback(4U); }
+#endif
+#ifdef PCINT5_vect
+ISR(PCINT5_vect) { pin_change_callback(5U); }
+#endif
+#ifdef PCINT6_vect
+ISR(PCINT6_vect) { pin_change_callback(6U); }
+#endif
+#ifdef PCINT7_vect
+ISR(PCINT7_vect) { pin_change_callback(7U); }
+#endif
+
+#endif
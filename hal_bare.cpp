@@ -0,0 +1,334 @@
+/**
+ * @file hal_bare.cpp
+ * @author Fern Lane
+ * @brief Register-level (without Arduino core runtime) part of the Atmega328P hardware abstraction layer: main(), time,
+ * external interrupts, ADC, SPI and TWI. Compiled only with HAL_BARE_METAL instead of hal_arduino.cpp
+ *
+ * Timer 0 runs in real CTC mode at MULTIPLEXING_FREQUENCY and is both the millis() tick and the multiplexing
+ * interrupt (Arduino core keeps it in fast PWM mode for its own millis(), so multiplexing runs at 976Hz there).
+ * Core's init(), SPI and Wire libraries are not linked. Serial and Print still come from the core
+ *
+ * @copyright Copyright (c) 2024 Fern Lane
+ *
+ * This file is part of the in17clock distribution.
+ * See <https://github.com/F33RNI/in17clock> for more info.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * long with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "include/hal.h"
+
+#if defined(__AVR__) && defined(HAL_BARE_METAL)
+
+#include <util/twi.h>
+
+#include "include/config.h"
+
+// Timer 0 interrupt is also the millis() tick
+static_assert(MULTIPLEXING_FREQUENCY == 1000UL, "HAL_BARE_METAL requires MULTIPLEXING_FREQUENCY of 1000Hz");
+
+// Microseconds per Timer 0 count
+#define _TIMER_0_TICK_US (1000UL / (OCR0A_VALUE + 1U))
+
+// INT0 and INT1 pins
+#define _INT_0_PIN 2U
+#define _INT_1_PIN 3U
+
+// I2C clock
+#define _TWI_FREQUENCY 100000UL
+
+// Max number of TWINT polls per bus operation (about 1ms at 16MHz, 9 bits at 100kHz take 90us)
+#define _TWI_TIMEOUT 3000U
+
+// Wire library compatible twi_write() errors
+#define _TWI_ERROR_ADDRESS_NACK 2U
+#define _TWI_ERROR_DATA_NACK    3U
+#define _TWI_ERROR_OTHER        4U
+
+static volatile uint32_t time_ms;
+static HALCallback multiplex_callback, dim_callback, external_callbacks[2];
+static uint8_t spi_latch_pin;
+
+/**
+ * @brief Replaces core's main(): starts Timer 0 (millis() and multiplexing) and runs setup() and loop()
+ * No core's init(), so Timer 1, Timer 2 and ADC are configured only by their HAL init functions
+ */
+int main(void) {
+    // Bootloader may leave UART enabled
+    UCSR0B = 0;
+
+    // CTC mode, MULTIPLEXING_FREQUENCY
+    // See "Table 14-8. Waveform Generation Mode Bit Description" in Atmega328P datasheet for more info
+    TCCR0A = _BV(WGM01);
+    TCCR0B = TIMER0_PRESCALER;
+    OCR0A = OCR0A_VALUE;
+    TIMSK0 = _BV(OCIE0A);
+    sei();
+
+    setup();
+    for (;;)
+        loop();
+}
+
+/**
+ * @return uint32_t milliseconds since startup
+ */
+uint32_t HAL::millis(void) {
+    uint32_t result;
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) { result = time_ms; }
+    return result;
+}
+
+/**
+ * @return uint32_t microseconds since startup (4us resolution at 16MHz)
+ */
+uint32_t HAL::micros(void) {
+    uint32_t result;
+    uint8_t counter;
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        result = time_ms;
+        counter = TCNT0;
+
+        // Compare match happened after interrupts were disabled (counter was already reset)
+        if ((TIFR0 & _BV(OCF0A)) && counter < OCR0A_VALUE)
+            result++;
+    }
+    return result * 1000UL + counter * _TIMER_0_TICK_US;
+}
+
+/**
+ * @brief Blocking delay
+ *
+ * @param milliseconds time to wait
+ */
+void HAL::delay(uint32_t milliseconds) {
+    uint32_t start = millis();
+    while (millis() - start < milliseconds)
+        ;
+}
+
+/**
+ * @brief Attaches falling edge interrupt to pin 2 (INT0) or 3 (INT1)
+ *
+ * @param pin Arduino pin number
+ * @param callback interrupt handler
+ */
+void HAL::external_interrupt_attach(uint8_t pin, HALCallback callback) {
+    uint8_t index = pin - _INT_0_PIN;
+    external_callbacks[index] = callback;
+
+    // Falling edge
+    // See "Table 12-2. Interrupt 0 Sense Control" in Atmega328P datasheet for more info
+    EICRA = (EICRA & ~(0x03U << (index * 2U))) | (_BV(ISC01) << (index * 2U));
+    EIFR = _BV(index);
+    EIMSK |= _BV(index);
+}
+
+/**
+ * @brief Sets Timer 0 compare interrupt handler (Timer 0 is started in main())
+ *
+ * @param callback interrupt handler
+ */
+void HAL::multiplex_timer_init(HALCallback callback) { multiplex_callback = callback; }
+
+/**
+ * @brief Sets Timer 0 compare B interrupt handler (see multiplex_dim_write())
+ *
+ * @param callback interrupt handler
+ */
+void HAL::multiplex_dim_init(HALCallback callback) { dim_callback = callback; }
+
+/**
+ * @brief Fires dim callback after on_time / 256 of each multiplexing slot. Safe to call from interrupts
+ *
+ * @param on_time 0-254 or 255 to disable dim interrupt in the current slot
+ * @param on_time_next not used (OCR0B is not buffered in CTC mode)
+ */
+void HAL::multiplex_dim_write(uint8_t on_time, uint8_t on_time_next) {
+
+    if (on_time == 255U) {
+        TIMSK0 &= ~_BV(OCIE0B);
+        return;
+    }
+
+    // Timer 0 counts 0-OCR0A_VALUE (CTC mode) and the slot starts at 0
+    OCR0B = (uint8_t) (((uint16_t) on_time * (OCR0A_VALUE + 1U)) >> 8U);
+    if (!(TIMSK0 & _BV(OCIE0B))) {
+        TIFR0 = _BV(OCF0B);
+        TIMSK0 |= _BV(OCIE0B);
+    }
+}
+
+/**
+ * @brief Enables ADC with internal 1.1V reference and 125kHz clock (at 16MHz)
+ */
+void HAL::adc_init(void) {
+    ADMUX = _BV(REFS1) | _BV(REFS0);
+    ADCSRA = _BV(ADEN) | _BV(ADPS2) | _BV(ADPS1) | _BV(ADPS0);
+}
+
+/**
+ * @param pin analog pin (A0-A7)
+ * @return uint16_t 0-1023
+ */
+uint16_t HAL::adc_read(uint8_t pin) {
+    ADMUX = _BV(REFS1) | _BV(REFS0) | ((pin - A0) & 0x07U);
+    ADCSRA |= _BV(ADSC);
+    while (ADCSRA & _BV(ADSC))
+        ;
+    return ADC;
+}
+
+/**
+ * @brief Initializes SPI master (mode 0, MSB first, F_CPU / 16) and latch pin
+ *
+ * @param latch_pin Arduino pin number
+ */
+void HAL::spi_init(uint8_t latch_pin) {
+    spi_latch_pin = latch_pin;
+    pin_output(latch_pin);
+
+    // SS must be an output, otherwise LOW on it switches SPI into slave mode
+    pin_write(PIN_SPI_SS, true);
+    pin_output(PIN_SPI_SS);
+    pin_output(PIN_SPI_MOSI);
+    pin_output(PIN_SPI_SCK);
+    SPCR = _BV(SPE) | _BV(MSTR) | _BV(SPR0);
+}
+
+/**
+ * @brief Writes 16 bits into the shift registers (LSB byte first) and latches them. Safe to call from interrupts
+ *
+ * @param data data to write
+ */
+void HAL::spi_write_word(uint16_t data) {
+    volatile uint8_t *latch_port = pin_port(spi_latch_pin);
+    uint8_t latch_mask = pin_mask(spi_latch_pin);
+    *latch_port &= ~latch_mask;
+    SPDR = data & 0xFF;
+    while (!(SPSR & _BV(SPIF)))
+        ;
+    SPDR = (data >> 8) & 0xFF;
+    while (!(SPSR & _BV(SPIF)))
+        ;
+    *latch_port |= latch_mask;
+}
+
+/**
+ * @brief Starts TWI operation and waits for its end
+ *
+ * @param flags _BV(TWSTA) for start condition, _BV(TWEA) to ACK received byte or 0
+ * @return uint8_t TW_... status or 0xFF in case of timeout (bus is released)
+ */
+static uint8_t twi_command(uint8_t flags) {
+    TWCR = _BV(TWINT) | _BV(TWEN) | flags;
+    for (uint16_t i = 0; i < _TWI_TIMEOUT; ++i)
+        if (TWCR & _BV(TWINT))
+            return TW_STATUS;
+    TWCR = 0;
+    TWCR = _BV(TWEN);
+    return 0xFFU;
+}
+
+/**
+ * @brief Sends stop condition and waits for it
+ */
+static void twi_stop(void) {
+    TWCR = _BV(TWINT) | _BV(TWEN) | _BV(TWSTO);
+    for (uint16_t i = 0; i < _TWI_TIMEOUT && (TWCR & _BV(TWSTO)); ++i)
+        ;
+}
+
+/**
+ * @brief Sends start condition and SLA+R/W
+ *
+ * @param sla address << 1 | TW_READ or TW_WRITE
+ * @return uint8_t TW_... status of SLA+R/W or 0xFF if start condition failed
+ */
+static uint8_t twi_start(uint8_t sla) {
+    if (twi_command(_BV(TWSTA)) != TW_START)
+        return 0xFFU;
+    TWDR = sla;
+    return twi_command(0);
+}
+
+/**
+ * @brief Initializes I2C bus (100kHz, internal pull-ups)
+ */
+void HAL::twi_init(void) {
+    pin_input_pullup(PIN_WIRE_SDA);
+    pin_input_pullup(PIN_WIRE_SCL);
+    TWSR = 0;
+    TWBR = ((F_CPU / _TWI_FREQUENCY) - 16UL) / 2UL;
+    TWCR = _BV(TWEN);
+}
+
+/**
+ * @brief Writes data to the I2C device
+ *
+ * @param address 7-bit address
+ * @param data pointer to the data
+ * @param length number of bytes
+ * @return uint8_t 0 in case of success (other values are the same as of Wire.endTransmission())
+ */
+uint8_t HAL::twi_write(uint8_t address, const uint8_t *data, uint8_t length) {
+    uint8_t status = twi_start((address << 1U) | TW_WRITE), error = 0;
+    if (status != TW_MT_SLA_ACK)
+        error = status == TW_MT_SLA_NACK ? _TWI_ERROR_ADDRESS_NACK : _TWI_ERROR_OTHER;
+    for (uint8_t i = 0; i < length && !error; ++i) {
+        TWDR = data[i];
+        status = twi_command(0);
+        if (status != TW_MT_DATA_ACK)
+            error = status == TW_MT_DATA_NACK ? _TWI_ERROR_DATA_NACK : _TWI_ERROR_OTHER;
+    }
+    twi_stop();
+    return error;
+}
+
+/**
+ * @brief Reads data from the I2C device
+ *
+ * @param address 7-bit address
+ * @param data pointer to the buffer
+ * @param length number of bytes to read
+ * @return uint8_t number of bytes actually read
+ */
+uint8_t HAL::twi_read(uint8_t address, uint8_t *data, uint8_t length) {
+    uint8_t received = 0;
+    if (twi_start((address << 1U) | TW_READ) == TW_MR_SLA_ACK) {
+        // ACK all bytes except the last one
+        while (received < length) {
+            uint8_t status = twi_command(received + 1U < length ? _BV(TWEA) : 0);
+            if (status != TW_MR_DATA_ACK && status != TW_MR_DATA_NACK)
+                break;
+            data[received++] = TWDR;
+        }
+    }
+    twi_stop();
+    return received;
+}
+
+ISR(TIMER0_COMPA_vect) {
+    time_ms++;
+    if (multiplex_callback)
+        multiplex_callback();
+}
+
+ISR(TIMER0_COMPB_vect) { dim_callback(); }
+
+ISR(INT0_vect) { external_callbacks[0](); }
+ISR(INT1_vect) { external_callbacks[1](); }
+
+#endif
@@ -25,32 +25,31 @@
 #ifndef BUTTONS_H__
 #define BUTTONS_H__
 
-#include <Arduino.h>
-#include <util/atomic.h>
+#include "hal.h"
 
-#define DEBOUNCING_RETURN(name, name_state, name_last)                                                                 \
-    name_state <<= 1;                                                                                                  \
-    name_state |= name & 0x01;                                                                                         \
-    name_last = name_state == 0xFFFF ? true : !name_state ? false : name_last;                                         \
-    return name_last;
+// Button indexes (bits of Buttons::pressed and Buttons::debounced)
+#define BUTTON_UP      0U
+#define BUTTON_DOWN    1U
+#define BUTTON_WEATHER 2U
+#define BUTTON_SET     3U
+#define BUTTON_ALARM   4U
+#define BUTTONS_NUM    5U
 
 class Buttons {
   public:
     void init(void);
     boolean get_up(void), get_down(void), get_weather(void), get_set(void), get_alarm(void);
+    boolean get_any(void), is_alarm_on(void);
+    void suppress(void);
 
     static void _isr(uint8_t pcicr_bit);
 
   private:
-    volatile uint8_t btn_up_pin_mask, *btn_up_port;
-    volatile uint8_t btn_down_pin_mask, *btn_down_port;
-    volatile uint8_t btn_weather_pin_mask, *btn_weather_port;
-    volatile uint8_t btn_set_pin_mask, *btn_set_port;
-    volatile uint8_t sw_alarm_pin_mask, *sw_alarm_port;
-    volatile boolean up, down, weather, set, alarm;
-    boolean up_last, down_last, weather_last, set_last, alarm_last;
-    uint16_t up_state, down_state, weather_state, set_state, alarm_state;
+    volatile uint8_t pressed;
+    uint8_t debounced, suppressed;
+    uint16_t history[BUTTONS_NUM];
 
+    boolean debounce(uint8_t button);
     void read(uint8_t pcicr_bit);
 };
 
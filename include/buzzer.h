@@ -25,22 +25,10 @@
 #ifndef BUZZER_H__
 #define BUZZER_H__
 
-#include <Arduino.h>
-
-// Timer 2 channel B pin on Atmega328P
-#define _TIMER_2_B_PIN 3U
+#include "hal.h"
 
 #define _RESOLUTION 256U
 
-// Timer 2 prescalers from "Table 17-9. Clock Select Bit Description"
-#define _PRESCALER_1    _BV(CS20)
-#define _PRESCALER_8    _BV(CS21)
-#define _PRESCALER_32   _BV(CS21) | _BV(CS20)
-#define _PRESCALER_64   _BV(CS22)
-#define _PRESCALER_128  _BV(CS22) | _BV(CS20)
-#define _PRESCALER_256  _BV(CS22) | _BV(CS21)
-#define _PRESCALER_1024 _BV(CS22) | _BV(CS21) | _BV(CS20)
-
 class Buzzer {
   public:
     void init(void);
@@ -49,9 +37,9 @@ class Buzzer {
     void decay(void);
 
   private:
-    uint64_t decay_timer, chime_timer;
+    uint32_t decay_timer, chime_timer;
     uint16_t chime_note_duration;
-    uint8_t prescaler_bits;
+    uint8_t top;
     uint8_t attack_pwm_value, note_last, note_duration_divider, note_counter;
 
     void set_frequency(float frequency);
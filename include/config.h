@@ -25,7 +25,7 @@
 #ifndef CONFIG_H__
 #define CONFIG_H__
 
-#include <Arduino.h>
+#include "hal.h"
 
 // ----------------------- //
 // DC-DC Step-up converter //
@@ -41,22 +41,26 @@
 #if (_CONVERTER_CYCLES >= 65536UL)
 #error CONVERTER_FREQUENCY is too low
 #endif
-const uint32_t CONVERTER_PERIOD_CYCLES PROGMEM = _CONVERTER_CYCLES;
+constexpr uint32_t CONVERTER_PERIOD_CYCLES = _CONVERTER_CYCLES;
 // -------------------------------------------------------------
 
 // Target output voltage min-max (in Volts) 255 max. Final voltage will be edited using buttons within these margins
-const uint8_t CONVERTER_SETPOINT_MIN PROGMEM = 140.f;
-const uint8_t CONVERTER_SETPOINT_MAX PROGMEM = 180.f;
+constexpr uint8_t CONVERTER_SETPOINT_MIN = 140U;
+constexpr uint8_t CONVERTER_SETPOINT_MAX = 180U;
 
 // 0 to CONVERTER_SETPOINT time in milliseconds
-const uint64_t CONVERTER_SOFT_START_TIME PROGMEM = 1000UL;
+constexpr uint32_t CONVERTER_SOFT_START_TIME = 1000UL;
+
+// Converter is kept OFF for this time (in milliseconds) after startup while internal 1.1V reference charges AREF
+// capacitor (~32K internal resistance * 100nF = 3.2ms time constant)
+constexpr uint16_t CONVERTER_ADC_SETTLE_TIME = 20U;
 
 // Measured real 1.1V reference (in Volts)
-const float VREF_ACTUAL_MV PROGMEM = 1.106f;
+constexpr float VREF_ACTUAL_MV = 1.106f;
 
 // Measured resistances of voltage divider (in Ohms)
-const float CONVERTER_R_HIGH PROGMEM = 986000.f;
-const float CONVERTER_R_LOW PROGMEM = 4270.f;
+constexpr float CONVERTER_R_HIGH = 986000.f;
+constexpr float CONVERTER_R_LOW = 4270.f;
 
 // Uncomment PID_AUTO_TUNE to perform PID auto-tuning on startup
 // Connect your serial converter to TX pin of Atmega and listen on PID_AUTO_TUNE_BAUD_RATE
@@ -67,23 +71,23 @@ const float CONVERTER_R_LOW PROGMEM = 4270.f;
 #define PID_AUTO_TUNE_N_CYCLES  1000UL
 #define PID_AUTO_TUNE_SERIAL    Serial
 #define PID_AUTO_TUNE_BAUD_RATE 9600UL
-const float PID_P_GAIN PROGMEM = 0.f;
-const float PID_I_GAIN PROGMEM = 0.f;
-const float PID_D_GAIN PROGMEM = 0.f;
+constexpr float PID_P_GAIN = 0.f;
+constexpr float PID_I_GAIN = 0.f;
+constexpr float PID_D_GAIN = 0.f;
 #else
 // PID-controller gains
-const float PID_P_GAIN PROGMEM = 85.f;
-const float PID_I_GAIN PROGMEM = 11.4f;
-const float PID_D_GAIN PROGMEM = 0.f;
+constexpr float PID_P_GAIN = 85.f;
+constexpr float PID_I_GAIN = 11.4f;
+constexpr float PID_D_GAIN = 0.f;
 #endif
 
 // Limit PID output to 0% - 50% power
-const float PID_MIN_OUT PROGMEM = 0.f;
-const float PID_MAX_OUT PROGMEM = 512.f;
+constexpr float PID_MIN_OUT = 0.f;
+constexpr float PID_MAX_OUT = 512.f;
 
 // Limit to prevent integral windup
-const float PID_MIN_INTEGRAL PROGMEM = -1000.f;
-const float PID_MAX_INTEGRAL PROGMEM = 1000.f;
+constexpr float PID_MIN_INTEGRAL = -1000.f;
+constexpr float PID_MAX_INTEGRAL = 1000.f;
 
 // ------------------ //
 // Nixie multiplexing //
@@ -104,54 +108,252 @@ const float PID_MAX_INTEGRAL PROGMEM = 1000.f;
 #define TIMER0_PRESCALER _BV(CS01) | _BV(CS00)
 // -------------------------------------------------------------
 
+// -------- //
+// Settings //
+// -------- //
+
+// EEPROM region for settings records (each commit is written into the next record to spread the wear)
+#define SETTINGS_EEPROM_START 0U
+#define SETTINGS_EEPROM_SIZE  (E2END + 1U - SETTINGS_EEPROM_START)
+
+// Size of each record in bytes. Must be larger than settings data (+6 bytes). Smaller size -> more records -> less wear
+#define SETTINGS_SLOT_SIZE 64U
+
+// Settings will be written only after this time (in milliseconds) without any new changes
+constexpr uint16_t SETTINGS_COMMIT_DELAY = 5000U;
+
+// -------------- //
+// Config overlay //
+// -------------- //
+
+// Uncomment CONFIG_OVERLAY to be able to override values from CONFIG_OVERLAY_LIST at runtime with "cfg" console command
+// (overrides are stored with settings). Otherwise they are compile-time constants
+// #define CONFIG_OVERLAY
+
+// X(constant, console name, min, max) for each value that can be overridden. Read them with CONFIG(constant)
+#define CONFIG_OVERLAY_LIST(X)                                                                                         \
+    X(SEPARATOR_TIME, "sep_time", 10U, 990U)                                                                           \
+    X(ALARM_PREVIEW_TIME, "preview", 100U, 10000U)                                                                     \
+    X(ALARM_BLINK_RATE, "alm_blink", 20U, 5000U)                                                                       \
+    X(SET_BLINK_RATE, "set_blink", 20U, 5000U)                                                                         \
+    X(BTN_INC_DEC_DELAY_LOW, "btn_slow", 20U, 5000U)                                                                   \
+    X(BTN_INC_DEC_DELAY_HIGH, "btn_fast", 20U, 5000U)                                                                  \
+    X(BTN_INC_DEC_DELAY_TRANS_TIME, "btn_trans", 1U, 10000U)                                                           \
+    X(DECAY_TIME, "decay", 10U, 10000U)                                                                                \
+    X(BUTTON_NOTE_PWM, "btn_pwm", 1U, 254U)
+
+// -------- //
+// Watchdog //
+// -------- //
+
+// Comment WATCHDOG to disable hardware watchdog (ex. for debugging)
+// Watchdog is reset only when converter regulation, display interrupt and RTC update all checked in.
+// Otherwise converter will be turned OFF and MCU will be restarted
+// Reset cause is stored in settings (see "faults" console command)
+#define WATCHDOG
+
+// Must be longer than SQW period (1 second) with some margin
+#define WATCHDOG_TIMEOUT WDTO_4S
+
+// -------------------- //
+// Daylight saving time //
+// -------------------- //
+
+// Rules selected with "set dst <n>" console command (0 - no DST). With a rule, DS3231 keeps standard time and the clock
+// adds an hour while DST is in effect (so transitions don't need any writes and happen exactly at their hour).
+// Each rule is {start, end} of DST and each of them is {month, week (5 - last), day of week (0 - Sunday), hour}.
+// NOTE: Hours are in local standard time (ex. end at 03:00 DST is 2)
+const uint8_t DST_RULES[][2][4] PROGMEM = {
+    {{3U, 5U, 0U, 1U}, {10U, 5U, 0U, 1U}}, // 1: EU, Western European Time (01:00 UTC)
+    {{3U, 5U, 0U, 2U}, {10U, 5U, 0U, 2U}}, // 2: EU, Central European Time (01:00 UTC)
+    {{3U, 5U, 0U, 3U}, {10U, 5U, 0U, 3U}}, // 3: EU, Eastern European Time (01:00 UTC)
+    {{3U, 2U, 0U, 2U}, {11U, 1U, 0U, 1U}}, // 4: USA, Canada
+    {{10U, 1U, 0U, 2U}, {4U, 1U, 0U, 2U}}, // 5: Southeast Australia
+    {{9U, 5U, 0U, 2U}, {4U, 1U, 0U, 2U}},  // 6: New Zealand
+};
+constexpr uint8_t DST_RULES_N = sizeof(DST_RULES) / sizeof(DST_RULES[0]);
+
 // ------ //
 // Digits //
 // ------ //
 
 // How long to keep separator ON after a new second
-const uint16_t SEPARATOR_TIME PROGMEM = 250U;
+constexpr uint16_t SEPARATOR_TIME = 250U;
 
 // How long to show alarm preview after turning switch ON
-const uint16_t ALARM_PREVIEW_TIME PROGMEM = 1000U;
+constexpr uint16_t ALARM_PREVIEW_TIME = 1000U;
 
 // Hours and minutes will blink with this rate (in milliseconds) if alarm is active
-const uint16_t ALARM_BLINK_RATE PROGMEM = 100U;
+constexpr uint16_t ALARM_BLINK_RATE = 100U;
 
 // Hours or minutes will blink in set mode with this rate (in milliseconds)
-const uint16_t SET_BLINK_RATE PROGMEM = 250U;
+constexpr uint16_t SET_BLINK_RATE = 250U;
+
+// -------- //
+// Carousel //
+// -------- //
+
+// Uncomment to show CAROUSEL_PAGES every minute at CAROUSEL_SECOND without pressing WEATHER. Each page is shown for
+// CAROUSEL_PAGE_TIME (in milliseconds), then the clock returns to time. Tubes roll through their cathodes to the next
+// page (one cathode every CAROUSEL_ROLL_STEP milliseconds). Carousel is skipped while alarm is active
+// #define CAROUSEL
+constexpr uint8_t CAROUSEL_SECOND = 30U;
+constexpr uint16_t CAROUSEL_PAGE_TIME = 3000U;
+constexpr uint8_t CAROUSEL_ROLL_STEP = 30U;
+
+// Pages in order of appearance: temperature : humidity, day : month
+#define CAROUSEL_WEATHER 0U
+#define CAROUSEL_DATE    1U
+const uint8_t CAROUSEL_PAGES[] PROGMEM = {CAROUSEL_WEATHER, CAROUSEL_DATE};
+constexpr uint8_t CAROUSEL_PAGES_N = sizeof(CAROUSEL_PAGES);
+
+// ------------ //
+// Light sensor //
+// ------------ //
+
+// Uncomment LIGHT_SENSOR if LDR voltage divider is connected to PIN_LIGHT_SENSE (see pins.h). Brightness of the tubes
+// and the separator will follow ambient light. NOTE: ADC uses internal 1.1V reference, so divider must keep the
+// voltage below it (or light will be clipped at 1023)
+// #define LIGHT_SENSOR
+#ifdef LIGHT_SENSOR
+// Light is measured (between converter voltage measurements) with this interval (in milliseconds)
+constexpr uint16_t LIGHT_SAMPLE_INTERVAL = 50U;
+
+// Exponential filter. Each sample moves filtered value by 1 / 2^LIGHT_FILTER_SHIFT of the difference
+// (time constant is LIGHT_SAMPLE_INTERVAL * 2^LIGHT_FILTER_SHIFT)
+constexpr uint8_t LIGHT_FILTER_SHIFT = 4U;
+
+// Brightness is recalculated only after filtered light changes by at least this number of ADC counts
+constexpr uint16_t LIGHT_HYSTERESIS = 16U;
+
+// Brightness changes by 1/255 every LIGHT_FADE_STEP_TIME milliseconds until it reaches the new value from the curve
+constexpr uint8_t LIGHT_FADE_STEP_TIME = 4U;
+
+// {light (raw ADC value), tubes brightness, separator brightness} with ascending light. Brightness is 0-255
+// (tubes are never completely OFF) and is linearly interpolated between the points
+const uint16_t LIGHT_CURVE[][3] PROGMEM = {{0U, 8U, 64U}, {64U, 32U, 128U}, {256U, 128U, 255U}, {640U, 255U, 255U}};
+constexpr uint8_t LIGHT_CURVE_N = sizeof(LIGHT_CURVE) / sizeof(LIGHT_CURVE[0]);
+#endif
+
+// ---------- //
+// Night mode //
+// ---------- //
+
+// Night hours are set with "set night_on <hours>" and "set night_off <hours>" console commands (night starts at
+// night_on:00 and ends at night_off:00). Equal hours (default) disable night mode
+
+// Brightness of the tubes and the separator at night (0-255). 0 turns them OFF and also shuts converter down
+constexpr uint8_t NIGHT_BRIGHTNESS = 0U;
+
+// Any button wakes display at night for this time (in milliseconds) since it was released. The press that wakes the
+// display doesn't do anything else
+constexpr uint32_t NIGHT_WAKE_TIME = 10000UL;
+
+// Display wakes this number of minutes before the alarm (if alarm switch is ON), so converter is ready when it fires
+constexpr uint8_t NIGHT_ALARM_ADVANCE = 1U;
+
+// ---------- //
+// Tube hours //
+// ---------- //
+
+// Lit time of each tube (time it actually glows, weighted by brightness) is accumulated every
+// TUBE_HOURS_SAMPLE_INTERVAL (in milliseconds) and saved with settings every TUBE_HOURS_SAVE_INTERVAL
+// (in milliseconds). Settings are written into the next EEPROM slot each time, so hourly saves are spread across all
+// of them
+constexpr uint16_t TUBE_HOURS_SAMPLE_INTERVAL = 1000U;
+constexpr uint32_t TUBE_HOURS_SAVE_INTERVAL = 3600000UL;
+
+// Expected lit time of the tube (in hours). "tubes" console command reports tubes that reached TUBE_HOURS_WORN_PERCENT
+// of it
+constexpr uint16_t TUBE_HOURS_LIFETIME = 5000U;
+constexpr uint8_t TUBE_HOURS_WORN_PERCENT = 90U;
+
+// Uncomment to raise converter voltage by TUBE_HOURS_COMPENSATION_STEP Volts every TUBE_HOURS_COMPENSATION_HOURS of
+// average lit time (up to TUBE_HOURS_COMPENSATION_MAX Volts and CONVERTER_SETPOINT_MAX) to keep aging tubes bright
+// #define TUBE_HOURS_COMPENSATION
+constexpr uint8_t TUBE_HOURS_COMPENSATION_STEP = 1U;
+constexpr uint16_t TUBE_HOURS_COMPENSATION_HOURS = 500U;
+constexpr uint8_t TUBE_HOURS_COMPENSATION_MAX = 10U;
+
+// ---------------- //
+// Tube calibration //
+// ---------------- //
+
+// Hold WEATHER and press SET to match brightness of the tubes. Number of the selected tube is shown for
+// TUBE_TRIM_SELECT_TIME (in milliseconds), then all tubes show TUBE_TRIM_NUMBER. UP / DOWN make the selected tube
+// brighter / dimmer, SET selects the next one (or returns to the clock after the last one)
+constexpr uint8_t TUBE_TRIM_NUMBER = 0U;
+constexpr uint16_t TUBE_TRIM_SELECT_TIME = 1000U;
+
+// Max duty reduction of a tube. Relative duty of the tube is (255 - trim) / 255
+constexpr uint8_t TUBE_TRIM_MAX = 192U;
+
+// --------- //
+// Self-test //
+// --------- //
+
+// Uncomment to be able to check the tubes, shift registers and transistors with "test" console command. Each number of
+// each tube and the separator are lit alone for SELF_TEST_STEP_TIME (in milliseconds) and converter duty cycle is
+// averaged after SELF_TEST_SETTLE_TIME. Element that increases it (from the baseline without any lit elements) by less
+// than SELF_TEST_DUTY_THRESHOLD (0-1023) is reported as open (numbers also if they increase it by less than a half of
+// the maximum increase among them). Set threshold to 0 to only step through the elements
+// #define SELF_TEST
+constexpr uint16_t SELF_TEST_STEP_TIME = 400U;
+constexpr uint16_t SELF_TEST_SETTLE_TIME = 250U;
+constexpr uint8_t SELF_TEST_DUTY_THRESHOLD = 8U;
+
+// ------------ //
+// Self-heating //
+// ------------ //
+
+// Sensor is inside the case, so it reads higher temperature (and lower humidity) than ambient. Excess temperature
+// approaches HEATING_BASE + HEATING_CONVERTER * converter duty + HEATING_DISPLAY * display duty (duties are 0-1,
+// coefficients are in 0.1 degrees Celsius) with HEATING_TIME_CONSTANT (in minutes) since power-on. It's subtracted
+// from the measured temperature and humidity is recalculated for the corrected temperature. These are defaults of
+// heat_base, heat_conv, heat_disp and heat_tau settings: change them with "set" console command (0 - no heating) or
+// calibrate them against reference thermometer with "heat ref <degrees>" after 3 time constants of operation
+constexpr uint8_t HEATING_BASE = 5U;
+constexpr uint8_t HEATING_CONVERTER = 30U;
+constexpr uint8_t HEATING_DISPLAY = 10U;
+constexpr uint8_t HEATING_TIME_CONSTANT = 15U;
+
+// Model update interval (in milliseconds)
+constexpr uint16_t HEATING_UPDATE_INTERVAL = 1000U;
+
+// Calibration is refused until excess temperature reaches this part of its steady state value (0-1)
+constexpr float HEATING_SETTLED = .9f;
 
 // ------- //
 // Buttons //
 // ------- //
 
 // Time between increments / decrements
-const uint16_t BTN_INC_DEC_DELAY_LOW PROGMEM = 250U;
-const uint16_t BTN_INC_DEC_DELAY_HIGH PROGMEM = 70U;
+constexpr uint16_t BTN_INC_DEC_DELAY_LOW = 250U;
+constexpr uint16_t BTN_INC_DEC_DELAY_HIGH = 70U;
 
 // Transition time from pressing button (BTN_INC_DEC_DELAY_LOW) to BTN_INC_DEC_DELAY_HIGH
-const uint16_t BTN_INC_DEC_DELAY_TRANS_TIME PROGMEM = 2000U;
+constexpr uint16_t BTN_INC_DEC_DELAY_TRANS_TIME = 2000U;
 
 // ------ //
 // Buzzer //
 // ------ //
 
 // Base initial PWM value (attack) (velocity)
-const uint8_t BUZZER_PWM_START PROGMEM = 50U;
+constexpr uint8_t BUZZER_PWM_START = 50U;
 
 // How much can initial PWM value (attack) (velocity) deviate from BUZZER_PWM_START (+/-)
-// NOTE: BUZZER_PWM_START + BUZZER_PWM_DEVIATION must be less then 255
-// NOTE: BUZZER_PWM_START - BUZZER_PWM_DEVIATION must be greater then 0
-const uint8_t BUZZER_PWM_DEVIATION PROGMEM = 40U;
+// (BUZZER_PWM_START - BUZZER_PWM_DEVIATION must be > 0 and BUZZER_PWM_START + BUZZER_PWM_DEVIATION < 255)
+constexpr uint8_t BUZZER_PWM_DEVIATION = 40U;
 
 // Note decay to 0 time (in milliseconds)
-const uint16_t DECAY_TIME PROGMEM = 400U;
+constexpr uint16_t DECAY_TIME = 400U;
 
 // Tuning frequency (in Hz)
-const float A_BASE PROGMEM = 440.f;
+constexpr float A_BASE = 440.f;
 
 // 1/4, 1/8, 1/16, 1/32 (will be select randomly)
 const uint8_t NOTE_DURATION_DIVIDERS[] PROGMEM = {1U, 2U, 2U, 2U, 4U, 8U};
-const uint8_t NOTE_DURATION_DIVIDERS_N PROGMEM = 6U;
+constexpr uint8_t NOTE_DURATION_DIVIDERS_N = sizeof(NOTE_DURATION_DIVIDERS);
 
 // All the notes will be played randomly
 // D Major
@@ -160,20 +362,137 @@ const uint8_t NOTE_DURATION_DIVIDERS_N PROGMEM = 6U;
 // D Minor
 const uint8_t ALARM_CHIME_NOTES[] PROGMEM = {0U,  0U,  62U, 65U, 69U, 62U, 65U, 69U,
                                              86U, 88U, 89U, 91U, 93U, 94U, 96U, 98U};
-const uint8_t ALARM_CHIME_NOTES_N PROGMEM = 16U;
+constexpr uint8_t ALARM_CHIME_NOTES_N = sizeof(ALARM_CHIME_NOTES);
 
 // Main BPM (length of 1/4 note)
-const float ALARM_CHIME_BPM PROGMEM = 90.f;
+constexpr float ALARM_CHIME_BPM = 90.f;
 
 // Button sounds velocity
-const uint8_t BUTTON_NOTE_PWM = 10U;
+constexpr uint8_t BUTTON_NOTE_PWM = 10U;
 
 // Button sounds (MIDI notes)
-const uint8_t NOTE_INCREMENT = 91U;
-const uint8_t NOTE_DECREMENT = 88U;
-const uint8_t NOTE_TIME_MODE = 86U;
-const uint8_t NOTE_SET_MODE = 81U;
-const uint8_t NOTE_WEATHER_MODE PROGMEM = 93U;
-const uint8_t NOTE_ALARM_ON PROGMEM = 81U;
+constexpr uint8_t NOTE_INCREMENT = 91U;
+constexpr uint8_t NOTE_DECREMENT = 88U;
+constexpr uint8_t NOTE_TIME_MODE = 86U;
+constexpr uint8_t NOTE_SET_MODE = 81U;
+constexpr uint8_t NOTE_WEATHER_MODE = 93U;
+constexpr uint8_t NOTE_ALARM_ON = 81U;
+
+// ------- //
+// Console //
+// ------- //
+
+// Comment CONSOLE to disable serial console (saves ~200 bytes of RAM). Type "help" to see all commands
+#define CONSOLE
+#ifdef CONSOLE
+#define CONSOLE_SERIAL    Serial
+#define CONSOLE_BAUD_RATE 9600UL
+
+// Maximum length of the command line (including arguments)
+#define CONSOLE_LINE_LENGTH 32U
+
+// Maximum number of arguments (including command itself)
+#define CONSOLE_ARGS_MAX 4U
+
+// Maximum number of received characters to handle per one main loop cycle
+#define CONSOLE_CHARS_PER_LOOP 8U
+
+// Next line of response will be printed only if there is at least this number of free bytes in the TX buffer
+#define CONSOLE_TX_FREE 48U
+#endif
+
+// -------- //
+// Profiler //
+// -------- //
+
+// Uncomment PROFILER (or build uno_profiler environment) to measure main loop timings. Don't use it in release builds
+// Use "prof" console command or (if CONSOLE is disabled) send PROFILER_REPORT_CHAR to the PROFILER_SERIAL
+// to print and reset histograms
+// #define PROFILER
+#ifdef PROFILER
+#define PROFILER_SERIAL      Serial
+#define PROFILER_BAUD_RATE   115200UL
+#define PROFILER_REPORT_CHAR 'p'
+#endif
+
+// -------- //
+// Recorder //
+// -------- //
+
+// Uncomment RECORDER (or build uno_recorder environment) to record input events (debounced buttons, SQW ticks,
+// sensor samples and ADC snapshots) into RAM ring. Use "rec" console command to dump it and "replay" command
+// of the native simulator to reproduce it
+// #define RECORDER
+#ifdef RECORDER
+// Size of the ring (7 bytes per event). Consecutive SQW ticks take only one event
+#define RECORDER_EVENTS 32U
+
+// Minimal interval between recorded sensor samples and ADC snapshots (ms)
+#define RECORDER_SENSOR_INTERVAL 30000UL
+#define RECORDER_ADC_INTERVAL    30000UL
+#endif
+
+// ---------- //
+// Validation //
+// ---------- //
+
+// Don't touch the code below unless you know what you are doing
+// -------------------------------------------------------------
+static_assert(CONVERTER_SETPOINT_MIN > 0U && CONVERTER_SETPOINT_MIN < CONVERTER_SETPOINT_MAX,
+              "CONVERTER_SETPOINT_MIN must be within 1 - CONVERTER_SETPOINT_MAX");
+static_assert(CONVERTER_SETPOINT_MAX < VREF_ACTUAL_MV * (CONVERTER_R_LOW + CONVERTER_R_HIGH) / CONVERTER_R_LOW,
+              "CONVERTER_SETPOINT_MAX is out of the voltage divider's measurement range");
+static_assert(CONVERTER_SOFT_START_TIME > CONVERTER_ADC_SETTLE_TIME,
+              "CONVERTER_SOFT_START_TIME must be longer than CONVERTER_ADC_SETTLE_TIME");
+static_assert(VREF_ACTUAL_MV >= 1.f && VREF_ACTUAL_MV <= 1.2f, "VREF_ACTUAL_MV must be within 1.0 - 1.2 V");
+static_assert(CONVERTER_R_HIGH > 0.f && CONVERTER_R_LOW > 0.f, "Voltage divider resistances must be positive");
+static_assert(PID_MIN_OUT >= 0.f && PID_MIN_OUT < PID_MAX_OUT && PID_MAX_OUT <= 1024.f,
+              "PID output must be within 0 - 1024 (0% - 100% power)");
+static_assert(PID_MIN_INTEGRAL < PID_MAX_INTEGRAL, "PID_MIN_INTEGRAL must be less than PID_MAX_INTEGRAL");
+static_assert(DST_RULES_N < 255U, "Too many DST_RULES");
+#ifdef CAROUSEL
+static_assert(CAROUSEL_PAGES_N > 0U && CAROUSEL_PAGE_TIME > 0U && CAROUSEL_ROLL_STEP > 0U,
+              "CAROUSEL_PAGES, CAROUSEL_PAGE_TIME and CAROUSEL_ROLL_STEP must not be empty");
+static_assert(CAROUSEL_SECOND + (CAROUSEL_PAGES_N * (uint32_t) CAROUSEL_PAGE_TIME +
+                                 (CAROUSEL_PAGES_N + 1UL) * 10UL * CAROUSEL_ROLL_STEP + 999UL) /
+                                    1000UL <
+                  58U,
+              "Carousel must end before the wave (58th second)");
+#endif
+#ifdef LIGHT_SENSOR
+static_assert(LIGHT_SAMPLE_INTERVAL > 0U, "LIGHT_SAMPLE_INTERVAL must be greater than 0");
+static_assert(LIGHT_FILTER_SHIFT <= 6U, "LIGHT_FILTER_SHIFT must be within 0 - 6 (filter sum must fit 16 bits)");
+static_assert(LIGHT_CURVE_N >= 2U, "LIGHT_CURVE must have at least 2 points");
+#endif
+static_assert(NIGHT_WAKE_TIME > 0UL, "NIGHT_WAKE_TIME must be greater than 0");
+static_assert(NIGHT_ALARM_ADVANCE < 60U, "NIGHT_ALARM_ADVANCE must be within 0 - 59 minutes");
+static_assert(TUBE_HOURS_SAMPLE_INTERVAL > 0U, "TUBE_HOURS_SAMPLE_INTERVAL must be greater than 0");
+static_assert(TUBE_HOURS_SAVE_INTERVAL >= 60000UL, "TUBE_HOURS_SAVE_INTERVAL must be at least 1 minute");
+static_assert(TUBE_HOURS_LIFETIME > 0U, "TUBE_HOURS_LIFETIME must be greater than 0");
+static_assert(TUBE_HOURS_WORN_PERCENT > 0U && TUBE_HOURS_WORN_PERCENT <= 100U,
+              "TUBE_HOURS_WORN_PERCENT must be within 1 - 100");
+static_assert(TUBE_HOURS_COMPENSATION_HOURS > 0U, "TUBE_HOURS_COMPENSATION_HOURS must be greater than 0");
+static_assert(TUBE_TRIM_NUMBER < 10U, "TUBE_TRIM_NUMBER must be within 0 - 9");
+static_assert(TUBE_TRIM_MAX < 255U, "TUBE_TRIM_MAX must be less than 255");
+static_assert(SELF_TEST_SETTLE_TIME < SELF_TEST_STEP_TIME,
+              "SELF_TEST_SETTLE_TIME must be less than SELF_TEST_STEP_TIME");
+static_assert(HEATING_TIME_CONSTANT > 0U, "HEATING_TIME_CONSTANT must be greater than 0");
+static_assert(HEATING_UPDATE_INTERVAL > 0U && HEATING_UPDATE_INTERVAL < 60000U,
+              "HEATING_UPDATE_INTERVAL must be within 1 - 59999 ms");
+static_assert(HEATING_SETTLED > 0.f && HEATING_SETTLED < 1.f, "HEATING_SETTLED must be within 0 - 1 (exclusive)");
+static_assert(SETTINGS_COMMIT_DELAY > 0U, "SETTINGS_COMMIT_DELAY must be greater than 0");
+static_assert(BTN_INC_DEC_DELAY_HIGH <= BTN_INC_DEC_DELAY_LOW,
+              "BTN_INC_DEC_DELAY_HIGH must not be longer than BTN_INC_DEC_DELAY_LOW");
+static_assert(BUZZER_PWM_DEVIATION < BUZZER_PWM_START && BUZZER_PWM_START + BUZZER_PWM_DEVIATION < 255U,
+              "BUZZER_PWM_START +/- BUZZER_PWM_DEVIATION must be within 1 - 254");
+static_assert(A_BASE > 0.f && ALARM_CHIME_BPM > 0.f, "A_BASE and ALARM_CHIME_BPM must be positive");
+static_assert(NOTE_INCREMENT < 128U && NOTE_DECREMENT < 128U && NOTE_TIME_MODE < 128U && NOTE_SET_MODE < 128U &&
+                  NOTE_WEATHER_MODE < 128U && NOTE_ALARM_ON < 128U,
+              "Button sounds must be MIDI notes (0 - 127)");
+#define _CONFIG_VALIDATE(constant, name, min, max)                                                                     \
+    static_assert(constant >= min && constant <= max, #constant " is out of its overlay range");
+CONFIG_OVERLAY_LIST(_CONFIG_VALIDATE)
+#undef _CONFIG_VALIDATE
+// -------------------------------------------------------------
 
 #endif
@@ -0,0 +1,106 @@
+/**
+ * @file console.h
+ * @author Fern Lane
+ * @brief Non-blocking serial command console for configuration and diagnostics
+ *
+ * @copyright Copyright (c) 2024 Fern Lane
+ *
+ * This file is part of the in17clock distribution.
+ * See <https://github.com/F33RNI/in17clock> for more info.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * long with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CONSOLE_H__
+#define CONSOLE_H__
+
+#include "hal.h"
+
+#include "config.h"
+
+#ifdef CONSOLE
+
+// Prints one line of the response. Must return true if there are more lines to print (step will be incremented)
+typedef boolean (*ConsoleHandler)(uint8_t step);
+
+struct ConsoleCommand {
+    char name[8];
+    ConsoleHandler handler;
+};
+
+// Setting that can be accessed with get / set commands (single byte of SettingsData)
+struct ConsoleSetting {
+    char name[10];
+    uint8_t offset;
+    uint8_t min, max;
+};
+
+class Console {
+  public:
+    void init(void);
+    void update(void);
+
+  private:
+    char line[CONSOLE_LINE_LENGTH];
+    char *args[CONSOLE_ARGS_MAX];
+    uint8_t line_length, args_n, step;
+    boolean line_overflow;
+    ConsoleHandler handler;
+
+    static const ConsoleCommand commands[];
+    static const ConsoleSetting settings_list[];
+
+    void execute(void);
+    static boolean parse_number(const char *arg, uint8_t min, uint8_t max, uint8_t *number);
+    static boolean parse_number(const char *arg, uint16_t min, uint16_t max, uint16_t *number);
+    static void print_two_digits(uint8_t number);
+    static void print_ok(void);
+    static void print_error(void);
+
+    static boolean cmd_help(uint8_t step);
+    static boolean cmd_get(uint8_t step);
+    static boolean cmd_set(uint8_t step);
+    static boolean cmd_save(uint8_t step);
+    static boolean cmd_time(uint8_t step);
+    static boolean cmd_date(uint8_t step);
+    static boolean cmd_alarm(uint8_t step);
+    static boolean cmd_power(uint8_t step);
+    static boolean cmd_sensor(uint8_t step);
+    static boolean cmd_faults(uint8_t step);
+    static boolean cmd_mem(uint8_t step);
+    static boolean cmd_boot(uint8_t step);
+    static boolean cmd_tubes(uint8_t step);
+    static boolean cmd_heat(uint8_t step);
+#ifdef CONFIG_OVERLAY
+    static boolean cmd_cfg(uint8_t step);
+#endif
+#ifdef LIGHT_SENSOR
+    static boolean cmd_light(uint8_t step);
+#endif
+#ifdef PROFILER
+    static boolean cmd_prof(uint8_t step);
+#endif
+#ifdef RECORDER
+    static boolean cmd_rec(uint8_t step);
+#endif
+#ifdef SELF_TEST
+    static boolean cmd_test(uint8_t step);
+#endif
+};
+
+extern Console console;
+
+#endif
+
+#endif
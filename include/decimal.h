@@ -0,0 +1,88 @@
+/**
+ * @file decimal.h
+ * @author Fern Lane
+ * @brief Fast decimal digits decomposition (division by 10 as multiplication by reciprocal and shift)
+ *
+ * AVR has no division instruction, so x / 10 and x % 10 are calls to libgcc's bit-by-bit division loops.
+ * Here quotient is computed with hardware multiplier instead: x * ceil(2^n / 10) >> n which is exact for the whole
+ * range of the argument type. Remainder is x - quotient * 10
+ *
+ * @copyright Copyright (c) 2024 Fern Lane
+ *
+ * This file is part of the in17clock distribution.
+ * See <https://github.com/F33RNI/in17clock> for more info.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * long with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef DECIMAL_H__
+#define DECIMAL_H__
+
+#include <stdint.h>
+
+/**
+ * @param value 0-255
+ * @return uint8_t value / 10 ((value * 205) >> 11, exact for 0-1028)
+ */
+static inline uint8_t decimal_div10(uint8_t value) { return (uint8_t) (((uint16_t) value * 205U) >> 11U); }
+
+/**
+ * @param value 0-65535
+ * @return uint16_t value / 10 ((value * 52429) >> 19, exact for 0-81919)
+ */
+static inline uint16_t decimal_div10_16(uint16_t value) { return (uint16_t) (((uint32_t) value * 52429UL) >> 19U); }
+
+/**
+ * @brief Splits 8-bit value into decimal digits
+ *
+ * @param value 0-255
+ * @param digits hundreds, tens and ones
+ */
+static inline void decimal_split(uint8_t value, uint8_t digits[3]) {
+    uint8_t tens = decimal_div10(value);
+    digits[2] = value - tens * 10U;
+    digits[0] = decimal_div10(tens);
+    digits[1] = tens - digits[0] * 10U;
+}
+
+/**
+ * @brief Splits two 2-digit numbers (ex. hours and minutes) into digits of the left and right pair of tubes
+ *
+ * @param left 0-99
+ * @param right 0-99
+ * @param digits left tens, left ones, right tens and right ones
+ */
+static inline void decimal_split_pair(uint8_t left, uint8_t right, uint8_t digits[4]) {
+    digits[0] = decimal_div10(left);
+    digits[1] = left - digits[0] * 10U;
+    digits[2] = decimal_div10(right);
+    digits[3] = right - digits[2] * 10U;
+}
+
+/**
+ * @brief Splits 16-bit value into decimal digits
+ *
+ * @param value 0-65535
+ * @param digits ten thousands, thousands, hundreds, tens and ones
+ */
+static inline void decimal_split_16(uint16_t value, uint8_t digits[5]) {
+    for (uint8_t i = 4U; i > 0U; --i) {
+        uint16_t quotient = decimal_div10_16(value);
+        digits[i] = (uint8_t) (value - quotient * 10U);
+        value = quotient;
+    }
+    digits[0] = (uint8_t) value;
+}
+
+#endif
@@ -25,8 +25,7 @@
 #ifndef DIGITS_H__
 #define DIGITS_H__
 
-#include <Arduino.h>
-#include <SPI.h>
+#include "hal.h"
 
 #include "config.h"
 
@@ -37,17 +36,33 @@ class Digits {
   public:
     void init(void);
     void set(uint8_t digit_1 = 255U, uint8_t digit_2 = 255U, uint8_t digit_3 = 255U, uint8_t digit_4 = 255U);
+    void set_pair(uint8_t left, uint8_t right, boolean left_on = true, boolean right_on = true);
     void set_separator(boolean state);
+    void set_brightness(uint8_t tubes, uint8_t separator);
+    void set_brightness_limit(uint8_t limit);
+    void set_trims(const uint8_t trims[4]);
+    uint8_t get_on_time(uint8_t tube);
+    uint8_t get_load(void);
+    void set_test(uint8_t anode, uint8_t number, boolean separator);
+    void stop_test(void);
+    uint16_t take_lit_slots(uint8_t tube);
+    uint16_t get_boot_time(void);
     static void _isr_callback(void);
+    static void _dim_callback(void);
 
   private:
-    SPISettings spi_settings;
-    volatile uint8_t current_numbers[4], digit_counter;
-    volatile boolean current_separator_state;
-    volatile uint8_t latch_pin_mask, *latch_pin_p_out;
+    volatile uint8_t current_numbers[4], digit_counter, separator_slots;
+    volatile boolean current_separator_state, slot_separator, testing, test_separator;
+    volatile uint8_t test_anode, test_number;
+    uint8_t brightness_tubes, brightness_separator, trims[4];
+    volatile uint8_t brightness_limit, slot_on_times[4], dim_on_time, dim_on_time_next;
+    volatile uint16_t lit_slots[4];
+    uint16_t boot_time;
 
     void write(uint8_t anode, uint8_t number, boolean separator = false);
     void isr_callback_handler(void);
+    void dim_callback_handler(void);
+    void apply_brightness(void);
 };
 
 extern Digits digits;
@@ -0,0 +1,136 @@
+/**
+ * @file hal.h
+ * @author Fern Lane
+ * @brief Thin hardware abstraction layer (timers, GPIO, ADC, SPI, TWI, EEPROM, watchdog, time, memory)
+ * See hal_avr.cpp for Atmega328P implementation and native/ directory for Linux mock
+ *
+ * @copyright Copyright (c) 2024 Fern Lane
+ *
+ * This file is part of the in17clock distribution.
+ * See <https://github.com/F33RNI/in17clock> for more info.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * long with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef HAL_H__
+#define HAL_H__
+
+#ifdef __AVR__
+#include <Arduino.h>
+#include <avr/wdt.h>
+#include <util/atomic.h>
+#include <util/crc16.h>
+#else
+#include "../native/native.h"
+#endif
+
+// Real multiplexing slot rate in Hz (Arduino core and native mock keep Timer 0 in fast PWM mode with 256 ticks
+// period, bare-metal HAL runs it in CTC mode at MULTIPLEXING_FREQUENCY)
+#if defined(__AVR__) && defined(HAL_BARE_METAL)
+#define HAL_MULTIPLEX_FREQUENCY ((float) MULTIPLEXING_FREQUENCY)
+#else
+#define HAL_MULTIPLEX_FREQUENCY (F_CPU / 64.f / 256.f)
+#endif
+
+// Reset causes (same bits as in MCUSR)
+#define HAL_RESET_POWER     0x01U
+#define HAL_RESET_EXTERNAL  0x02U
+#define HAL_RESET_BROWN_OUT 0x04U
+#define HAL_RESET_WATCHDOG  0x08U
+
+// Timer 2 prescalers (clock select values from "Table 17-9. Clock Select Bit Description")
+#define HAL_TIMER_2_PRESCALER_1    1U
+#define HAL_TIMER_2_PRESCALER_8    2U
+#define HAL_TIMER_2_PRESCALER_32   3U
+#define HAL_TIMER_2_PRESCALER_64   4U
+#define HAL_TIMER_2_PRESCALER_128  5U
+#define HAL_TIMER_2_PRESCALER_256  6U
+#define HAL_TIMER_2_PRESCALER_1024 7U
+
+typedef void (*HALCallback)(void);
+typedef void (*HALPinChangeCallback)(uint8_t group);
+
+class HAL {
+  public:
+    // Time
+    uint32_t millis(void);
+    uint32_t micros(void);
+    void delay(uint32_t milliseconds);
+
+    // GPIO and pin interrupts
+    void pin_output(uint8_t pin);
+    void pin_input_pullup(uint8_t pin);
+    void pin_write(uint8_t pin, boolean state);
+    boolean pin_read(uint8_t pin);
+    uint8_t pin_change_group(uint8_t pin);
+    void pin_change_attach(uint8_t pin, HALPinChangeCallback callback);
+    void external_interrupt_attach(uint8_t pin, HALCallback callback);
+
+    // Timer 0 compare interrupts (multiplexing and dimming inside each multiplexing slot)
+    void multiplex_timer_init(HALCallback callback);
+    void multiplex_dim_init(HALCallback callback);
+    void multiplex_dim_write(uint8_t on_time, uint8_t on_time_next);
+
+    // Timer 1 PWM on pin 9 (DC-DC converter)
+    void converter_pwm_init(uint16_t period_cycles, boolean inverted);
+    void converter_pwm_write(uint16_t compare);
+    void converter_pwm_stop(void);
+    void converter_pwm_start(void);
+
+    // Timer 2 PWM on pin 3 (buzzer)
+    void buzzer_pwm_init(void);
+    void buzzer_pwm_frequency(uint8_t prescaler, uint8_t top);
+    void buzzer_pwm_write(uint8_t compare);
+
+    // ADC with internal reference
+    void adc_init(void);
+    uint16_t adc_read(uint8_t pin);
+
+    // SPI with latch pin (shift registers)
+    void spi_init(uint8_t latch_pin);
+    void spi_write_word(uint16_t data);
+
+    // TWI (I2C) master
+    void twi_init(void);
+    uint8_t twi_write(uint8_t address, const uint8_t *data, uint8_t length);
+    uint8_t twi_read(uint8_t address, uint8_t *data, uint8_t length);
+
+    // EEPROM
+    uint8_t eeprom_read(uint16_t address);
+    void eeprom_update(uint16_t address, uint8_t value);
+    boolean eeprom_ready(void);
+
+    // Watchdog
+    uint8_t reset_cause(void);
+    void watchdog_enable(uint8_t timeout, HALCallback callback);
+    void watchdog_reset(void);
+    void watchdog_restart(void);
+
+    // SRAM usage (free SRAM is painted at startup to find the deepest stack usage)
+    uint16_t memory_static(void);
+    uint16_t memory_heap(void);
+    uint16_t memory_stack_free(void);
+    uint16_t memory_stack_free_min(void);
+
+#ifdef __AVR__
+  private:
+    // Arduino pin number -> PORTx register and bit mask
+    static volatile uint8_t *pin_port(uint8_t pin);
+    static uint8_t pin_mask(uint8_t pin);
+#endif
+};
+
+extern HAL hal;
+
+#endif
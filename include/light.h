@@ -0,0 +1,53 @@
+/**
+ * @file light.h
+ * @author Fern Lane
+ * @brief Ambient light (LDR) measurement and automatic brightness of the tubes and the separator
+ *
+ * @copyright Copyright (c) 2024 Fern Lane
+ *
+ * This file is part of the in17clock distribution.
+ * See <https://github.com/F33RNI/in17clock> for more info.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * long with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef LIGHT_H__
+#define LIGHT_H__
+
+#include "hal.h"
+
+#include "config.h"
+
+#ifdef LIGHT_SENSOR
+class Light {
+  public:
+    void init(void);
+    void update(void);
+    uint16_t get_light(void);
+    uint8_t get_tubes(void);
+    uint8_t get_separator(void);
+
+  private:
+    // Filtered light << LIGHT_FILTER_SHIFT and light that was used to calculate the current target brightness
+    uint16_t filtered, light_applied;
+    uint8_t tubes, separator, tubes_target, separator_target;
+    uint32_t sample_timer, fade_timer;
+
+    void apply(uint16_t light_value);
+};
+
+extern Light light;
+#endif
+
+#endif
@@ -0,0 +1,47 @@
+/**
+ * @file night.h
+ * @author Fern Lane
+ * @brief Scheduled night mode: dims (or turns off) the tubes and shuts converter down during night hours
+ *
+ * @copyright Copyright (c) 2024 Fern Lane
+ *
+ * This file is part of the in17clock distribution.
+ * See <https://github.com/F33RNI/in17clock> for more info.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * long with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef NIGHT_H__
+#define NIGHT_H__
+
+#include "hal.h"
+
+#include "config.h"
+
+class Night {
+  public:
+    void update(void);
+    boolean is_sleeping(void);
+
+  private:
+    boolean sleeping, awake;
+    uint32_t wake_timer;
+
+    boolean is_night(void);
+    boolean is_alarm_near(void);
+};
+
+extern Night night;
+
+#endif
@@ -25,7 +25,7 @@
 #ifndef PINS_H__
 #define PINS_H__
 
-#include <Arduino.h>
+#include "hal.h"
 
 // --------------- //
 // Shift registers //
@@ -69,6 +69,13 @@ const uint8_t NUMBER_TO_POSITION[] PROGMEM = {4U, 0U, 2U, 6U, 8U, 9U, 5U, 1U, 3U
 // Voltage divider feedback pin
 const uint8_t CONVERTER_SENSE_PIN PROGMEM = A0;
 
+// ------------ //
+// Light sensor //
+// ------------ //
+
+// LDR voltage divider (analog pin). Used only if LIGHT_SENSOR is enabled in config.h
+const uint8_t PIN_LIGHT_SENSE PROGMEM = A6;
+
 // ---------- //
 // DS3231 RTC //
 // ---------- //
@@ -25,29 +25,36 @@
 #ifndef POWER_H__
 #define POWER_H__
 
-#include <Arduino.h>
+#include "hal.h"
 
 #include "../lib/PetalPID/src/PetalPID.h"
 
 #include "config.h"
 
-// Timer 1 channel A pin on Atmega328P
-#define _TIMER_1_A_PIN 9U
-
 class Power {
   public:
     void init(void);
     void set_voltage(uint8_t voltage);
     uint8_t get_voltage(void);
+    float get_measured_voltage(void);
+    uint8_t get_setpoint_current(void);
+    uint16_t get_duty_cycle(void);
+    uint16_t get_ready_time(void);
     void regulate(void);
+    void set_sleep(boolean sleep);
+    void set_compensation(uint8_t volts);
+    void stop(void);
 
   private:
     PetalPID pid;
     float voltage;
-    uint8_t setpoint, setpoint_temp;
-    uint64_t time_started;
+    uint8_t setpoint, setpoint_temp, compensation;
+    uint16_t duty_cycle, ready_time;
+    uint32_t time_started;
+    volatile boolean sleeping, stopped;
     void measure_voltage();
     void set_duty_cycle(uint16_t duty_cycle);
+    void reset_pid(void);
 #ifdef PID_AUTO_TUNE
     boolean auto_tune_reported;
 #endif
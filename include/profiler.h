@@ -0,0 +1,79 @@
+/**
+ * @file profiler.h
+ * @author Fern Lane
+ * @brief Main loop latency profiler with per-section histograms
+ *
+ * @copyright Copyright (c) 2024 Fern Lane
+ *
+ * This file is part of the in17clock distribution.
+ * See <https://github.com/F33RNI/in17clock> for more info.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * long with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PROFILER_H__
+#define PROFILER_H__
+
+#include "hal.h"
+
+#include "config.h"
+
+// Measured sections
+#define PROFILER_LOOP     0U
+#define PROFILER_POWER    1U
+#define PROFILER_SENSOR   2U
+#define PROFILER_RTC      3U
+#define PROFILER_UI       4U
+#define PROFILER_BUZZER   5U
+#define PROFILER_SETTINGS 6U
+#define PROFILER_CONSOLE  7U
+#define PROFILER_SECTIONS 8U
+
+// Histogram buckets. Bucket N counts durations below (64 << N) microseconds, the last one counts everything else
+#define PROFILER_BUCKETS        8U
+#define PROFILER_BUCKET_0_SHIFT 6U
+
+#ifdef PROFILER
+// Starts measuring into the new local variable
+#define PROFILE_BEGIN(var) uint32_t var = hal.micros()
+
+// Records time since PROFILE_BEGIN() (or previous PROFILE_END() with the same variable) and restarts measuring
+#define PROFILE_END(section, var)                                                                                      \
+    {                                                                                                                  \
+        uint32_t _profile_now = hal.micros();                                                                          \
+        profiler.record(section, _profile_now - var);                                                                  \
+        var = _profile_now;                                                                                            \
+    }
+
+class Profiler {
+  public:
+    void init(void);
+    void record(uint8_t section, uint32_t duration);
+    boolean report(Print &output, uint8_t line);
+    void reset(void);
+    void update(void);
+
+  private:
+    uint16_t histogram[PROFILER_SECTIONS][PROFILER_BUCKETS];
+    uint16_t duration_max[PROFILER_SECTIONS];
+};
+
+extern Profiler profiler;
+
+#else
+#define PROFILE_BEGIN(var)
+#define PROFILE_END(section, var)
+#endif
+
+#endif
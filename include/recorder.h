@@ -0,0 +1,89 @@
+/**
+ * @file recorder.h
+ * @author Fern Lane
+ * @brief Records timestamped input events (debounced buttons, SQW ticks, sensor samples, ADC snapshots) into RAM ring
+ * Dump it with "rec" console command and replay it with "replay" command of the native simulator
+ *
+ * @copyright Copyright (c) 2024 Fern Lane
+ *
+ * This file is part of the in17clock distribution.
+ * See <https://github.com/F33RNI/in17clock> for more info.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * long with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef RECORDER_H__
+#define RECORDER_H__
+
+#include "hal.h"
+
+#include "config.h"
+
+// Event types and their data
+#define RECORDER_EVENT_BUTTON 1U // Button index (BUTTON_... from buttons.h), debounced state
+#define RECORDER_EVENT_SQW    2U // Hours, minutes, seconds after the tick (repeat = number of next ticks 1s apart)
+#define RECORDER_EVENT_SENSOR 3U // Temperature in 0.01C (int16, LSB first), humidity in %
+#define RECORDER_EVENT_ADC    4U // Converter sense pin ADC value (uint16, LSB first)
+
+// Period of SQW ticks in milliseconds
+#define RECORDER_SQW_PERIOD 1000UL
+
+#ifdef RECORDER
+#define RECORD_BUTTON(index, state)              recorder.button(index, state)
+#define RECORD_SQW(hours, minutes, seconds)      recorder.sqw(hours, minutes, seconds)
+#define RECORD_SENSOR(temperature_100, humidity) recorder.sensor(temperature_100, humidity)
+#define RECORD_ADC(value)                        recorder.adc(value)
+
+struct __attribute__((packed)) RecorderEvent {
+    uint16_t delta; // Milliseconds since previous event (or its last repeat). Saturated at 65535
+    uint8_t type;
+    uint8_t repeat;
+    uint8_t data[3];
+};
+
+class Recorder {
+  public:
+    void button(uint8_t index, boolean state);
+    void sqw(uint8_t hours, uint8_t minutes, uint8_t seconds);
+    void sensor(int16_t temperature_100, uint8_t humidity);
+    void adc(uint16_t value);
+    boolean dump(Print &output, uint8_t line);
+    void clear(void);
+
+  private:
+    RecorderEvent events[RECORDER_EVENTS];
+    uint8_t head, count;
+    uint16_t dropped;
+    boolean dumping;
+
+    // Time before the oldest event and time of the last event (including its repeats) as they will be dumped
+    uint32_t time_base, time_last;
+
+    uint32_t sensor_timer, adc_timer;
+    int16_t temperature_last;
+    uint8_t humidity_last;
+
+    void record(uint8_t type, uint8_t data_0, uint8_t data_1, uint8_t data_2);
+};
+
+extern Recorder recorder;
+
+#else
+#define RECORD_BUTTON(index, state)
+#define RECORD_SQW(hours, minutes, seconds)
+#define RECORD_SENSOR(temperature_100, humidity)
+#define RECORD_ADC(value)
+#endif
+
+#endif
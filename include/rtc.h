@@ -25,28 +25,45 @@
 #ifndef RTC_H__
 #define RTC_H__
 
-#include <Arduino.h>
-#include <Wire.h>
-#include <util/atomic.h>
+#include "hal.h"
 
 #define REGISTER_TIME    0x00
+#define REGISTER_DATE    0x04
 #define REGISTER_CONTROL 0x0E
 
 class RTC {
   public:
     void init(void);
+    boolean probe(void);
     void set(uint8_t hours, uint8_t minutes, uint8_t seconds);
+    void set_date(uint8_t day, uint8_t month, uint8_t year);
     void read(void);
     uint8_t get_hours(void), get_minutes(void), get_seconds(void);
+    uint8_t get_day(void), get_month(void), get_year(void);
+    boolean is_dst(void), is_repeated_hour(void);
+    uint8_t get_skipped_hour(void);
+    uint16_t get_bus_errors(void);
     boolean get_interrupt(void);
     void clear_interrupt(void);
     static inline uint8_t bcd_to_dec(uint8_t bcd);
     static inline uint8_t dec_to_bcd(uint8_t dec);
+    static uint8_t days_in_month(uint8_t month, uint8_t year);
+    static uint8_t day_of_week(uint8_t day, uint8_t month, uint8_t year);
 
   private:
     volatile uint8_t hours_raw, minutes_raw, seconds_raw;
+    uint8_t day_raw, month_raw, year_raw;
+    uint16_t bus_errors;
     volatile boolean interrupt;
 
+    // Standard hour and rule of the last DST evaluation and its result
+    uint8_t dst_hours_raw, dst_rule, skipped_hour;
+    boolean dst, repeated_hour;
+
+    void apply_dst(void);
+    boolean local_to_standard(uint8_t *hours, uint8_t *day, uint8_t *month, uint8_t *year);
+    static boolean is_dst_at(uint8_t rule, uint8_t hours, uint8_t day, uint8_t month, uint8_t year);
+    static uint16_t rule_instant(uint8_t rule, uint8_t edge, uint8_t year);
     static void sqw_callback(void);
 };
 
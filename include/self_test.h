@@ -0,0 +1,56 @@
+/**
+ * @file self_test.h
+ * @author Fern Lane
+ * @brief Tube and shift registers self-test: lights every element alone and detects open ones from converter duty cycle
+ *
+ * @copyright Copyright (c) 2024 Fern Lane
+ *
+ * This file is part of the in17clock distribution.
+ * See <https://github.com/F33RNI/in17clock> for more info.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * long with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SELF_TEST_H__
+#define SELF_TEST_H__
+
+#include "hal.h"
+
+#include "config.h"
+
+#ifdef SELF_TEST
+class SelfTest {
+  public:
+    void start(void);
+    void update(void);
+    boolean is_running(void);
+    boolean report(Print &output, uint8_t line);
+
+  private:
+    uint8_t step;
+    boolean running, done;
+    uint32_t step_timer, duty_sum;
+    uint16_t duty_samples, duty_baseline;
+
+    // Increase of converter duty cycle (0-1023) from baseline when the element is lit
+    uint8_t deltas[4][10], delta_separator, delta_max;
+
+    boolean is_open(uint8_t anode, uint8_t number);
+    void start_step(void);
+};
+
+extern SelfTest self_test;
+#endif
+
+#endif
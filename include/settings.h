@@ -0,0 +1,136 @@
+/**
+ * @file settings.h
+ * @author Fern Lane
+ * @brief Wear-levelled, CRC-protected EEPROM settings storage
+ *
+ * @copyright Copyright (c) 2024 Fern Lane
+ *
+ * This file is part of the in17clock distribution.
+ * See <https://github.com/F33RNI/in17clock> for more info.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * long with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SETTINGS_H__
+#define SETTINGS_H__
+
+#include "hal.h"
+
+#include "config.h"
+
+#ifdef CONFIG_OVERLAY
+// Index of each CONFIG_OVERLAY_LIST value (CONFIG_ID_SEPARATOR_TIME, ...)
+#define _CONFIG_ID(constant, name, min, max) CONFIG_ID_##constant,
+enum { CONFIG_OVERLAY_LIST(_CONFIG_ID) CONFIG_OVERLAY_NUM };
+#undef _CONFIG_ID
+
+// Value from CONFIG_OVERLAY_LIST that can be overridden with "cfg" console command
+struct ConfigOverlay {
+    char name[10];
+    uint16_t value, min, max;
+};
+
+// Overridden value or compile-time constant
+#define CONFIG(constant) settings.config(CONFIG_ID_##constant, constant)
+#else
+#define CONFIG(constant) (constant)
+#endif
+
+// Increment this every time SettingsData layout changes
+// NOTE: Only append new fields before the overlay (it's present only with CONFIG_OVERLAY, so it must be the last one).
+// Records with older versions will be loaded partially (new fields will have their default values). Fields that are
+// unknown to the current build (ex. overlay without CONFIG_OVERLAY) are skipped
+#define SETTINGS_VERSION 8U
+
+// Everything that must survive power cycle. Keep it small: each record is written as a whole
+struct __attribute__((packed)) SettingsData {
+    uint32_t seed; // Mixed with the boot time
+    uint8_t voltage;
+    uint8_t alarm_hours, alarm_minutes;
+    boolean alarm_active;
+
+    // Version 2
+    uint8_t reset_cause, watchdog_resets, watchdog_tasks;
+
+    // Version 4. Night mode hours (equal - disabled)
+    uint8_t night_on, night_off;
+
+    // Version 5. Lit time of each tube in seconds
+    uint32_t tube_lit[4];
+
+    // Version 6. Duty reduction of each tube (0 - full duty, see Digits::set_trims())
+    uint8_t tube_trim[4];
+
+    // Version 7. Sensor self-heating model (see HEATING_BASE, ...)
+    uint8_t heat_base, heat_converter, heat_display, heat_tau;
+
+    // Version 8. Index of DST_RULES + 1 (0 - no DST)
+    uint8_t dst;
+
+#ifdef CONFIG_OVERLAY
+    // Version 3 (always the last field since version 4). Overridden CONFIG_OVERLAY_LIST values (0 - not overridden)
+    uint16_t overlay[CONFIG_OVERLAY_NUM];
+#endif
+};
+
+struct __attribute__((packed)) SettingsHeader {
+    uint8_t version;
+    uint8_t size;
+    uint16_t sequence;
+};
+
+// Single EEPROM slot: header, size bytes of data, CRC of header and data. Slots have fixed size, so records of any
+// version can be found
+struct __attribute__((packed)) SettingsRecord {
+    SettingsHeader header;
+    SettingsData data;
+    uint16_t crc;
+};
+
+// Number of records that fit into the EEPROM region (each commit goes into the next one)
+#define SETTINGS_SLOTS (SETTINGS_EEPROM_SIZE / SETTINGS_SLOT_SIZE)
+
+class Settings {
+  public:
+    SettingsData data;
+
+    void init(void);
+    void mark_dirty(void);
+    void update(void);
+    void commit(void);
+#ifdef CONFIG_OVERLAY
+    static const ConfigOverlay overlay_list[CONFIG_OVERLAY_NUM];
+
+    uint16_t config(uint8_t id, uint16_t value);
+#endif
+
+  private:
+    SettingsRecord pending;
+    uint16_t sequence, data_crc;
+    uint8_t slot, write_index;
+    boolean dirty, stored;
+    uint32_t dirty_timer;
+
+    boolean read_record(uint8_t slot, SettingsHeader *header);
+    void load_defaults(void);
+    void load_legacy(void);
+    void sanitize(void);
+    void write_next_byte(void);
+    static uint16_t slot_address(uint8_t slot);
+    static uint16_t crc_16(const uint8_t *data, uint8_t length, uint16_t crc = 0xFFFFU);
+};
+
+extern Settings settings;
+
+#endif
@@ -25,8 +25,7 @@
 #ifndef TEMP_HUMID_H__
 #define TEMP_HUMID_H__
 
-#include <Arduino.h>
-#include <Wire.h>
+#include "hal.h"
 
 #define _POLYNOMIAL       0x31U
 #define READ_TEMP_HUMID_0 0x24
@@ -38,18 +37,31 @@
 // Temperature and humidity low-pass filter (0-1). Closer to 1 -> smoother and slower
 const float TEMP_HUMID_FILTER_K PROGMEM = .994f;
 
+// Magnus formula coefficients of saturation vapor pressure over water (Sonntag 1990)
+#define MAGNUS_B 17.62f
+#define MAGNUS_C 243.12f
+
 class TempHumid {
   public:
     void init(void);
     void read(void);
     float get_temperature(void), get_humidity(void);
+    float get_temperature_raw(void), get_humidity_raw(void);
+    uint16_t get_bus_errors(void), get_crc_errors(void);
+    float get_heating(void), get_heating_target(void);
+    boolean calibrate_heating(float reference);
 
     static inline uint8_t crc_8(uint8_t byte_1, uint8_t byte_2);
 
   private:
-    uint64_t read_timer;
+    uint32_t read_timer;
     float temperature_last, temperature_filtered;
     float humidity_last, humidity_filtered;
+    uint16_t bus_errors, crc_errors;
+    uint32_t heating_timer;
+    float heating, humidity_factor;
+
+    void update_heating(void);
 };
 
 extern TempHumid temp_humid;
@@ -0,0 +1,49 @@
+/**
+ * @file tube_hours.h
+ * @author Fern Lane
+ * @brief Lit time of each tube (from multiplexing slots), end of life report and aging compensation
+ *
+ * @copyright Copyright (c) 2024 Fern Lane
+ *
+ * This file is part of the in17clock distribution.
+ * See <https://github.com/F33RNI/in17clock> for more info.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * long with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TUBE_HOURS_H__
+#define TUBE_HOURS_H__
+
+#include "hal.h"
+
+#include "config.h"
+
+class TubeHours {
+  public:
+    void update(void);
+    uint16_t get_hours_10(uint8_t tube);
+    uint8_t get_wear(uint8_t tube);
+    boolean is_worn(uint8_t tube);
+    uint8_t get_compensation(void);
+    void reset(uint8_t tube);
+
+  private:
+    // Lit time that is less than a second (1 / (HAL_MULTIPLEX_FREQUENCY * 256) of a second)
+    uint32_t fractions[4];
+    uint32_t sample_timer, save_timer;
+};
+
+extern TubeHours tube_hours;
+
+#endif
@@ -0,0 +1,57 @@
+/**
+ * @file watchdog.h
+ * @author Fern Lane
+ * @brief Hardware watchdog supervisor with per-task heartbeats
+ *
+ * @copyright Copyright (c) 2024 Fern Lane
+ *
+ * This file is part of the in17clock distribution.
+ * See <https://github.com/F33RNI/in17clock> for more info.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * long with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef WATCHDOG_H__
+#define WATCHDOG_H__
+
+#include "hal.h"
+
+#include "config.h"
+
+// Critical tasks. Watchdog will be reset only after all of them check in
+#define WATCHDOG_TASK_POWER   _BV(0)
+#define WATCHDOG_TASK_DISPLAY _BV(1)
+#define WATCHDOG_TASK_RTC     _BV(2)
+#define WATCHDOG_TASKS_ALL    (WATCHDOG_TASK_POWER | WATCHDOG_TASK_DISPLAY | WATCHDOG_TASK_RTC)
+
+// Marks that missing tasks were saved before watchdog reset
+#define _WATCHDOG_MAGIC 0xA5U
+
+class Watchdog {
+  public:
+    void init(void);
+    void check_in(uint8_t task);
+    void check_in_isr(uint8_t task);
+    void supervise(void);
+    void report(Print &output);
+
+    static void _isr(void);
+
+  private:
+    volatile uint8_t tasks;
+};
+
+extern Watchdog watchdog;
+
+#endif
@@ -0,0 +1,121 @@
+/**
+ * @file light.cpp
+ * @author Fern Lane
+ * @brief Ambient light (LDR) measurement and automatic brightness of the tubes and the separator
+ *
+ * @copyright Copyright (c) 2024 Fern Lane
+ *
+ * This file is part of the in17clock distribution.
+ * See <https://github.com/F33RNI/in17clock> for more info.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * long with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "include/light.h"
+
+#ifdef LIGHT_SENSOR
+
+#include "include/pins.h"
+
+#include "include/digits.h"
+
+// Preinstantiate
+Light light;
+
+/**
+ * @brief Measures initial light and sets brightness without fading
+ */
+void Light::init(void) {
+    uint16_t sample = hal.adc_read(PIN_LIGHT_SENSE);
+    filtered = sample << LIGHT_FILTER_SHIFT;
+    apply(sample);
+    tubes = tubes_target;
+    separator = separator_target;
+    digits.set_brightness(tubes, separator);
+}
+
+/**
+ * @brief Measures and filters light every LIGHT_SAMPLE_INTERVAL and fades brightness to the curve value
+ * NOTE: Must be called in a main loop without any delays
+ */
+void Light::update(void) {
+    uint32_t millis_current = hal.millis();
+
+    // Fade by 1 step
+    if ((tubes != tubes_target || separator != separator_target) &&
+        millis_current - fade_timer >= LIGHT_FADE_STEP_TIME) {
+        fade_timer = millis_current;
+        if (tubes != tubes_target)
+            tubes += tubes < tubes_target ? 1 : -1;
+        if (separator != separator_target)
+            separator += separator < separator_target ? 1 : -1;
+        digits.set_brightness(tubes, separator);
+    }
+
+    if (millis_current - sample_timer < LIGHT_SAMPLE_INTERVAL)
+        return;
+    sample_timer = millis_current;
+
+    // Exponential filter: filtered converges to light << LIGHT_FILTER_SHIFT
+    filtered = filtered - (filtered >> LIGHT_FILTER_SHIFT) + hal.adc_read(PIN_LIGHT_SENSE);
+
+    // Hysteresis
+    uint16_t light_current = get_light();
+    if (light_current + LIGHT_HYSTERESIS > light_applied && light_current < light_applied + LIGHT_HYSTERESIS)
+        return;
+    apply(light_current);
+}
+
+/**
+ * @return uint16_t filtered light (raw ADC value)
+ */
+uint16_t Light::get_light(void) { return filtered >> LIGHT_FILTER_SHIFT; }
+
+/**
+ * @return uint8_t current brightness of the tubes (0-255)
+ */
+uint8_t Light::get_tubes(void) { return tubes; }
+
+/**
+ * @return uint8_t current brightness of the separator (0-255)
+ */
+uint8_t Light::get_separator(void) { return separator; }
+
+/**
+ * @brief Calculates target brightness from LIGHT_CURVE (linear interpolation between its points)
+ *
+ * @param light_value filtered light (raw ADC value)
+ */
+void Light::apply(uint16_t light_value) {
+    light_applied = light_value;
+
+    // Find segment (light outside of the curve is clamped to its ends)
+    uint8_t i = 1U;
+    while (i < LIGHT_CURVE_N - 1U && light_value > pgm_read_word(&LIGHT_CURVE[i][0]))
+        i++;
+    int32_t light_0 = pgm_read_word(&LIGHT_CURVE[i - 1U][0]), light_1 = pgm_read_word(&LIGHT_CURVE[i][0]);
+    int32_t position = light_value < light_0 ? light_0 : (light_value > light_1 ? light_1 : light_value);
+
+    int32_t tubes_0 = pgm_read_word(&LIGHT_CURVE[i - 1U][1]), tubes_1 = pgm_read_word(&LIGHT_CURVE[i][1]);
+    int32_t separator_0 = pgm_read_word(&LIGHT_CURVE[i - 1U][2]), separator_1 = pgm_read_word(&LIGHT_CURVE[i][2]);
+    if (light_1 <= light_0) {
+        tubes_target = tubes_1;
+        separator_target = separator_1;
+        return;
+    }
+    tubes_target = tubes_0 + (tubes_1 - tubes_0) * (position - light_0) / (light_1 - light_0);
+    separator_target = separator_0 + (separator_1 - separator_0) * (position - light_0) / (light_1 - light_0);
+}
+
+#endif
@@ -22,37 +22,74 @@
  * long with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
-#include <Arduino.h>
-#include <EEPROM.h>
+#include "include/hal.h"
 
 #include "include/config.h"
+#include "include/decimal.h"
 #include "include/pins.h"
 
 #include "include/buttons.h"
 #include "include/buzzer.h"
+#include "include/console.h"
 #include "include/digits.h"
+#include "include/light.h"
+#include "include/night.h"
 #include "include/power.h"
+#include "include/profiler.h"
+#include "include/recorder.h"
 #include "include/rtc.h"
+#include "include/self_test.h"
+#include "include/settings.h"
 #include "include/temp_humid.h"
+#include "include/tube_hours.h"
+#include "include/watchdog.h"
 
 #define MODE_TIME        0U
 #define MODE_VOLTAGE     1U
 #define MODE_SET_HOURS   2U
 #define MODE_SET_MINUTES 3U
 #define MODE_WEATHER     4U
+#define MODE_BOOT        5U
+#define MODE_CALIBRATE   6U
 
 uint8_t mode;
-uint64_t separator_timer, blink_timer, wave_timer, btn_timer, inc_dec_timer, alarm_preview_timer;
-uint8_t set_hours, set_minutes, alarm_hours, alarm_minutes, alarm_disabled_hours, alarm_disabled_minutes;
+uint32_t separator_timer, blink_timer, wave_timer, btn_timer, inc_dec_timer, alarm_preview_timer, calibrate_timer;
+uint8_t set_hours, set_minutes, alarm_disabled_hours, alarm_disabled_minutes, calibrate_tube;
 uint8_t wave_positions[4], wave_counter;
 uint16_t inc_dec_delay;
-boolean separator, blink_state, set_last, wave_started, alarm_active;
+#ifdef CAROUSEL
+// Pre-rendered cathode positions of each page and of the time to return to. Page is the index of the next frame + 1
+// (0 - carousel is not running)
+uint8_t carousel_frames[CAROUSEL_PAGES_N + 1U][4], carousel_page;
+uint32_t carousel_timer;
+const uint8_t *roll_target;
+#endif
+
+// UI flags packed into one byte
+struct {
+    uint8_t blink_state : 1;
+    uint8_t set_last : 1;
+    uint8_t wave_started : 1;
+    uint8_t rolling : 1;
+} flags;
 
 void alarm(void);
 void mode_clock(boolean sqw_interrupt);
+void wave_start(void);
+void show_positions(void);
+#ifdef CAROUSEL
+void carousel_start(void);
+void carousel_update(void);
+void render_pair(uint8_t frame[4], uint8_t left, uint8_t right);
+void roll_start(const uint8_t frame[4]);
+void roll_update(void);
+#endif
 void mode_voltage(void);
 void mode_set(boolean sqw_interrupt);
 void mode_weather(void);
+void weather_pair(uint8_t *temperature, uint8_t *humidity);
+void mode_boot(void);
+void mode_calibrate(void);
 boolean inc_dec(void);
 void increment(void);
 void decrement(void);
@@ -62,52 +99,52 @@ void setup() {
     // Initialize everything
     power.init();
     digits.init();
+#ifdef LIGHT_SENSOR
+    light.init();
+#endif
     rtc.init();
     temp_humid.init();
     buzzer.init();
     buttons.init();
-    EEPROM.begin();
-
-    // Rotate random seed
-    uint32_t seed = (uint32_t) EEPROM.read(0) | ((uint32_t) EEPROM.read(1) << 8) | ((uint32_t) EEPROM.read(2) << 16) |
-                    ((uint32_t) EEPROM.read(3) << 24);
-    randomSeed(seed);
-    seed = random();
-    EEPROM.write(0, seed & 0xFF);
-    EEPROM.write(1, (seed >> 8) & 0xFF);
-    EEPROM.write(2, (seed >> 16) & 0xFF);
-    EEPROM.write(3, (seed >> 24) & 0xFF);
-
-    // Restore converter voltage
-    uint8_t voltage = EEPROM.read(4);
-    if (voltage > CONVERTER_SETPOINT_MAX || voltage < CONVERTER_SETPOINT_MIN)
-        voltage = ((uint16_t) CONVERTER_SETPOINT_MAX + (uint16_t) CONVERTER_SETPOINT_MIN) / 2;
-    power.set_voltage(voltage);
-
-    // Restore alarm
-    alarm_hours = EEPROM.read(5);
-    if (alarm_hours > 23)
-        alarm_hours = 0;
-    alarm_minutes = EEPROM.read(6);
-    if (alarm_minutes > 59)
-        alarm_minutes = 0;
-    alarm_active = !EEPROM.read(7);
+    settings.init();
+#ifdef CONSOLE
+    console.init();
+#endif
+#ifdef PROFILER
+    profiler.init();
+#endif
+
+    // Restore converter voltage and brightness of each tube
+    power.set_voltage(settings.data.voltage);
+    digits.set_trims(settings.data.tube_trim);
+
+    // Alarm is not disabled at startup
     alarm_disabled_hours = 255U;
     alarm_disabled_minutes = 255U;
 
-    // Initiate wave at the start
-    rtc.read();
-    wave_started = true;
-    wave_counter = 0;
-    wave_positions[0] = pgm_read_byte(&NUMBER_TO_POSITION[rtc.get_hours() / 10]);
-    wave_positions[1] = pgm_read_byte(&NUMBER_TO_POSITION[rtc.get_hours() % 10]);
-    wave_positions[2] = pgm_read_byte(&NUMBER_TO_POSITION[rtc.get_minutes() / 10]);
-    wave_positions[3] = pgm_read_byte(&NUMBER_TO_POSITION[rtc.get_minutes() % 10]);
+    // Show time with wave as soon as RTC responds (without waiting for converter and sensor)
+    mode = MODE_BOOT;
+    mode_boot();
+
+    // Record reset cause and start supervising
+    watchdog.init();
 }
 
 void loop() {
+    PROFILE_BEGIN(loop_start);
+    PROFILE_BEGIN(section_start);
+
     power.regulate();
+#ifdef LIGHT_SENSOR
+    light.update();
+#endif
+#ifdef SELF_TEST
+    self_test.update();
+#endif
+    PROFILE_END(PROFILER_POWER, section_start);
+
     temp_humid.read();
+    PROFILE_END(PROFILER_SENSOR, section_start);
 
     // Handle 1Hz RTC interrupts (SQW)
     boolean sqw_interrupt = false;
@@ -115,7 +152,10 @@ void loop() {
         sqw_interrupt = true;
         rtc.clear_interrupt();
         rtc.read();
+        RECORD_SQW(rtc.get_hours(), rtc.get_minutes(), rtc.get_seconds());
     }
+    night.update();
+    PROFILE_END(PROFILER_RTC, section_start);
 
     if (mode == MODE_TIME) {
         alarm();
@@ -126,8 +166,29 @@ void loop() {
         mode_set(sqw_interrupt);
     else if (mode == MODE_WEATHER)
         mode_weather();
+    else if (mode == MODE_BOOT)
+        mode_boot();
+    else if (mode == MODE_CALIBRATE)
+        mode_calibrate();
+    PROFILE_END(PROFILER_UI, section_start);
 
     buzzer.decay();
+    PROFILE_END(PROFILER_BUZZER, section_start);
+
+    tube_hours.update();
+    settings.update();
+    PROFILE_END(PROFILER_SETTINGS, section_start);
+
+#ifdef CONSOLE
+    console.update();
+    PROFILE_END(PROFILER_CONSOLE, section_start);
+#endif
+
+    watchdog.supervise();
+    PROFILE_END(PROFILER_LOOP, loop_start);
+#ifdef PROFILER
+    profiler.update();
+#endif
 }
 
 /**
@@ -144,15 +205,20 @@ void alarm(void) {
     if (buttons.get_alarm()) {
         // Start alarm preview
         if (alarm_preview_timer == 0) {
-            alarm_preview_timer = millis();
-            buzzer.play_note(NOTE_ALARM_ON, BUTTON_NOTE_PWM);
+            alarm_preview_timer = hal.millis();
+            buzzer.play_note(NOTE_ALARM_ON, CONFIG(BUTTON_NOTE_PWM));
         }
 
-        // Activate alarm
-        if (rtc.get_hours() == alarm_hours && rtc.get_minutes() == alarm_minutes &&
-            rtc.get_hours() != alarm_disabled_hours && rtc.get_minutes() != alarm_disabled_minutes && !alarm_active) {
-            alarm_active = true;
-            EEPROM.write(7, !alarm_active);
+        // Activate alarm. Alarm in the hour skipped by the start of DST rings an hour later, alarm in the hour repeated
+        // after the end of DST rings only once
+        boolean hours_match = rtc.get_hours() == settings.data.alarm_hours ||
+                              (settings.data.alarm_hours == rtc.get_skipped_hour() &&
+                               rtc.get_hours() == settings.data.alarm_hours + 1U);
+        if (hours_match && rtc.get_minutes() == settings.data.alarm_minutes && !rtc.is_repeated_hour() &&
+            rtc.get_hours() != alarm_disabled_hours && rtc.get_minutes() != alarm_disabled_minutes &&
+            !settings.data.alarm_active) {
+            settings.data.alarm_active = true;
+            settings.mark_dirty();
         }
     }
 
@@ -161,17 +227,17 @@ void alarm(void) {
         alarm_preview_timer = 0;
 
         // Alarm has been turned off
-        if (alarm_active) {
-            alarm_active = false;
+        if (settings.data.alarm_active) {
+            settings.data.alarm_active = false;
             alarm_disabled_hours = rtc.get_hours();
             alarm_disabled_minutes = rtc.get_minutes();
-            EEPROM.write(7, !alarm_active);
-            buzzer.play_note(NOTE_TIME_MODE, BUTTON_NOTE_PWM);
+            settings.mark_dirty();
+            buzzer.play_note(NOTE_TIME_MODE, CONFIG(BUTTON_NOTE_PWM));
         }
     }
 
     // Pi pi pi...
-    if (alarm_active)
+    if (settings.data.alarm_active)
         buzzer.play_chime();
 }
 
@@ -181,90 +247,95 @@ void alarm(void) {
  * @param sqw_interrupt true if RTC interrupt arrived
  */
 void mode_clock(boolean sqw_interrupt) {
-    if (wave_started) {
+    if (flags.wave_started) {
         // Update wave each 2s / (10numbers * 2cycles) = 100ms
-        if (millis() - wave_timer >= 100U) {
-            wave_timer = millis();
+        if (hal.millis() - wave_timer >= 100U) {
+            wave_timer = hal.millis();
             for (uint8_t i = 0; i < 4; ++i)
                 wave_positions[i] = wave_positions[i] == 9 ? 0 : wave_positions[i] + 1;
-            digits.set(pgm_read_byte(&POSITION_TO_NUMBER[wave_positions[0]]),
-                       pgm_read_byte(&POSITION_TO_NUMBER[wave_positions[1]]),
-                       pgm_read_byte(&POSITION_TO_NUMBER[wave_positions[2]]),
-                       pgm_read_byte(&POSITION_TO_NUMBER[wave_positions[3]]));
+            show_positions();
             wave_counter++;
 
             // Turn wave OFF after 20 cycles
             if (wave_counter == 21) {
-                wave_started = false;
-                digits.set(rtc.get_hours() / 10, rtc.get_hours() % 10, rtc.get_minutes() / 10, rtc.get_minutes() % 10);
+                flags.wave_started = false;
+                digits.set_pair(rtc.get_hours(), rtc.get_minutes());
             }
         }
     }
 
     // Blink with time if alarm is active
-    if (alarm_active) {
-        if (millis() - blink_timer >= ALARM_BLINK_RATE) {
-            blink_timer = millis();
-            blink_state = !blink_state;
+    if (settings.data.alarm_active) {
+        if (hal.millis() - blink_timer >= CONFIG(ALARM_BLINK_RATE)) {
+            blink_timer = hal.millis();
+            flags.blink_state = !flags.blink_state;
         }
-        if (blink_state)
-            digits.set(rtc.get_hours() / 10, rtc.get_hours() % 10, rtc.get_minutes() / 10, rtc.get_minutes() % 10);
+        if (flags.blink_state)
+            digits.set_pair(rtc.get_hours(), rtc.get_minutes());
         else
             digits.set(255U, 255U, 255U, 255U);
     }
 
     // Briefly show alarm setpoint
-    else if (alarm_preview_timer != 0 && millis() - alarm_preview_timer <= ALARM_PREVIEW_TIME)
-        digits.set(alarm_hours / 10, alarm_hours % 10, alarm_minutes / 10, alarm_minutes % 10);
+    else if (alarm_preview_timer != 0 && hal.millis() - alarm_preview_timer <= CONFIG(ALARM_PREVIEW_TIME))
+        digits.set_pair(settings.data.alarm_hours, settings.data.alarm_minutes);
+
+#ifdef CAROUSEL
+    // Show weather, date, ... (paused by the alarm and its preview)
+    else if (carousel_page)
+        carousel_update();
+#endif
 
     // New second
     if (sqw_interrupt) {
         // Normal mode
-        if (!alarm_active && !wave_started && millis() - alarm_preview_timer > ALARM_PREVIEW_TIME)
-            digits.set(rtc.get_hours() / 10, rtc.get_hours() % 10, rtc.get_minutes() / 10, rtc.get_minutes() % 10);
+        if (!settings.data.alarm_active && !flags.wave_started &&
+            hal.millis() - alarm_preview_timer > CONFIG(ALARM_PREVIEW_TIME)) {
+#ifdef CAROUSEL
+            if (rtc.get_seconds() == CAROUSEL_SECOND && !carousel_page)
+                carousel_start();
+            if (!carousel_page)
+#endif
+                digits.set_pair(rtc.get_hours(), rtc.get_minutes());
+        }
 
         // Turn separator ON and reset it's timer
         digits.set_separator(true);
-        separator_timer = millis();
+        separator_timer = hal.millis();
 
         // Start wave 2 seconds before new minute
-        if (rtc.get_seconds() == 58U && !wave_started) {
-            wave_started = true;
-            wave_counter = 0;
-            wave_positions[0] = pgm_read_byte(&NUMBER_TO_POSITION[rtc.get_hours() / 10]);
-            wave_positions[1] = pgm_read_byte(&NUMBER_TO_POSITION[rtc.get_hours() % 10]);
-            wave_positions[2] = pgm_read_byte(&NUMBER_TO_POSITION[rtc.get_minutes() / 10]);
-            wave_positions[3] = pgm_read_byte(&NUMBER_TO_POSITION[rtc.get_minutes() % 10]);
+        if (rtc.get_seconds() == 58U && !flags.wave_started) {
+            wave_start();
         }
     }
 
     // Clear separator
-    if (separator_timer != 0 && millis() - separator_timer >= SEPARATOR_TIME) {
+    if (separator_timer != 0 && hal.millis() - separator_timer >= CONFIG(SEPARATOR_TIME)) {
         digits.set_separator(false);
         separator_timer = 0;
     }
 
     // Set button pressed -> enter set mode
     if (buttons.get_set()) {
-        if (!set_last) {
+        if (!flags.set_last) {
             mode = MODE_SET_HOURS;
-            set_last = true;
+            flags.set_last = true;
             if (!buttons.get_alarm()) {
                 set_hours = rtc.get_hours();
                 set_minutes = rtc.get_minutes();
             }
-            buzzer.play_note(NOTE_SET_MODE, BUTTON_NOTE_PWM);
+            buzzer.play_note(NOTE_SET_MODE, CONFIG(BUTTON_NOTE_PWM));
         }
 
     } else
-        set_last = false;
+        flags.set_last = false;
 
     // Up / down button pressed -> enter voltage select mode and reset timers
     if (buttons.get_down() || buttons.get_up()) {
         mode = MODE_VOLTAGE;
-        btn_timer = millis();
+        btn_timer = hal.millis();
         inc_dec_timer = btn_timer;
-        inc_dec_delay = BTN_INC_DEC_DELAY_LOW;
+        inc_dec_delay = CONFIG(BTN_INC_DEC_DELAY_LOW);
     }
 
     // Weather button pressed -> switch to weather mode
@@ -274,14 +345,119 @@ void mode_clock(boolean sqw_interrupt) {
     }
 }
 
+/**
+ * @brief Starts wave animation from the current time
+ */
+void wave_start(void) {
+    flags.wave_started = true;
+    wave_counter = 0;
+    wave_timer = hal.millis() - 100U;
+    uint8_t numbers[4];
+    decimal_split_pair(rtc.get_hours(), rtc.get_minutes(), numbers);
+    for (uint8_t i = 0; i < 4; ++i)
+        wave_positions[i] = pgm_read_byte(&NUMBER_TO_POSITION[numbers[i]]);
+}
+
+/**
+ * @brief Shows numbers of wave_positions (cathode stack positions of each tube)
+ */
+void show_positions(void) {
+    digits.set(pgm_read_byte(&POSITION_TO_NUMBER[wave_positions[0]]),
+               pgm_read_byte(&POSITION_TO_NUMBER[wave_positions[1]]),
+               pgm_read_byte(&POSITION_TO_NUMBER[wave_positions[2]]),
+               pgm_read_byte(&POSITION_TO_NUMBER[wave_positions[3]]));
+}
+
+#ifdef CAROUSEL
+/**
+ * @brief Renders all pages (so showing them costs only a timer check) and rolls to the first one
+ */
+void carousel_start(void) {
+    for (uint8_t i = 0; i < CAROUSEL_PAGES_N; ++i) {
+        uint8_t left, right;
+        if (pgm_read_byte(&CAROUSEL_PAGES[i]) == CAROUSEL_WEATHER)
+            weather_pair(&left, &right);
+        else {
+            left = rtc.get_day();
+            right = rtc.get_month();
+        }
+        render_pair(carousel_frames[i], left, right);
+    }
+
+    // Carousel ends before the wave, so minutes will not change
+    render_pair(carousel_frames[CAROUSEL_PAGES_N], rtc.get_hours(), rtc.get_minutes());
+    memcpy(wave_positions, carousel_frames[CAROUSEL_PAGES_N], sizeof(wave_positions));
+
+    roll_start(carousel_frames[0]);
+    carousel_page = 1U;
+}
+
+/**
+ * @brief Rolls between the pages and returns to time after the last one
+ */
+void carousel_update(void) {
+    // Page time starts after the roll
+    if (flags.rolling) {
+        roll_update();
+        carousel_timer = hal.millis();
+    } else if (carousel_page > CAROUSEL_PAGES_N)
+        carousel_page = 0;
+    else if (hal.millis() - carousel_timer >= CAROUSEL_PAGE_TIME)
+        roll_start(carousel_frames[carousel_page++]);
+}
+
+/**
+ * @brief Converts two 2-digit numbers into cathode positions of the tubes
+ *
+ * @param frame output positions
+ * @param left 0-99 for the first pair of tubes
+ * @param right 0-99 for the second pair of tubes
+ */
+void render_pair(uint8_t frame[4], uint8_t left, uint8_t right) {
+    uint8_t numbers[4];
+    decimal_split_pair(left, right, numbers);
+    for (uint8_t i = 0; i < 4; ++i)
+        frame[i] = pgm_read_byte(&NUMBER_TO_POSITION[numbers[i]]);
+}
+
+/**
+ * @brief Starts rolling each tube through its cathodes (as the wave does) from wave_positions to the frame
+ *
+ * @param frame target cathode positions (must stay valid until the roll ends)
+ */
+void roll_start(const uint8_t frame[4]) {
+    roll_target = frame;
+    flags.rolling = true;
+    wave_timer = hal.millis() - CAROUSEL_ROLL_STEP;
+}
+
+/**
+ * @brief Moves tubes that haven't reached their target by one cathode every CAROUSEL_ROLL_STEP
+ */
+void roll_update(void) {
+    if (hal.millis() - wave_timer < CAROUSEL_ROLL_STEP)
+        return;
+    wave_timer = hal.millis();
+    flags.rolling = false;
+    for (uint8_t i = 0; i < 4; ++i) {
+        if (wave_positions[i] != roll_target[i]) {
+            wave_positions[i] = wave_positions[i] == 9 ? 0 : wave_positions[i] + 1;
+            flags.rolling = true;
+        }
+    }
+    show_positions();
+}
+#endif
+
 /**
  * @brief Allows to edit nixie supply voltage
  * (Shows supply voltage in Volts)
  */
 void mode_voltage(void) {
     // Set without separator
-    digits.set(255U, power.get_voltage() / 100U, (power.get_voltage() - ((power.get_voltage() / 100U) * 100U)) / 10U,
-               power.get_voltage() % 10U);
+    uint8_t voltage[3];
+    decimal_split(power.get_voltage(), voltage);
+    digits.set(255U, voltage[0], voltage[1], voltage[2]);
     digits.set_separator(false);
 
     // Edit voltage and return to main (time) mode if no more buttons pressed
@@ -296,26 +472,22 @@ void mode_voltage(void) {
  */
 void mode_set(boolean sqw_interrupt) {
     // Blink with minutes or seconds every SET_BLINK_RATE milliseconds
-    if (millis() - blink_timer >= SET_BLINK_RATE) {
-        blink_timer = millis();
-        blink_state = !blink_state;
+    if (hal.millis() - blink_timer >= CONFIG(SET_BLINK_RATE)) {
+        blink_timer = hal.millis();
+        flags.blink_state = !flags.blink_state;
     }
 
     // Show alarm time
     if (buttons.get_alarm()) {
-        digits.set(blink_state || mode == MODE_SET_MINUTES ? alarm_hours / 10 : 255U,
-                   blink_state || mode == MODE_SET_MINUTES ? alarm_hours % 10 : 255U,
-                   blink_state || mode == MODE_SET_HOURS ? alarm_minutes / 10 : 255U,
-                   blink_state || mode == MODE_SET_HOURS ? alarm_minutes % 10 : 255U);
+        digits.set_pair(settings.data.alarm_hours, settings.data.alarm_minutes,
+                        flags.blink_state || mode == MODE_SET_MINUTES, flags.blink_state || mode == MODE_SET_HOURS);
         digits.set_separator(true);
     }
 
     // Show main time
     else {
-        digits.set(blink_state || mode == MODE_SET_MINUTES ? set_hours / 10 : 255U,
-                   blink_state || mode == MODE_SET_MINUTES ? set_hours % 10 : 255U,
-                   blink_state || mode == MODE_SET_HOURS ? set_minutes / 10 : 255U,
-                   blink_state || mode == MODE_SET_HOURS ? set_minutes % 10 : 255U);
+        digits.set_pair(set_hours, set_minutes, flags.blink_state || mode == MODE_SET_MINUTES,
+                        flags.blink_state || mode == MODE_SET_HOURS);
         digits.set_separator(false);
     }
 
@@ -329,16 +501,16 @@ void mode_set(boolean sqw_interrupt) {
 
     // Set button pressed again -> edit minutes or return to main (time) mode
     if (buttons.get_set()) {
-        if (!set_last) {
-            set_last = true;
+        if (!flags.set_last) {
+            flags.set_last = true;
             if (mode == MODE_SET_HOURS) {
                 mode = MODE_SET_MINUTES;
-                buzzer.play_note(NOTE_SET_MODE, BUTTON_NOTE_PWM);
+                buzzer.play_note(NOTE_SET_MODE, CONFIG(BUTTON_NOTE_PWM));
             } else
                 return_to_main();
         }
     } else
-        set_last = false;
+        flags.set_last = false;
 }
 
 /**
@@ -347,23 +519,75 @@ void mode_set(boolean sqw_interrupt) {
  *
  */
 void mode_weather(void) {
-    // Limit temperature and humidity to 0-99
-    uint16_t temperature_short = fabsf(temp_humid.get_temperature());
-    if (temperature_short > 99U)
-        temperature_short = 99U;
-    uint16_t humidity_short = temp_humid.get_humidity();
-    if (humidity_short > 99U)
-        humidity_short = 99U;
+    uint8_t temperature_short, humidity_short;
+    weather_pair(&temperature_short, &humidity_short);
 
     // Set with active separator
-    digits.set(temperature_short / 10, temperature_short % 10, humidity_short / 10, humidity_short % 10);
+    digits.set_pair(temperature_short, humidity_short);
     digits.set_separator(true);
 
+    // Set button pressed -> calibrate brightness of the tubes starting from the first one
+    if (buttons.get_set()) {
+        mode = MODE_CALIBRATE;
+        flags.set_last = true;
+        calibrate_tube = 0;
+        calibrate_timer = hal.millis();
+        buzzer.play_note(NOTE_SET_MODE, CONFIG(BUTTON_NOTE_PWM));
+    }
+
     // Weather button released -> return to main (time) mode
-    if (!buttons.get_weather())
+    else if (!buttons.get_weather())
         return_to_main();
 }
 
+/**
+ * @brief Limits temperature and humidity to 0-99 (temperature will be absolute)
+ *
+ * @param temperature output temperature in degrees Celsius
+ * @param humidity output humidity in %
+ */
+void weather_pair(uint8_t *temperature, uint8_t *humidity) {
+    float temperature_abs = fabsf(temp_humid.get_temperature());
+    *temperature = temperature_abs > 99.f ? 99U : (uint8_t) temperature_abs;
+    float humidity_float = temp_humid.get_humidity();
+    *humidity = humidity_float > 99.f ? 99U : (uint8_t) humidity_float;
+}
+
+/**
+ * @brief Allows to match brightness of the tubes
+ * (Shows number of the selected tube, then TUBE_TRIM_NUMBER on all tubes)
+ */
+void mode_calibrate(void) {
+    if (hal.millis() - calibrate_timer < TUBE_TRIM_SELECT_TIME) {
+        uint8_t numbers[4] = {255U, 255U, 255U, 255U};
+        numbers[calibrate_tube] = calibrate_tube + 1U;
+        digits.set(numbers[0], numbers[1], numbers[2], numbers[3]);
+    } else
+        digits.set(TUBE_TRIM_NUMBER, TUBE_TRIM_NUMBER, TUBE_TRIM_NUMBER, TUBE_TRIM_NUMBER);
+    digits.set_separator(false);
+
+    // Keep debouncing WEATHER (it's held to enter this mode), so its release is not seen later in the main mode
+    buttons.get_weather();
+
+    // Edit duty of the selected tube and show test pattern right away
+    if (inc_dec())
+        calibrate_timer = hal.millis() - TUBE_TRIM_SELECT_TIME;
+
+    // Set button pressed again -> select next tube or return to main (time) mode
+    if (buttons.get_set()) {
+        if (!flags.set_last) {
+            flags.set_last = true;
+            if (calibrate_tube + 1U < DIGITS_NUM) {
+                calibrate_tube++;
+                calibrate_timer = hal.millis();
+                buzzer.play_note(NOTE_SET_MODE, CONFIG(BUTTON_NOTE_PWM));
+            } else
+                return_to_main();
+        }
+    } else
+        flags.set_last = false;
+}
+
 /**
  * @brief Increment or decrements voltage / hours / minutes / alarm
  *
@@ -371,14 +595,15 @@ void mode_weather(void) {
  */
 boolean inc_dec(void) {
     if (buttons.get_down() || buttons.get_up()) {
-        if (millis() - btn_timer >= inc_dec_delay) {
+        if (hal.millis() - btn_timer >= inc_dec_delay) {
             // Reset timer and calculate new increment / decrement delay based on time passed since mode activation
-            btn_timer = millis();
-            if (btn_timer - inc_dec_timer <= BTN_INC_DEC_DELAY_TRANS_TIME)
-                inc_dec_delay = map(btn_timer - inc_dec_timer, 0UL, BTN_INC_DEC_DELAY_TRANS_TIME, BTN_INC_DEC_DELAY_LOW,
-                                    BTN_INC_DEC_DELAY_HIGH);
+            btn_timer = hal.millis();
+            uint16_t trans_time = CONFIG(BTN_INC_DEC_DELAY_TRANS_TIME);
+            if (btn_timer - inc_dec_timer <= trans_time)
+                inc_dec_delay = map(btn_timer - inc_dec_timer, 0UL, trans_time, CONFIG(BTN_INC_DEC_DELAY_LOW),
+                                    CONFIG(BTN_INC_DEC_DELAY_HIGH));
             else
-                inc_dec_delay = BTN_INC_DEC_DELAY_HIGH;
+                inc_dec_delay = CONFIG(BTN_INC_DEC_DELAY_HIGH);
 
             if (buttons.get_down())
                 decrement();
@@ -390,14 +615,14 @@ boolean inc_dec(void) {
 
     // Reset timer because no buttons pressed
     else {
-        inc_dec_timer = millis();
-        inc_dec_delay = BTN_INC_DEC_DELAY_LOW;
+        inc_dec_timer = hal.millis();
+        inc_dec_delay = CONFIG(BTN_INC_DEC_DELAY_LOW);
     }
     return false;
 }
 
 /**
- * @brief Increments voltage or main time or alarm
+ * @brief Increments voltage or main time or alarm or brightness of the selected tube
  * (depends on current mode)
  */
 void increment(void) {
@@ -405,7 +630,8 @@ void increment(void) {
     if (mode == MODE_VOLTAGE) {
         if (power.get_voltage() < CONVERTER_SETPOINT_MAX) {
             power.set_voltage(power.get_voltage() + 1);
-            EEPROM.write(4, power.get_voltage());
+            settings.data.voltage = power.get_voltage();
+            settings.mark_dirty();
         }
     }
 
@@ -415,14 +641,13 @@ void increment(void) {
 
         // Increment alarm
         if (alarm) {
-            if (mode == MODE_SET_HOURS && alarm_hours < 23)
-                alarm_hours++;
-            if (mode == MODE_SET_MINUTES && alarm_minutes < 59)
-                alarm_minutes++;
+            if (mode == MODE_SET_HOURS && settings.data.alarm_hours < 23)
+                settings.data.alarm_hours++;
+            if (mode == MODE_SET_MINUTES && settings.data.alarm_minutes < 59)
+                settings.data.alarm_minutes++;
             alarm_disabled_hours = 255U;
             alarm_disabled_minutes = 255U;
-            EEPROM.write(5, alarm_hours);
-            EEPROM.write(6, alarm_minutes);
+            settings.mark_dirty();
         }
 
         // Increment time
@@ -435,12 +660,21 @@ void increment(void) {
         }
     }
 
+    // Make selected tube brighter
+    else if (mode == MODE_CALIBRATE) {
+        if (settings.data.tube_trim[calibrate_tube] > 0) {
+            settings.data.tube_trim[calibrate_tube]--;
+            digits.set_trims(settings.data.tube_trim);
+            settings.mark_dirty();
+        }
+    }
+
     // Play increment sound
-    buzzer.play_note(NOTE_INCREMENT, BUTTON_NOTE_PWM);
+    buzzer.play_note(NOTE_INCREMENT, CONFIG(BUTTON_NOTE_PWM));
 }
 
 /**
- * @brief Decrements voltage or main time or alarm
+ * @brief Decrements voltage or main time or alarm or brightness of the selected tube
  * (depends on current mode)
  */
 void decrement(void) {
@@ -448,7 +682,8 @@ void decrement(void) {
     if (mode == MODE_VOLTAGE) {
         if (power.get_voltage() > CONVERTER_SETPOINT_MIN) {
             power.set_voltage(power.get_voltage() - 1);
-            EEPROM.write(4, power.get_voltage());
+            settings.data.voltage = power.get_voltage();
+            settings.mark_dirty();
         }
     }
 
@@ -458,14 +693,13 @@ void decrement(void) {
 
         // Decrement alarm
         if (alarm) {
-            if (mode == MODE_SET_HOURS && alarm_hours > 0)
-                alarm_hours--;
-            if (mode == MODE_SET_MINUTES && alarm_minutes > 0)
-                alarm_minutes--;
+            if (mode == MODE_SET_HOURS && settings.data.alarm_hours > 0)
+                settings.data.alarm_hours--;
+            if (mode == MODE_SET_MINUTES && settings.data.alarm_minutes > 0)
+                settings.data.alarm_minutes--;
             alarm_disabled_hours = 255U;
             alarm_disabled_minutes = 255U;
-            EEPROM.write(5, alarm_hours);
-            EEPROM.write(6, alarm_minutes);
+            settings.mark_dirty();
         }
 
         // Decrement time
@@ -478,8 +712,32 @@ void decrement(void) {
         }
     }
 
+    // Make selected tube dimmer
+    else if (mode == MODE_CALIBRATE) {
+        if (settings.data.tube_trim[calibrate_tube] < TUBE_TRIM_MAX) {
+            settings.data.tube_trim[calibrate_tube]++;
+            digits.set_trims(settings.data.tube_trim);
+            settings.mark_dirty();
+        }
+    }
+
     // Play decrement sound
-    buzzer.play_note(NOTE_DECREMENT, BUTTON_NOTE_PWM);
+    buzzer.play_note(NOTE_DECREMENT, CONFIG(BUTTON_NOTE_PWM));
+}
+
+/**
+ * @brief Waits for RTC without blocking (retries every main loop cycle), then reads time and starts wave
+ */
+void mode_boot(void) {
+    if (!rtc.probe())
+        return;
+    rtc.read();
+
+    // Time of the boot makes melodies different every time without writing a new seed into EEPROM
+    randomSeed(settings.data.seed ^ ((uint32_t) rtc.get_day() << 24) ^ ((uint32_t) rtc.get_hours() << 16) ^
+               ((uint16_t) rtc.get_minutes() << 8) ^ rtc.get_seconds());
+    wave_start();
+    mode = MODE_TIME;
 }
 
 /**
@@ -487,8 +745,12 @@ void decrement(void) {
  */
 void return_to_main(void) {
     mode = MODE_TIME;
-    digits.set(rtc.get_hours() / 10, rtc.get_hours() % 10, rtc.get_minutes() / 10, rtc.get_minutes() % 10);
+#ifdef CAROUSEL
+    carousel_page = 0;
+    flags.rolling = false;
+#endif
+    digits.set_pair(rtc.get_hours(), rtc.get_minutes());
     digits.set_separator(false);
     rtc.clear_interrupt();
-    buzzer.play_note(NOTE_TIME_MODE, BUTTON_NOTE_PWM);
+    buzzer.play_note(NOTE_TIME_MODE, CONFIG(BUTTON_NOTE_PWM));
 }
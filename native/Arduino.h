@@ -0,0 +1,39 @@
+/**
+ * @file Arduino.h
+ * @author Fern Lane
+ * @brief Redirects <Arduino.h> of the libraries (ex. PetalPID) to the native shims when building on the Linux host
+ *
+ * @copyright Copyright (c) 2024 Fern Lane
+ *
+ * This file is part of the in17clock distribution.
+ * See <https://github.com/F33RNI/in17clock> for more info.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * long with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ARDUINO_NATIVE_H__
+#define ARDUINO_NATIVE_H__
+
+#include "native.h"
+
+#include "../include/hal.h"
+
+static inline unsigned long millis(void) { return hal.millis(); }
+static inline unsigned long micros(void) { return hal.micros(); }
+
+#ifndef constrain
+#define constrain(x, low, high) ((x) < (low) ? (low) : ((x) > (high) ? (high) : (x)))
+#endif
+
+#endif
@@ -0,0 +1,729 @@
+/**
+ * @file hal_native.cpp
+ * @author Fern Lane
+ * @brief Linux host implementation of the hardware abstraction layer. Simulates hardware in virtual time:
+ * DS3231 (registers and 1Hz SQW), SHT31, DC-DC converter output, shift registers, buzzer PWM, EEPROM and watchdog
+ *
+ * @copyright Copyright (c) 2024 Fern Lane
+ *
+ * This file is part of the in17clock distribution.
+ * See <https://github.com/F33RNI/in17clock> for more info.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * long with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __AVR__
+
+#include <stdio.h>
+
+#include "mock.h"
+
+#include "../include/config.h"
+#include "../include/pins.h"
+
+#include "../include/digits.h"
+#include "../include/temp_humid.h"
+
+// Arduino pins 0-19 and A6, A7
+#define _PINS_NUM 22U
+
+// Long advances fire only this number of the last multiplexing interrupts (enough to refresh all digits)
+#define _MULTIPLEX_BURST (DIGITS_NUM * 2U)
+
+// DS3231 has 19 registers (0x00-0x12)
+#define _RTC_REGISTERS_NUM 0x13U
+
+// Preinstantiate
+HAL hal;
+
+static uint64_t time_us, multiplex_next_us, dim_next_us = UINT64_MAX, second_next_us = 1000000ULL, watchdog_deadline_us;
+
+static HALCallback multiplex_callback, dim_callback, watchdog_callback;
+static uint8_t dim_on_time = 255U;
+static HALPinChangeCallback pin_change_callback;
+static HALCallback external_callbacks[_PINS_NUM];
+static boolean pin_states[_PINS_NUM], pin_change_enabled[_PINS_NUM];
+static uint16_t adc_values[_PINS_NUM];
+
+static uint16_t converter_period, converter_compare;
+static boolean converter_running, converter_halted;
+static float converter_voltage;
+
+static uint8_t buzzer_prescaler, buzzer_top, buzzer_compare;
+static uint32_t buzzer_notes;
+
+static uint16_t shift_register, slot_words[DIGITS_NUM];
+static boolean cathodes_open[DIGITS_NUM][10], separator_open;
+static uint32_t shift_register_writes;
+static uint64_t glow_us[DIGITS_NUM][10], glow_separator_us, glow_latched_us, glow_window_us;
+
+static uint8_t rtc_registers[_RTC_REGISTERS_NUM], rtc_pointer;
+static boolean rtc_failed, rtc_held;
+
+static float sensor_temperature = 25.f, sensor_humidity = 40.f;
+static boolean sensor_requested, sensor_failed;
+
+static uint8_t eeprom[E2END + 1U];
+static boolean eeprom_initialized;
+
+static uint32_t watchdog_timeout_us;
+static boolean watchdog_enabled;
+
+/**
+ * @param anode 0 to DIGITS_NUM - 1
+ * @param number 0-9
+ * @return boolean true if the number of the tube glows with the latched word
+ */
+static boolean cathode_lit(uint8_t anode, uint8_t number) {
+    if (cathodes_open[anode][number])
+        return false;
+#ifdef ANODES_INVERTED
+    if (shift_register & PINS_ANODES[anode])
+        return false;
+#else
+    if (!(shift_register & PINS_ANODES[anode]))
+        return false;
+#endif
+#ifdef NUMBERS_INVERTED
+    return !(shift_register & PINS_NUMBERS[number]);
+#else
+    return shift_register & PINS_NUMBERS[number];
+#endif
+}
+
+/**
+ * @return boolean true if the separator glows with the latched word
+ */
+static boolean separator_lit(void) {
+    if (separator_open)
+        return false;
+#ifdef SEPARATOR_INVERTED
+    return !(shift_register & PIN_SEPARATOR);
+#else
+    return shift_register & PIN_SEPARATOR;
+#endif
+}
+
+/**
+ * @return uint8_t number of elements (numbers and the separator) that glow with the latched word
+ */
+static uint8_t elements_lit(void) {
+    uint8_t lit = separator_lit() ? 1U : 0U;
+    for (uint8_t anode = 0; anode < DIGITS_NUM; ++anode)
+        for (uint8_t number = 0; number < 10U; ++number)
+            lit += cathode_lit(anode, number);
+    return lit;
+}
+
+/**
+ * @brief Simulates first-order output filter of the converter
+ *
+ * @param microseconds time step
+ */
+static void converter_step(uint64_t microseconds) {
+    float target = 0.f;
+    if (converter_running && !converter_halted && converter_period) {
+        target = (float) converter_compare / (float) converter_period * NATIVE_CONVERTER_GAIN_V;
+        target -= elements_lit() * NATIVE_CONVERTER_LOAD_V;
+        if (target < 0.f)
+            target = 0.f;
+    }
+    converter_voltage += (target - converter_voltage) * (1.f - expf(-(float) microseconds / NATIVE_CONVERTER_TAU_US));
+}
+
+static uint8_t bcd_increment(uint8_t bcd) { return (bcd & 0x0FU) == 9U ? (bcd & 0xF0U) + 0x10U : bcd + 1U; }
+
+static uint8_t bcd_to_dec(uint8_t bcd) { return (bcd & 0x0FU) + 10U * (bcd >> 4U); }
+
+static uint8_t dec_to_bcd(uint8_t dec) { return ((dec / 10U) << 4U) | (dec % 10U); }
+
+/**
+ * @brief Increments DS3231 time and date registers by 1 second
+ */
+static void rtc_tick(void) {
+    static const uint8_t DAYS_IN_MONTH[12] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+
+    if ((rtc_registers[0] = bcd_increment(rtc_registers[0])) < 0x60U)
+        return;
+    rtc_registers[0] = 0;
+    if ((rtc_registers[1] = bcd_increment(rtc_registers[1])) < 0x60U)
+        return;
+    rtc_registers[1] = 0;
+    if ((rtc_registers[2] = bcd_increment(rtc_registers[2] & 0x3FU)) < 0x24U)
+        return;
+    rtc_registers[2] = 0;
+
+    // Day of week (1-7)
+    rtc_registers[3] = rtc_registers[3] >= 7U ? 1U : rtc_registers[3] + 1U;
+
+    uint8_t month = bcd_to_dec(rtc_registers[5] & 0x1FU);
+    uint8_t year = bcd_to_dec(rtc_registers[6]);
+    uint8_t days = DAYS_IN_MONTH[(month - 1U) % 12U] + (month == 2U && year % 4U == 0U ? 1U : 0U);
+    if (bcd_to_dec(rtc_registers[4] = bcd_increment(rtc_registers[4])) <= days)
+        return;
+    rtc_registers[4] = 1U;
+    if ((rtc_registers[5] = bcd_increment(rtc_registers[5] & 0x1FU)) <= 0x12U)
+        return;
+    rtc_registers[5] = 1U;
+    rtc_registers[6] = rtc_registers[6] == 0x99U ? 0U : bcd_increment(rtc_registers[6]);
+}
+
+/**
+ * @brief Calculates SHT31 CRC (polynomial 0x31, initial value 0xFF)
+ */
+static uint8_t sensor_crc(uint8_t byte_1, uint8_t byte_2) {
+    uint8_t data[2] = {byte_1, byte_2};
+    uint8_t crc = 0xFFU;
+    for (uint8_t i = 0; i < 2U; ++i) {
+        crc ^= data[i];
+        for (uint8_t j = 0; j < 8U; ++j)
+            crc = (crc & 0x80U) ? (crc << 1U) ^ 0x31U : (crc << 1U);
+    }
+    return crc;
+}
+
+/**
+ * @brief Advances virtual time and fires all interrupts that should happen during it
+ *
+ * @param microseconds time to advance
+ */
+void native_advance(uint32_t microseconds) {
+    uint64_t target_us = time_us + microseconds;
+
+    // Skip multiplexing interrupts that would be overwritten anyway to keep long simulations fast
+    uint64_t burst_us = (uint64_t) _MULTIPLEX_BURST * NATIVE_MULTIPLEX_PERIOD_US;
+    if (target_us > burst_us && multiplex_next_us < target_us - burst_us)
+        multiplex_next_us += (target_us - burst_us - multiplex_next_us) / NATIVE_MULTIPLEX_PERIOD_US *
+                             NATIVE_MULTIPLEX_PERIOD_US;
+
+    while (time_us < target_us) {
+        // Find the nearest event
+        uint64_t next_us = target_us;
+        if (multiplex_next_us < next_us)
+            next_us = multiplex_next_us;
+        if (dim_next_us < next_us)
+            next_us = dim_next_us;
+        if (second_next_us < next_us)
+            next_us = second_next_us;
+        if (watchdog_enabled && watchdog_deadline_us < next_us)
+            next_us = watchdog_deadline_us;
+
+        converter_step(next_us - time_us);
+        time_us = next_us;
+
+        // Multiplexing interrupt
+        if (time_us >= multiplex_next_us) {
+            multiplex_next_us += NATIVE_MULTIPLEX_PERIOD_US;
+            if (multiplex_callback)
+                multiplex_callback();
+
+            // Dimming interrupt inside this slot
+            if (dim_on_time != 255U && dim_callback)
+                dim_next_us = time_us + NATIVE_MULTIPLEX_PERIOD_US * dim_on_time / 256U;
+        }
+        if (time_us >= dim_next_us) {
+            dim_next_us = UINT64_MAX;
+            dim_callback();
+        }
+
+        // DS3231 second and falling edge of SQW
+        if (time_us >= second_next_us) {
+            second_next_us += 1000000ULL;
+            if (!rtc_held) {
+                rtc_tick();
+                if (!rtc_failed)
+                    native_pin_set(PIN_SQW, false);
+            }
+        } else if (time_us >= second_next_us - 500000ULL && !pin_states[PIN_SQW])
+            native_pin_set(PIN_SQW, true);
+
+        // Watchdog timeout
+        if (watchdog_enabled && time_us >= watchdog_deadline_us) {
+            watchdog_deadline_us = time_us + watchdog_timeout_us;
+            if (watchdog_callback)
+                watchdog_callback();
+            else
+                hal.watchdog_restart();
+        }
+    }
+}
+
+/**
+ * @return uint64_t virtual time since startup in microseconds
+ */
+uint64_t native_time(void) { return time_us; }
+
+/**
+ * @brief Sets pin input level and fires pin change (and falling edge) interrupts if enabled
+ *
+ * @param pin Arduino pin number
+ * @param state true for HIGH
+ */
+void native_pin_set(uint8_t pin, boolean state) {
+    if (pin >= _PINS_NUM || pin_states[pin] == state)
+        return;
+    pin_states[pin] = state;
+    if (pin_change_enabled[pin] && pin_change_callback)
+        pin_change_callback(hal.pin_change_group(pin));
+    if (!state && external_callbacks[pin])
+        external_callbacks[pin]();
+}
+
+boolean native_pin_get(uint8_t pin) { return pin < _PINS_NUM ? pin_states[pin] : false; }
+
+void native_adc_set(uint8_t pin, uint16_t value) {
+    if (pin < _PINS_NUM)
+        adc_values[pin] = value > 1023U ? 1023U : value;
+}
+
+/**
+ * @brief Sets DS3231 time and date registers
+ *
+ * @param year 0-99 (2000-2099)
+ */
+void native_rtc_set(uint8_t hours, uint8_t minutes, uint8_t seconds, uint8_t day, uint8_t month, uint8_t year) {
+    rtc_registers[0] = dec_to_bcd(seconds);
+    rtc_registers[1] = dec_to_bcd(minutes);
+    rtc_registers[2] = dec_to_bcd(hours);
+    rtc_registers[3] = 1U;
+    rtc_registers[4] = dec_to_bcd(day);
+    rtc_registers[5] = dec_to_bcd(month);
+    rtc_registers[6] = dec_to_bcd(year);
+}
+
+/**
+ * @param fail true to make DS3231 stop responding (and stop SQW)
+ */
+void native_rtc_fail(boolean fail) { rtc_failed = fail; }
+
+/**
+ * @param hold true to stop DS3231 clock and SQW (time will be changed only by native_rtc_sqw())
+ */
+void native_rtc_hold(boolean hold) { rtc_held = hold; }
+
+/**
+ * @brief Sets DS3231 time (date is not changed) and generates falling edge of SQW
+ */
+void native_rtc_sqw(uint8_t hours, uint8_t minutes, uint8_t seconds) {
+    rtc_registers[0] = dec_to_bcd(seconds);
+    rtc_registers[1] = dec_to_bcd(minutes);
+    rtc_registers[2] = dec_to_bcd(hours);
+    native_pin_set(PIN_SQW, true);
+    if (!rtc_failed)
+        native_pin_set(PIN_SQW, false);
+}
+
+/**
+ * @param temperature in degrees Celsius (-45 to 130)
+ * @param humidity in % (0 to 100)
+ */
+void native_sensor_set(float temperature, float humidity) {
+    sensor_temperature = temperature;
+    sensor_humidity = humidity;
+}
+
+/**
+ * @param fail true to make SHT31 stop responding
+ */
+void native_sensor_fail(boolean fail) { sensor_failed = fail; }
+
+/**
+ * @param tube 0 to DIGITS_NUM - 1
+ * @param number 0-9
+ * @param fail true to make the number of the tube open (it won't glow or load the converter)
+ */
+void native_cathode_fail(uint8_t tube, uint8_t number, boolean fail) {
+    if (tube < DIGITS_NUM && number < 10U)
+        cathodes_open[tube][number] = fail;
+}
+
+/**
+ * @param fail true to make the separator open
+ */
+void native_separator_fail(boolean fail) { separator_open = fail; }
+
+/**
+ * @return uint8_t part of each multiplexing slot (0-255) before dimming interrupt (255 - not dimmed)
+ */
+uint8_t native_dim_on_time(void) { return dim_on_time; }
+
+/**
+ * @return uint16_t last latched word of the shift registers
+ */
+uint16_t native_shift_register(void) { return shift_register; }
+
+/**
+ * @brief Adds time since the previous latch to every cathode (of every anode) that is lit by the latched word
+ */
+static void glow_accumulate(void) {
+    uint64_t duration_us = time_us - glow_latched_us;
+    glow_latched_us = time_us;
+    for (uint8_t anode = 0; anode < DIGITS_NUM; ++anode)
+        for (uint8_t number = 0; number < 10U; ++number)
+            if (cathode_lit(anode, number))
+                glow_us[anode][number] += duration_us;
+    if (separator_lit())
+        glow_separator_us += duration_us;
+}
+
+/**
+ * @brief Calculates how bright each cathode was since the previous call from the time it was latched as lit
+ *
+ * @param brightness 0 - 1 for each number of each tube where 1 means lit during the whole multiplexing slot
+ * of this tube (1 / DIGITS_NUM of time). Can be more than 1 if anodes overlap
+ * @param separator 0 - 1 for the separator (lit during the whole time)
+ */
+void native_glow(float brightness[DIGITS_NUM][10], float *separator) {
+    glow_accumulate();
+    float window_us = time_us > glow_window_us ? (float) (time_us - glow_window_us) : 1.f;
+    for (uint8_t anode = 0; anode < DIGITS_NUM; ++anode) {
+        for (uint8_t number = 0; number < 10U; ++number) {
+            brightness[anode][number] = glow_us[anode][number] * DIGITS_NUM / window_us;
+            glow_us[anode][number] = 0;
+        }
+    }
+    *separator = glow_separator_us / window_us;
+    glow_separator_us = 0;
+    glow_window_us = time_us;
+}
+
+/**
+ * @brief Decodes anode, number and separator of the shift registers word
+ *
+ * @param word latched word
+ * @param number pointer to store lit number (0-9), 10 if none or 11 if more than one
+ * @param separator pointer to store separator state
+ * @return uint8_t index of the active anode or DIGITS_NUM if none
+ */
+static uint8_t decode_word(uint16_t word, uint8_t *number, boolean *separator) {
+    uint8_t anode = DIGITS_NUM;
+    for (uint8_t i = 0; i < DIGITS_NUM; ++i) {
+#ifdef ANODES_INVERTED
+        boolean active = !(word & PINS_ANODES[i]);
+#else
+        boolean active = word & PINS_ANODES[i];
+#endif
+        if (active) {
+            anode = i;
+            break;
+        }
+    }
+
+    *number = 10U;
+    for (uint8_t i = 0; i < 10U; ++i) {
+#ifdef NUMBERS_INVERTED
+        boolean active = !(word & PINS_NUMBERS[i]);
+#else
+        boolean active = word & PINS_NUMBERS[i];
+#endif
+        if (active)
+            *number = *number == 10U ? i : 11U;
+    }
+
+#ifdef SEPARATOR_INVERTED
+    *separator = !(word & PIN_SEPARATOR);
+#else
+    *separator = word & PIN_SEPARATOR;
+#endif
+    return anode;
+}
+
+/**
+ * @brief Reconstructs what is shown from the last word latched in each multiplexing slot
+ *
+ * @param text buffer of at least NATIVE_DISPLAY_LENGTH bytes. Format: "12:34" where each digit is 0-9, "_" if tube is
+ * OFF or "?" if multiple numbers are lit, and ":" / "_" is separator state
+ */
+void native_display(char *text) {
+    boolean separator_any = false;
+    uint8_t position = 0;
+    for (uint8_t slot = 0; slot < DIGITS_NUM; ++slot) {
+        uint8_t number;
+        boolean separator;
+        decode_word(slot_words[slot], &number, &separator);
+        separator_any |= separator;
+        if (slot == DIGITS_NUM / 2U)
+            position++;
+        text[position++] = number < 10U ? '0' + number : (number == 10U ? '_' : '?');
+    }
+    text[DIGITS_NUM / 2U] = separator_any ? ':' : '_';
+    text[position] = '\0';
+}
+
+/**
+ * @return uint32_t number of latched words since startup
+ */
+uint32_t native_shift_register_writes(void) { return shift_register_writes; }
+
+float native_converter_voltage(void) { return converter_voltage; }
+
+/**
+ * @brief Sets converter output voltage so that CONVERTER_SENSE_PIN reads given value
+ *
+ * @param value raw ADC value (0-1023)
+ */
+void native_converter_set_adc(uint16_t value) {
+    converter_voltage = value / 1023.f * VREF_ACTUAL_MV / (CONVERTER_R_LOW / (CONVERTER_R_LOW + CONVERTER_R_HIGH));
+}
+
+float native_converter_duty(void) {
+    return converter_period && converter_running && !converter_halted
+               ? (float) converter_compare / (float) converter_period
+               : 0.f;
+}
+
+/**
+ * @return boolean true if converter was stopped with converter_pwm_stop() (and not started again)
+ */
+boolean native_converter_stopped(void) { return converter_halted; }
+
+/**
+ * @return float frequency of buzzer PWM in Hz (phase correct mode, OCR2A as top)
+ */
+float native_buzzer_frequency(void) {
+    static const uint16_t PRESCALERS[8] = {0, 1, 8, 32, 64, 128, 256, 1024};
+    if (buzzer_prescaler == 0 || buzzer_prescaler > 7U || buzzer_top == 0)
+        return 0.f;
+    return (float) F_CPU / (2.f * PRESCALERS[buzzer_prescaler] * buzzer_top);
+}
+
+float native_buzzer_duty(void) { return buzzer_top ? (float) buzzer_compare / (float) buzzer_top : 0.f; }
+
+/**
+ * @return uint32_t number of notes started since startup (each rise of the buzzer PWM duty cycle)
+ */
+uint32_t native_buzzer_notes(void) { return buzzer_notes; }
+
+/**
+ * @brief Loads EEPROM image from file. Missing file means erased EEPROM
+ */
+boolean native_eeprom_load(const char *path) {
+    memset(eeprom, 0xFF, sizeof(eeprom));
+    eeprom_initialized = true;
+    FILE *file = fopen(path, "rb");
+    if (!file)
+        return false;
+    size_t read = fread(eeprom, 1, sizeof(eeprom), file);
+    fclose(file);
+    return read == sizeof(eeprom);
+}
+
+boolean native_eeprom_save(const char *path) {
+    FILE *file = fopen(path, "wb");
+    if (!file)
+        return false;
+    size_t written = fwrite(eeprom, 1, sizeof(eeprom), file);
+    fclose(file);
+    return written == sizeof(eeprom);
+}
+
+uint32_t HAL::millis(void) { return time_us / 1000ULL; }
+
+uint32_t HAL::micros(void) { return time_us; }
+
+/**
+ * @brief Advances virtual time (interrupts are fired during the delay)
+ */
+void HAL::delay(uint32_t milliseconds) { native_advance(milliseconds * 1000UL); }
+
+void HAL::pin_output(uint8_t pin) {}
+
+void HAL::pin_input_pullup(uint8_t pin) {
+    if (pin < _PINS_NUM)
+        pin_states[pin] = true;
+}
+
+void HAL::pin_write(uint8_t pin, boolean state) {
+    if (pin < _PINS_NUM)
+        pin_states[pin] = state;
+}
+
+boolean HAL::pin_read(uint8_t pin) { return native_pin_get(pin); }
+
+/**
+ * @return uint8_t PCINT group as on Atmega328P (0: D8-D13, 1: A0-A5, 2: D0-D7)
+ */
+uint8_t HAL::pin_change_group(uint8_t pin) { return pin <= 7U ? 2U : (pin <= 13U ? 0U : 1U); }
+
+void HAL::pin_change_attach(uint8_t pin, HALPinChangeCallback callback) {
+    pin_change_callback = callback;
+    if (pin < _PINS_NUM)
+        pin_change_enabled[pin] = true;
+}
+
+void HAL::external_interrupt_attach(uint8_t pin, HALCallback callback) {
+    if (pin < _PINS_NUM)
+        external_callbacks[pin] = callback;
+}
+
+void HAL::multiplex_timer_init(HALCallback callback) {
+    multiplex_callback = callback;
+    multiplex_next_us = time_us + NATIVE_MULTIPLEX_PERIOD_US;
+}
+
+void HAL::multiplex_dim_init(HALCallback callback) { dim_callback = callback; }
+
+void HAL::multiplex_dim_write(uint8_t on_time, uint8_t on_time_next) { dim_on_time = on_time; }
+
+void HAL::converter_pwm_init(uint16_t period_cycles, boolean inverted) {
+    converter_period = period_cycles;
+    converter_running = true;
+}
+
+void HAL::converter_pwm_write(uint16_t compare) { converter_compare = compare; }
+
+void HAL::converter_pwm_stop(void) { converter_halted = true; }
+
+void HAL::converter_pwm_start(void) { converter_halted = false; }
+
+void HAL::buzzer_pwm_init(void) {}
+
+void HAL::buzzer_pwm_frequency(uint8_t prescaler, uint8_t top) {
+    buzzer_prescaler = prescaler;
+    buzzer_top = top;
+}
+
+void HAL::buzzer_pwm_write(uint8_t compare) {
+    if (compare > buzzer_compare)
+        buzzer_notes++;
+    buzzer_compare = compare;
+}
+
+void HAL::adc_init(void) {}
+
+/**
+ * @return uint16_t converter output voltage for CONVERTER_SENSE_PIN or value from native_adc_set()
+ */
+uint16_t HAL::adc_read(uint8_t pin) {
+    if (pin == CONVERTER_SENSE_PIN) {
+        float sense = converter_voltage * (CONVERTER_R_LOW / (CONVERTER_R_LOW + CONVERTER_R_HIGH));
+        float raw = sense / VREF_ACTUAL_MV * 1023.f;
+        return raw > 1023.f ? 1023U : (uint16_t) raw;
+    }
+    return pin < _PINS_NUM ? adc_values[pin] : 0U;
+}
+
+void HAL::spi_init(uint8_t latch_pin) {}
+
+void HAL::spi_write_word(uint16_t data) {
+    glow_accumulate();
+    shift_register = data;
+    shift_register_writes++;
+
+    uint8_t number;
+    boolean separator;
+    uint8_t anode = decode_word(data, &number, &separator);
+    if (anode < DIGITS_NUM)
+        slot_words[anode] = data;
+}
+
+void HAL::twi_init(void) {}
+
+/**
+ * @return uint8_t 0 in case of success or 2 if device didn't respond (same as Wire.endTransmission())
+ */
+uint8_t HAL::twi_write(uint8_t address, const uint8_t *data, uint8_t length) {
+    if (address == RTC_ADDRESS && !rtc_failed) {
+        if (length) {
+            rtc_pointer = data[0] % _RTC_REGISTERS_NUM;
+            for (uint8_t i = 1; i < length; ++i) {
+                rtc_registers[rtc_pointer] = data[i];
+                rtc_pointer = (rtc_pointer + 1U) % _RTC_REGISTERS_NUM;
+            }
+        }
+        return 0;
+    }
+    if (address == SHT_ADDRESS && !sensor_failed) {
+        sensor_requested = length == 2U && data[0] == READ_TEMP_HUMID_0 && data[1] == READ_TEMP_HUMID_1;
+        return 0;
+    }
+    return 2U;
+}
+
+/**
+ * @return uint8_t number of bytes read (0 if device didn't respond)
+ */
+uint8_t HAL::twi_read(uint8_t address, uint8_t *data, uint8_t length) {
+    if (address == RTC_ADDRESS && !rtc_failed) {
+        for (uint8_t i = 0; i < length; ++i) {
+            data[i] = rtc_registers[rtc_pointer];
+            rtc_pointer = (rtc_pointer + 1U) % _RTC_REGISTERS_NUM;
+        }
+        return length;
+    }
+    if (address == SHT_ADDRESS && !sensor_failed && sensor_requested) {
+        sensor_requested = false;
+        uint8_t measurement[6];
+        uint16_t temperature = (uint16_t) lroundf((sensor_temperature + 45.f) / 175.f * 65535.f);
+        uint16_t humidity = (uint16_t) lroundf(sensor_humidity / 100.f * 65535.f);
+        measurement[0] = temperature >> 8;
+        measurement[1] = temperature & 0xFFU;
+        measurement[2] = sensor_crc(measurement[0], measurement[1]);
+        measurement[3] = humidity >> 8;
+        measurement[4] = humidity & 0xFFU;
+        measurement[5] = sensor_crc(measurement[3], measurement[4]);
+        uint8_t received = length < 6U ? length : 6U;
+        memcpy(data, measurement, received);
+        return received;
+    }
+    return 0;
+}
+
+uint8_t HAL::eeprom_read(uint16_t address) {
+    if (!eeprom_initialized) {
+        memset(eeprom, 0xFF, sizeof(eeprom));
+        eeprom_initialized = true;
+    }
+    return address <= E2END ? eeprom[address] : 0xFFU;
+}
+
+void HAL::eeprom_update(uint16_t address, uint8_t value) {
+    if (address <= E2END)
+        eeprom[address] = value;
+}
+
+boolean HAL::eeprom_ready(void) { return true; }
+
+uint8_t HAL::reset_cause(void) { return HAL_RESET_POWER; }
+
+/**
+ * @param timeout WDTO_... (15ms << timeout)
+ */
+void HAL::watchdog_enable(uint8_t timeout, HALCallback callback) {
+    watchdog_callback = callback;
+    watchdog_timeout_us = 15000UL << timeout;
+    watchdog_deadline_us = time_us + watchdog_timeout_us;
+    watchdog_enabled = true;
+}
+
+void HAL::watchdog_reset(void) { watchdog_deadline_us = time_us + watchdog_timeout_us; }
+
+/**
+ * @brief There is nothing to restart on the host, so just exits with an error
+ */
+void HAL::watchdog_restart(void) {
+    fprintf(stderr, "Watchdog reset at %llu us\n", (unsigned long long) time_us);
+    exit(EXIT_FAILURE);
+}
+
+// Host stack and heap have nothing in common with ATmega SRAM. Use bench/run.sh (simavr) to measure them
+uint16_t HAL::memory_static(void) { return 0U; }
+
+uint16_t HAL::memory_heap(void) { return 0U; }
+
+uint16_t HAL::memory_stack_free(void) { return 0U; }
+
+uint16_t HAL::memory_stack_free_min(void) { return 0U; }
+
+#endif
@@ -0,0 +1,99 @@
+/**
+ * @file mock.h
+ * @author Fern Lane
+ * @brief Control and inspection API of the mocked hardware (virtual time, pins, sensors, outputs)
+ *
+ * @copyright Copyright (c) 2024 Fern Lane
+ *
+ * This file is part of the in17clock distribution.
+ * See <https://github.com/F33RNI/in17clock> for more info.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * long with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MOCK_H__
+#define MOCK_H__
+
+#include "../include/hal.h"
+
+#include "../include/digits.h"
+
+// Timer 0 runs in fast PWM mode with TOP = 0xFF (Arduino core), so multiplexing interrupt period is 64 * 256 cycles
+#define NATIVE_MULTIPLEX_PERIOD_US (64UL * 256UL / (F_CPU / 1000000UL))
+
+// Virtual time that one loop() call takes
+#define NATIVE_LOOP_TIME_US 500UL
+
+// Converter model: output voltage at 100% duty cycle, time constant of the output filter and output voltage drop per
+// each lit element (number or separator) at the same duty cycle
+#define NATIVE_CONVERTER_GAIN_V 400.f
+#define NATIVE_CONVERTER_TAU_US 20000.f
+#define NATIVE_CONVERTER_LOAD_V 10.f
+
+// Virtual time
+void native_advance(uint32_t microseconds);
+uint64_t native_time(void);
+
+// Pins (buttons, switches). Calls pin change / external interrupts
+void native_pin_set(uint8_t pin, boolean state);
+boolean native_pin_get(uint8_t pin);
+
+// Analog inputs other than converter sense pin (raw 0-1023)
+void native_adc_set(uint8_t pin, uint16_t value);
+
+// Converter sense pin value (replaces output voltage of the converter model until it settles back)
+void native_converter_set_adc(uint16_t value);
+
+// DS3231
+void native_rtc_set(uint8_t hours, uint8_t minutes, uint8_t seconds, uint8_t day, uint8_t month, uint8_t year);
+void native_rtc_fail(boolean fail);
+
+// Stops DS3231 clock, so SQW comes only from native_rtc_sqw() (used to replay recorded ticks)
+void native_rtc_hold(boolean hold);
+void native_rtc_sqw(uint8_t hours, uint8_t minutes, uint8_t seconds);
+
+// SHT31
+void native_sensor_set(float temperature, float humidity);
+void native_sensor_fail(boolean fail);
+
+// Tube elements that don't light (and don't load the converter). Number 0-9 of the tube (0 to DIGITS_NUM - 1)
+void native_cathode_fail(uint8_t tube, uint8_t number, boolean fail);
+void native_separator_fail(boolean fail);
+
+// Console input (as if it was typed into the serial port)
+void native_serial_inject(const char *text);
+
+// Display as text ("12:34")
+#define NATIVE_DISPLAY_LENGTH 6U
+void native_display(char *text);
+
+// Time-averaged brightness of each cathode and the separator since the previous call (see visualizer.h)
+void native_glow(float brightness[DIGITS_NUM][10], float *separator);
+
+// Outputs
+uint8_t native_dim_on_time(void);
+uint16_t native_shift_register(void);
+uint32_t native_shift_register_writes(void);
+float native_converter_voltage(void);
+float native_converter_duty(void);
+boolean native_converter_stopped(void);
+float native_buzzer_frequency(void);
+float native_buzzer_duty(void);
+uint32_t native_buzzer_notes(void);
+
+// EEPROM image (returns false on file error)
+boolean native_eeprom_load(const char *path);
+boolean native_eeprom_save(const char *path);
+
+#endif
@@ -0,0 +1,145 @@
+/**
+ * @file native.cpp
+ * @author Fern Lane
+ * @brief Print and Serial implementation for the Linux host (stdin / stdout)
+ *
+ * @copyright Copyright (c) 2024 Fern Lane
+ *
+ * This file is part of the in17clock distribution.
+ * See <https://github.com/F33RNI/in17clock> for more info.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * long with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __AVR__
+
+#include <poll.h>
+#include <stdio.h>
+#include <unistd.h>
+
+#include "mock.h"
+
+// Same as Arduino TX buffer size - 1
+#define _SERIAL_TX_FREE 63
+
+// Size of the buffer for native_serial_inject()
+#define _SERIAL_INJECT_SIZE 256U
+
+// Preinstantiate
+HardwareSerial Serial;
+
+static char inject_buffer[_SERIAL_INJECT_SIZE];
+static size_t inject_head, inject_tail;
+
+/**
+ * @brief Appends text to the serial input. It will be read before stdin
+ */
+void native_serial_inject(const char *text) {
+    while (*text && inject_head - inject_tail < _SERIAL_INJECT_SIZE)
+        inject_buffer[inject_head++ % _SERIAL_INJECT_SIZE] = *text++;
+}
+
+size_t Print::write(const uint8_t *buffer, size_t size) {
+    size_t written = 0;
+    while (size--)
+        written += write(*buffer++);
+    return written;
+}
+
+size_t Print::print(const __FlashStringHelper *str) { return write((const char *) str); }
+
+size_t Print::print(const char *str) { return write(str); }
+
+size_t Print::print(char c) { return write((uint8_t) c); }
+
+size_t Print::print(unsigned char number, int base) { return print_number(number, base); }
+
+size_t Print::print(int number, int base) { return print((long) number, base); }
+
+size_t Print::print(unsigned int number, int base) { return print_number(number, base); }
+
+size_t Print::print(long number, int base) {
+    if (number < 0 && base == DEC)
+        return write('-') + print_number(-(unsigned long) number, base);
+    return print_number(number, base);
+}
+
+size_t Print::print(unsigned long number, int base) { return print_number(number, base); }
+
+size_t Print::print(double number, int digits) {
+    char buffer[48];
+    snprintf(buffer, sizeof(buffer), "%.*f", digits, number);
+    return write(buffer);
+}
+
+size_t Print::println(void) { return write('\r') + write('\n'); }
+
+size_t Print::print_number(unsigned long number, uint8_t base) {
+    char buffer[8 * sizeof(unsigned long) + 1];
+    char *str = &buffer[sizeof(buffer) - 1];
+    *str = '\0';
+    if (base < 2U)
+        base = 10U;
+    do {
+        char digit = number % base;
+        number /= base;
+        *--str = digit < 10 ? digit + '0' : digit + 'A' - 10;
+    } while (number);
+    return write(str);
+}
+
+void HardwareSerial::begin(unsigned long baud_rate) { setvbuf(stdout, NULL, _IOLBF, 0); }
+
+/**
+ * @return int 1 if injected text or stdin has data (doesn't block), 0 otherwise
+ */
+int HardwareSerial::available(void) {
+    if (peeked >= 0)
+        return 1;
+    if (inject_tail != inject_head) {
+        peeked = (unsigned char) inject_buffer[inject_tail++ % _SERIAL_INJECT_SIZE];
+        return 1;
+    }
+    struct pollfd stdin_poll = {STDIN_FILENO, POLLIN, 0};
+    if (poll(&stdin_poll, 1, 0) <= 0 || !(stdin_poll.revents & POLLIN))
+        return 0;
+    unsigned char c;
+    if (::read(STDIN_FILENO, &c, 1) != 1)
+        return 0;
+    peeked = c;
+    return 1;
+}
+
+int HardwareSerial::read(void) {
+    if (!available())
+        return -1;
+    int c = peeked;
+    peeked = -1;
+    return c;
+}
+
+int HardwareSerial::peek(void) { return available() ? peeked : -1; }
+
+int HardwareSerial::availableForWrite(void) { return _SERIAL_TX_FREE; }
+
+void HardwareSerial::flush(void) { fflush(stdout); }
+
+size_t HardwareSerial::write(uint8_t c) {
+    // Skip carriage returns on the host terminal
+    if (c != '\r')
+        putchar(c);
+    return 1;
+}
+
+#endif
@@ -0,0 +1,155 @@
+/**
+ * @file native.h
+ * @author Fern Lane
+ * @brief Minimal subset of Arduino / avr-libc API for building on the Linux host (see hal_native.cpp)
+ *
+ * @copyright Copyright (c) 2024 Fern Lane
+ *
+ * This file is part of the in17clock distribution.
+ * See <https://github.com/F33RNI/in17clock> for more info.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * long with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef NATIVE_H__
+#define NATIVE_H__
+
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef bool boolean;
+typedef uint8_t byte;
+
+#define HIGH 1U
+#define LOW  0U
+
+#define DEC 10
+#define HEX 16
+
+// Same clock and memory as Atmega328P, so all compile-time calculations in config.h stay the same
+#ifndef F_CPU
+#define F_CPU 16000000UL
+#endif
+#define E2END 0x3FFU
+
+#define A0 14U
+#define A1 15U
+#define A2 16U
+#define A3 17U
+#define A4 18U
+#define A5 19U
+#define A6 20U
+#define A7 21U
+
+#define _BV(bit) (1U << (bit))
+
+// Flash is the same as RAM
+#define PROGMEM
+#define PSTR(s)                (s)
+#define pgm_read_byte(address) (*(const uint8_t *) (address))
+#define pgm_read_word(address) (*(const uint16_t *) (address))
+#define pgm_read_ptr(address)  (*(void *const *) (address))
+#define strcmp_P               strcmp
+#define memcpy_P               memcpy
+
+class __FlashStringHelper;
+#define F(s) ((const __FlashStringHelper *) (s))
+
+// Interrupts are emulated from the main thread (see native_advance()), so there is nothing to block
+#define ATOMIC_RESTORESTATE 0
+#define ATOMIC_BLOCK(type)  for (uint8_t _atomic_once = 1; _atomic_once; _atomic_once = 0)
+
+// Watchdog timeouts (same values as in avr/wdt.h)
+#define WDTO_15MS  0U
+#define WDTO_30MS  1U
+#define WDTO_60MS  2U
+#define WDTO_120MS 3U
+#define WDTO_250MS 4U
+#define WDTO_500MS 5U
+#define WDTO_1S    6U
+#define WDTO_2S    7U
+#define WDTO_4S    8U
+#define WDTO_8S    9U
+
+/**
+ * @brief Same as avr-libc _crc16_update() (polynomial 0xA001)
+ */
+static inline uint16_t _crc16_update(uint16_t crc, uint8_t data) {
+    crc ^= data;
+    for (uint8_t i = 0; i < 8U; ++i)
+        crc = (crc & 1U) ? (crc >> 1U) ^ 0xA001U : (crc >> 1U);
+    return crc;
+}
+
+static inline long map(long x, long in_min, long in_max, long out_min, long out_max) {
+    return (x - in_min) * (out_max - out_min) / (in_max - in_min) + out_min;
+}
+
+static inline void randomSeed(unsigned long seed) { srandom(seed); }
+
+class Print {
+  public:
+    virtual size_t write(uint8_t c) = 0;
+    virtual size_t write(const uint8_t *buffer, size_t size);
+    size_t write(const char *str) { return str ? write((const uint8_t *) str, strlen(str)) : 0; }
+
+    size_t print(const __FlashStringHelper *str);
+    size_t print(const char *str);
+    size_t print(char c);
+    size_t print(unsigned char number, int base = DEC);
+    size_t print(int number, int base = DEC);
+    size_t print(unsigned int number, int base = DEC);
+    size_t print(long number, int base = DEC);
+    size_t print(unsigned long number, int base = DEC);
+    size_t print(double number, int digits = 2);
+
+    size_t println(void);
+    template <typename T> size_t println(T value) { return print(value) + println(); }
+    template <typename T> size_t println(T value, int format) { return print(value, format) + println(); }
+
+  private:
+    size_t print_number(unsigned long number, uint8_t base);
+};
+
+class Stream : public Print {
+  public:
+    virtual int available(void) = 0;
+    virtual int read(void) = 0;
+    virtual int peek(void) = 0;
+};
+
+// Serial port mapped to stdin (non-blocking) and stdout
+class HardwareSerial : public Stream {
+  public:
+    void begin(unsigned long baud_rate);
+    void end(void) {}
+    int available(void) override;
+    int read(void) override;
+    int peek(void) override;
+    int availableForWrite(void);
+    void flush(void);
+    size_t write(uint8_t c) override;
+    using Print::write;
+    operator bool() { return true; }
+
+  private:
+    int peeked = -1;
+};
+
+extern HardwareSerial Serial;
+
+#endif
@@ -0,0 +1,130 @@
+/**
+ * @file native_main.cpp
+ * @author Fern Lane
+ * @brief Entry point of the Linux host build. Runs setup() and loop() in virtual time with mocked hardware
+ * Serial console is mapped to stdin / stdout
+ *
+ * Usage: in17clock [-e eeprom.bin] [-t seconds] [-f] [-s script] [-v]
+ *   -e  load EEPROM image from file (and save it on exit)
+ *   -t  exit after this number of virtual seconds
+ *   -f  run as fast as possible instead of real time
+ *   -s  run simulation script (see sim.h) as fast as possible and exit with its result
+ *   -v  draw tubes in the terminal (see visualizer.h)
+ *
+ * @copyright Copyright (c) 2024 Fern Lane
+ *
+ * This file is part of the in17clock distribution.
+ * See <https://github.com/F33RNI/in17clock> for more info.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * long with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __AVR__
+
+#include <stdio.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "sim.h"
+#include "visualizer.h"
+
+void setup(void);
+void loop(void);
+
+static const char *eeprom_path;
+
+static void save_eeprom(void) {
+    if (eeprom_path && !native_eeprom_save(eeprom_path))
+        fprintf(stderr, "Unable to save EEPROM into %s\n", eeprom_path);
+}
+
+/**
+ * @return uint64_t host monotonic time in microseconds
+ */
+static uint64_t host_micros(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t) now.tv_sec * 1000000ULL + now.tv_nsec / 1000ULL;
+}
+
+int main(int argc, char **argv) {
+    uint64_t duration_us = 0;
+    boolean fast = false, visualize = false;
+    const char *script_path = NULL;
+
+    int option;
+    while ((option = getopt(argc, argv, "e:t:fs:v")) != -1) {
+        switch (option) {
+        case 'e':
+            eeprom_path = optarg;
+            break;
+        case 't':
+            duration_us = strtoull(optarg, NULL, 10) * 1000000ULL;
+            break;
+        case 'f':
+            fast = true;
+            break;
+        case 's':
+            script_path = optarg;
+            break;
+        case 'v':
+            visualize = true;
+            break;
+        default:
+            fprintf(stderr, "Usage: %s [-e eeprom.bin] [-t seconds] [-f] [-s script] [-v]\n", argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (eeprom_path) {
+        native_eeprom_load(eeprom_path);
+        atexit(save_eeprom);
+    }
+
+    // Start from the host local time
+    time_t host_time = time(NULL);
+    struct tm *local = localtime(&host_time);
+    native_rtc_set(local->tm_hour, local->tm_min, local->tm_sec, local->tm_mday, local->tm_mon + 1,
+                   local->tm_year % 100);
+
+    setup();
+
+    if (script_path)
+        return sim_script(script_path) ? EXIT_SUCCESS : EXIT_FAILURE;
+
+    if (visualize)
+        visualizer_init();
+
+    uint64_t started_us = host_micros() - native_time(), frame_us = 0;
+    while (!duration_us || native_time() < duration_us) {
+        loop();
+        native_advance(NATIVE_LOOP_TIME_US);
+
+        if (visualize && host_micros() - frame_us >= VISUALIZER_FRAME_US) {
+            frame_us = host_micros();
+            visualizer_draw();
+        }
+
+        // Don't run faster than real time
+        if (!fast) {
+            int64_t ahead_us = (int64_t) native_time() - (int64_t) (host_micros() - started_us);
+            if (ahead_us > 1000)
+                usleep(ahead_us);
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
+
+#endif
@@ -0,0 +1,480 @@
+/**
+ * @file sim.cpp
+ * @author Fern Lane
+ * @brief Accelerated-time simulator. Runs firmware loop() against the mocked HAL using scripted inputs and assertions
+ * See sim.h for script commands
+ *
+ * @copyright Copyright (c) 2024 Fern Lane
+ *
+ * This file is part of the in17clock distribution.
+ * See <https://github.com/F33RNI/in17clock> for more info.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * long with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __AVR__
+
+#include <stdio.h>
+
+#include "sim.h"
+
+#include "../include/pins.h"
+
+#include "../include/buttons.h"
+#include "../include/recorder.h"
+
+#define _LINE_LENGTH 256U
+
+void loop(void);
+
+static uint64_t step_us = NATIVE_LOOP_TIME_US;
+static boolean logging;
+
+static char frame_last[NATIVE_DISPLAY_LENGTH];
+static char frames[SIM_FRAMES_MAX][NATIVE_DISPLAY_LENGTH];
+static uint16_t frames_num;
+static uint32_t notes_mark, notes_last;
+
+/**
+ * @brief Prints virtual time as "d hh:mm:ss.mmm"
+ */
+static void print_time(FILE *file) {
+    uint64_t ms = native_time() / 1000ULL;
+    fprintf(file, "[%llu %02u:%02u:%02u.%03u] ", (unsigned long long) (ms / 86400000ULL),
+            (unsigned) (ms / 3600000ULL % 24ULL), (unsigned) (ms / 60000ULL % 60ULL), (unsigned) (ms / 1000ULL % 60ULL),
+            (unsigned) (ms % 1000ULL));
+}
+
+/**
+ * @brief Records display frame (if changed) and buzzer notes after each loop() call
+ */
+static void sample(void) {
+    char frame[NATIVE_DISPLAY_LENGTH];
+    native_display(frame);
+    if (strcmp(frame, frame_last)) {
+        strcpy(frame_last, frame);
+        if (logging) {
+            print_time(stdout);
+            printf("display %s\n", frame);
+        }
+        boolean seen = false;
+        for (uint16_t i = 0; i < frames_num && !seen; ++i)
+            seen = !strcmp(frames[i], frame);
+        if (!seen && frames_num < SIM_FRAMES_MAX)
+            strcpy(frames[frames_num++], frame);
+    }
+
+    uint32_t notes = native_buzzer_notes();
+    if (notes != notes_last) {
+        notes_last = notes;
+        if (logging) {
+            print_time(stdout);
+            printf("note %.1fHz\n", native_buzzer_frequency());
+        }
+    }
+}
+
+/**
+ * @brief Calls loop() and advances virtual time by the current step until given time passes
+ *
+ * @param microseconds virtual time to run
+ */
+void sim_run(uint64_t microseconds) {
+    uint64_t target_us = native_time() + microseconds;
+    while (native_time() < target_us) {
+        loop();
+        uint64_t left_us = target_us - native_time();
+        native_advance(left_us < step_us ? left_us : step_us);
+        sample();
+    }
+}
+
+/**
+ * @brief Parses time with suffix (us, ms, s, m, h, d)
+ *
+ * @return boolean false if invalid
+ */
+static boolean parse_time(const char *text, uint64_t *microseconds) {
+    if (!text)
+        return false;
+    char *suffix;
+    double value = strtod(text, &suffix);
+    if (suffix == text || value < 0.)
+        return false;
+    double multiplier;
+    if (!strcmp(suffix, "us"))
+        multiplier = 1.;
+    else if (!strcmp(suffix, "ms"))
+        multiplier = 1e3;
+    else if (!strcmp(suffix, "s"))
+        multiplier = 1e6;
+    else if (!strcmp(suffix, "m"))
+        multiplier = 60e6;
+    else if (!strcmp(suffix, "h"))
+        multiplier = 3600e6;
+    else if (!strcmp(suffix, "d"))
+        multiplier = 86400e6;
+    else
+        return false;
+    *microseconds = (uint64_t) (value * multiplier);
+    return true;
+}
+
+/**
+ * @return uint8_t pin of the button or 255 if name is unknown
+ */
+static uint8_t parse_button(const char *name) {
+    if (!name)
+        return 255U;
+    if (!strcmp(name, "up"))
+        return PIN_BTN_UP;
+    if (!strcmp(name, "down"))
+        return PIN_BTN_DOWN;
+    if (!strcmp(name, "weather"))
+        return PIN_BTN_WEATHER;
+    if (!strcmp(name, "set"))
+        return PIN_BTN_SET;
+    return 255U;
+}
+
+/**
+ * @return boolean true if frame matches pattern ("?" matches any character)
+ */
+static boolean match(const char *pattern, const char *frame) {
+    if (strlen(pattern) != strlen(frame))
+        return false;
+    for (; *pattern; ++pattern, ++frame)
+        if (*pattern != '?' && *pattern != *frame)
+            return false;
+    return true;
+}
+
+/**
+ * @brief Executes "expect ..." command
+ *
+ * @param detail buffer of _LINE_LENGTH bytes to store failure details
+ * @return boolean true if assertion passed
+ */
+static boolean expect(const char *what, char *args, char *detail) {
+    char *arg_1 = strtok(args, " \t");
+    char *arg_2 = strtok(NULL, " \t");
+
+    if (!strcmp(what, "display") && arg_1) {
+        char frame[NATIVE_DISPLAY_LENGTH];
+        native_display(frame);
+        if (match(arg_1, frame))
+            return true;
+        snprintf(detail, _LINE_LENGTH, "display is %s", frame);
+        return false;
+    }
+
+    if (!strcmp(what, "seen") && arg_1) {
+        for (uint16_t i = 0; i < frames_num; ++i)
+            if (match(arg_1, frames[i]))
+                return true;
+        snprintf(detail, _LINE_LENGTH, "%u frames since mark, none matched", frames_num);
+        return false;
+    }
+
+    if (!strcmp(what, "notes") && arg_1) {
+        uint32_t notes = native_buzzer_notes() - notes_mark;
+        if (notes >= strtoul(arg_1, NULL, 10) && (!arg_2 || notes <= strtoul(arg_2, NULL, 10)))
+            return true;
+        snprintf(detail, _LINE_LENGTH, "%u notes since mark", notes);
+        return false;
+    }
+
+    if (!strcmp(what, "buzzer") && arg_1) {
+        boolean sounding = native_buzzer_duty() > 0.f;
+        if (sounding == !strcmp(arg_1, "on"))
+            return true;
+        snprintf(detail, _LINE_LENGTH, "buzzer is %s", sounding ? "on" : "off");
+        return false;
+    }
+
+    if (!strcmp(what, "voltage") && arg_1 && arg_2) {
+        float voltage = native_converter_voltage();
+        if (voltage >= strtof(arg_1, NULL) && voltage <= strtof(arg_2, NULL))
+            return true;
+        snprintf(detail, _LINE_LENGTH, "voltage is %.1fV", voltage);
+        return false;
+    }
+
+    if (!strcmp(what, "dim") && arg_1 && arg_2) {
+        uint8_t on_time = native_dim_on_time();
+        if (on_time >= strtoul(arg_1, NULL, 10) && on_time <= strtoul(arg_2, NULL, 10))
+            return true;
+        snprintf(detail, _LINE_LENGTH, "tubes are ON for %u/256 of the slot", on_time);
+        return false;
+    }
+
+    snprintf(detail, _LINE_LENGTH, "invalid expect");
+    return false;
+}
+
+/**
+ * @brief Runs loop() until given virtual time (if it's not in the past)
+ */
+static void run_until(uint64_t time_us) {
+    if (time_us > native_time())
+        sim_run(time_us - native_time());
+}
+
+/**
+ * @brief Replays events recorded by the firmware (output of the "rec" console command). Other lines are ignored, so
+ * the whole serial log can be used. DS3231 is held, so SQW ticks come only from the recording
+ *
+ * @param path path to the serial log
+ * @return boolean false if file can't be opened, has no events or has invalid event
+ */
+static boolean replay(const char *path) {
+    static const uint8_t buttons_pins[] = {PIN_BTN_UP, PIN_BTN_DOWN, PIN_BTN_WEATHER, PIN_BTN_SET, PIN_SW_ALARM};
+
+    FILE *file = fopen(path, "r");
+    if (!file) {
+        fprintf(stderr, "Unable to open %s\n", path);
+        return false;
+    }
+
+    // Events are edges, so start with all buttons released and alarm switch in the state before its first edge
+    char line[_LINE_LENGTH], name[16];
+    unsigned long time_ms, time_first_ms = 0;
+    int values[4];
+    for (uint8_t i = 0; i < BUTTON_ALARM; ++i)
+        native_pin_set(buttons_pins[i], true);
+    while (fgets(line, sizeof(line), file)) {
+        if (sscanf(line, "rec\t%lu\tbutton\t%d\t%d", &time_ms, &values[0], &values[1]) == 3 &&
+            values[0] == BUTTON_ALARM) {
+            native_pin_set(PIN_SW_ALARM, values[1]);
+            break;
+        }
+    }
+    rewind(file);
+
+    native_rtc_hold(true);
+    uint64_t start_us = native_time();
+    uint32_t events = 0;
+    boolean valid = true;
+    while (valid && fgets(line, sizeof(line), file)) {
+        if (strncmp(line, "rec\t", 4))
+            continue;
+        int values_n = sscanf(line, "rec\t%lu\t%15s\t%d\t%d\t%d\t%d", &time_ms, name, &values[0], &values[1],
+                              &values[2], &values[3]);
+        if (values_n < 3) {
+            valid = false;
+            break;
+        }
+        if (!events++)
+            time_first_ms = time_ms;
+        uint64_t time_us = start_us + (uint64_t) (time_ms - time_first_ms) * 1000ULL;
+        run_until(time_us);
+
+        if (!strcmp(name, "button") && values_n == 4 && values[0] >= 0 && values[0] <= (int) BUTTON_ALARM)
+            native_pin_set(buttons_pins[values[0]], !values[1]);
+        else if (!strcmp(name, "sqw") && values_n == 6) {
+            // Consecutive ticks were merged into one event
+            for (int repeat = 0; repeat <= values[3]; ++repeat) {
+                if (repeat) {
+                    run_until(time_us + (uint64_t) repeat * RECORDER_SQW_PERIOD * 1000ULL);
+                    if (++values[2] == 60) {
+                        values[2] = 0;
+                        if (++values[1] == 60) {
+                            values[1] = 0;
+                            values[0] = (values[0] + 1) % 24;
+                        }
+                    }
+                }
+                native_rtc_sqw(values[0], values[1], values[2]);
+            }
+        } else if (!strcmp(name, "sensor") && values_n == 4)
+            native_sensor_set(values[0] / 100.f, values[1]);
+        else if (!strcmp(name, "adc") && values_n == 3)
+            native_converter_set_adc(values[0]);
+        else
+            valid = false;
+    }
+    fclose(file);
+    native_rtc_hold(false);
+
+    if (!valid || !events) {
+        print_time(stderr);
+        fprintf(stderr, "%s after %u event(s)\n", valid ? "no events" : "invalid event", events);
+        return false;
+    }
+    if (logging) {
+        print_time(stdout);
+        printf("replayed %u event(s)\n", events);
+    }
+    return true;
+}
+
+/**
+ * @brief Executes one script line
+ *
+ * @return boolean false if command failed or is invalid
+ */
+static boolean execute(char *line) {
+    char *command = strtok(line, " \t");
+    if (!command)
+        return true;
+    char *rest = strtok(NULL, "");
+    char *arg_1 = rest ? strtok(rest, " \t") : NULL;
+    char *args = arg_1 ? strtok(NULL, "") : NULL;
+    uint64_t duration;
+    uint8_t pin;
+
+    if (!strcmp(command, "step") && parse_time(arg_1, &duration) && duration) {
+        step_us = duration;
+        return true;
+    }
+
+    if (!strcmp(command, "run") && parse_time(arg_1, &duration)) {
+        sim_run(duration);
+        return true;
+    }
+
+    if (!strcmp(command, "press") && (pin = parse_button(arg_1)) != 255U) {
+        duration = 200000ULL;
+        if (args && !parse_time(args, &duration))
+            return false;
+        native_pin_set(pin, false);
+        sim_run(duration);
+        native_pin_set(pin, true);
+        return true;
+    }
+
+    if ((!strcmp(command, "hold") || !strcmp(command, "release")) && (pin = parse_button(arg_1)) != 255U) {
+        native_pin_set(pin, command[0] == 'r');
+        return true;
+    }
+
+    if (!strcmp(command, "alarm") && arg_1) {
+        native_pin_set(PIN_SW_ALARM, strcmp(arg_1, "on"));
+        return true;
+    }
+
+    if (!strcmp(command, "time") && arg_1) {
+        unsigned hours, minutes, seconds, day = 1, month = 1, year = 24;
+        if (sscanf(arg_1, "%u:%u:%u", &hours, &minutes, &seconds) != 3 ||
+            (args && sscanf(args, "%u.%u.%u", &day, &month, &year) != 3))
+            return false;
+        native_rtc_set(hours, minutes, seconds, day, month, year);
+        return true;
+    }
+
+    if (!strcmp(command, "light") && arg_1) {
+        native_adc_set(PIN_LIGHT_SENSE, strtoul(arg_1, NULL, 10));
+        return true;
+    }
+
+    if (!strcmp(command, "sensor") && arg_1 && args) {
+        native_sensor_set(strtof(arg_1, NULL), strtof(args, NULL));
+        return true;
+    }
+
+    if ((!strcmp(command, "fail") || !strcmp(command, "recover")) && arg_1) {
+        boolean fail = command[0] == 'f';
+        if (!strcmp(arg_1, "rtc"))
+            native_rtc_fail(fail);
+        else if (!strcmp(arg_1, "sensor"))
+            native_sensor_fail(fail);
+        else if (!strcmp(arg_1, "separator"))
+            native_separator_fail(fail);
+        else if (!strcmp(arg_1, "anode") || !strcmp(arg_1, "cathode") || !strcmp(arg_1, "number")) {
+            unsigned first, second = 0;
+            if (!args || sscanf(args, "%u %u", &first, &second) < (arg_1[0] == 'n' ? 2 : 1))
+                return false;
+            for (uint8_t tube = 0; tube < DIGITS_NUM; ++tube)
+                for (uint8_t number = 0; number < 10U; ++number)
+                    if ((arg_1[0] == 'a' && tube + 1U == first) || (arg_1[0] == 'c' && number == first) ||
+                        (arg_1[0] == 'n' && tube + 1U == first && number == second))
+                        native_cathode_fail(tube, number, fail);
+        } else
+            return false;
+        return true;
+    }
+
+    if (!strcmp(command, "console") && arg_1) {
+        native_serial_inject(arg_1);
+        if (args) {
+            native_serial_inject(" ");
+            native_serial_inject(args);
+        }
+        native_serial_inject("\n");
+        return true;
+    }
+
+    if (!strcmp(command, "replay") && arg_1)
+        return replay(arg_1);
+
+    if (!strcmp(command, "log") && arg_1) {
+        logging = !strcmp(arg_1, "on");
+        return true;
+    }
+
+    if (!strcmp(command, "mark")) {
+        frames_num = 0;
+        frame_last[0] = '\0';
+        notes_mark = native_buzzer_notes();
+        sample();
+        return true;
+    }
+
+    if (!strcmp(command, "expect") && arg_1) {
+        char detail[_LINE_LENGTH], empty[1] = "";
+        if (expect(arg_1, args ? args : empty, detail))
+            return true;
+        print_time(stderr);
+        fprintf(stderr, "%s\n", detail);
+        return false;
+    }
+
+    return false;
+}
+
+/**
+ * @brief Runs simulation script. Prints failed lines into stderr
+ *
+ * @param path path to the script
+ * @return boolean true if all commands succeeded
+ */
+boolean sim_script(const char *path) {
+    FILE *file = fopen(path, "r");
+    if (!file) {
+        fprintf(stderr, "Unable to open %s\n", path);
+        return false;
+    }
+
+    char line[_LINE_LENGTH], original[_LINE_LENGTH];
+    uint16_t line_number = 0, failed = 0;
+    sample();
+    while (fgets(line, sizeof(line), file)) {
+        line_number++;
+        char *comment = strchr(line, '#');
+        if (comment)
+            *comment = '\0';
+        line[strcspn(line, "\r\n")] = '\0';
+        strcpy(original, line);
+        if (!execute(line)) {
+            fprintf(stderr, "%s:%u: failed: %s\n", path, line_number, original);
+            failed++;
+        }
+    }
+    fclose(file);
+
+    fprintf(stderr, "%s: %u command(s) failed\n", path, failed);
+    return failed == 0;
+}
+
+#endif
@@ -0,0 +1,65 @@
+/**
+ * @file sim.h
+ * @author Fern Lane
+ * @brief Accelerated-time simulator. Runs firmware loop() against the mocked HAL using scripted inputs and assertions
+ *
+ * Script is a text file with one command per line ("#" starts a comment). Time is a number with one of the suffixes:
+ * us, ms, s, m, h, d (ex. 250ms, 3d). Buttons: up, down, weather, set
+ *
+ *   step <time>                    virtual time that one loop() call takes (default NATIVE_LOOP_TIME_US)
+ *   run <time>                     run loop() for this virtual time
+ *   press <button> [time]          hold button for time (default 200ms) and release it
+ *   hold <button>                  press button and keep it pressed
+ *   release <button>               release button
+ *   alarm on|off                   alarm switch
+ *   time hh:mm:ss [dd.mm.yy]       set DS3231 time (and date)
+ *   sensor <temperature> <humidity>
+ *   light <value>                  raw ADC value of PIN_LIGHT_SENSE (0-1023)
+ *   fail rtc|sensor                device stops responding
+ *   fail anode <tube>              tube (1-4) doesn't light
+ *   fail cathode <number>          number (0-9) doesn't light in any tube
+ *   fail number <tube> <number>    number of the tube doesn't light
+ *   fail separator                 separator doesn't light
+ *   recover rtc|sensor|...         (same arguments as fail)
+ *   console <text>                 type line into the serial console
+ *   replay <file>                  replay input events from serial log with "rec" command output
+ *   log on|off                     print display frame changes and notes
+ *   mark                           start new window for "expect seen" and "expect notes"
+ *   expect display <pattern>       current display. Pattern is "12:34" where "_" is OFF and "?" is any character
+ *   expect seen <pattern>          display showed pattern at least once since mark
+ *   expect notes <min> [max]       number of buzzer notes since mark
+ *   expect buzzer on|off           buzzer is sounding now
+ *   expect voltage <min> <max>     converter output voltage
+ *   expect dim <min> <max>         part of each multiplexing slot the tubes are ON (0-255, 255 - not dimmed)
+ *
+ * @copyright Copyright (c) 2024 Fern Lane
+ *
+ * This file is part of the in17clock distribution.
+ * See <https://github.com/F33RNI/in17clock> for more info.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * long with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SIM_H__
+#define SIM_H__
+
+#include "mock.h"
+
+// Number of distinct display frames remembered since mark (for "expect seen")
+#define SIM_FRAMES_MAX 256U
+
+void sim_run(uint64_t microseconds);
+boolean sim_script(const char *path);
+
+#endif
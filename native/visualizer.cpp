@@ -0,0 +1,128 @@
+/**
+ * @file visualizer.cpp
+ * @author Fern Lane
+ * @brief Draws nixie tubes in the terminal (ANSI escape codes) from the words latched into the shift registers
+ *
+ * @copyright Copyright (c) 2024 Fern Lane
+ *
+ * This file is part of the in17clock distribution.
+ * See <https://github.com/F33RNI/in17clock> for more info.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * long with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __AVR__
+
+#include <math.h>
+#include <stdio.h>
+
+#include "visualizer.h"
+
+// 3x3 glyphs of numbers (UTF-8 box drawing characters)
+static const char *const GLYPHS[10][3] = {
+    {"┏━┓", "┃ ┃", "┗━┛"}, {" ┓ ", " ┃ ", " ┻ "}, {"┏━┓", "┏━┛", "┗━━"}, {"━━┓", " ━┫", "━━┛"},
+    {"╻ ╻", "┗━┫", "  ╹"}, {"┏━━", "┗━┓", "━━┛"}, {"┏━━", "┣━┓", "┗━┛"}, {"━━┓", "  ┃", "  ╹"},
+    {"┏━┓", "┣━┫", "┗━┛"}, {"┏━┓", "┗━┫", "━━┛"},
+};
+
+static const uint8_t COLOR_LIT[3] = {VISUALIZER_COLOR_LIT};
+static const uint8_t COLOR_UNLIT[3] = {VISUALIZER_COLOR_UNLIT};
+
+/**
+ * @brief Restores terminal scrolling region
+ */
+static void visualizer_end(void) { fprintf(stderr, "\x1b[r\n"); }
+
+/**
+ * @brief Sets terminal foreground color between unlit and lit according to the brightness
+ *
+ * @param brightness 0 - 1 (time-averaged, without gamma correction)
+ */
+static void set_color(float brightness) {
+    float lightness = powf(brightness > 1.f ? 1.f : brightness, VISUALIZER_GAMMA);
+    uint8_t color[3];
+    for (uint8_t i = 0; i < 3U; ++i)
+        color[i] = COLOR_UNLIT[i] + (uint8_t) ((COLOR_LIT[i] - COLOR_UNLIT[i]) * lightness);
+    fprintf(stderr, "\x1b[38;2;%u;%u;%um", color[0], color[1], color[2]);
+}
+
+/**
+ * @brief Clears terminal and reserves its top lines for the display (console output will scroll below)
+ */
+void visualizer_init(void) {
+    fprintf(stderr, "\x1b[2J\x1b[%u;r\x1b[%u;1H", VISUALIZER_LINES + 1U, VISUALIZER_LINES + 1U);
+    atexit(visualizer_end);
+}
+
+/**
+ * @brief Draws one frame with brightness averaged since the previous one
+ */
+void visualizer_draw(void) {
+    float brightness[DIGITS_NUM][10], separator;
+    native_glow(brightness, &separator);
+
+    // Brightest number of each tube
+    uint8_t numbers[DIGITS_NUM];
+    for (uint8_t tube = 0; tube < DIGITS_NUM; ++tube) {
+        numbers[tube] = 0;
+        for (uint8_t number = 1; number < 10U; ++number)
+            if (brightness[tube][number] > brightness[tube][numbers[tube]])
+                numbers[tube] = number;
+    }
+
+    // Save cursor and draw at the top
+    fprintf(stderr, "\x1b[s\x1b[1;1H");
+
+    // Glyphs and the separator in the middle
+    for (uint8_t row = 0; row < 3U; ++row) {
+        for (uint8_t tube = 0; tube < DIGITS_NUM; ++tube) {
+            if (tube == DIGITS_NUM / 2U) {
+                set_color(separator);
+                fprintf(stderr, " %s ", row == 1U ? "●" : " ");
+            }
+            float glow = brightness[tube][numbers[tube]];
+            set_color(glow);
+            fprintf(stderr, "    %s     ", glow > 0.f ? GLYPHS[numbers[tube]][row] : "   ");
+        }
+        fprintf(stderr, "\x1b[0m\x1b[K\n");
+    }
+
+    // Stack of cathodes to see ghosting
+    for (uint8_t tube = 0; tube < DIGITS_NUM; ++tube) {
+        if (tube == DIGITS_NUM / 2U)
+            fprintf(stderr, "   ");
+        fputc(' ', stderr);
+        for (uint8_t number = 0; number < 10U; ++number) {
+            set_color(brightness[tube][number]);
+            fputc('0' + number, stderr);
+        }
+        fputc(' ', stderr);
+    }
+    fprintf(stderr, "\x1b[0m\x1b[K\n");
+
+    // Virtual time and brightness of the brightest numbers
+    uint64_t ms = native_time() / 1000ULL;
+    fprintf(stderr, "\x1b[2m[%llu %02u:%02u:%02u]", (unsigned long long) (ms / 86400000ULL),
+            (unsigned) (ms / 3600000ULL % 24ULL), (unsigned) (ms / 60000ULL % 60ULL),
+            (unsigned) (ms / 1000ULL % 60ULL));
+    for (uint8_t tube = 0; tube < DIGITS_NUM; ++tube)
+        fprintf(stderr, " %3.0f%%", brightness[tube][numbers[tube]] * 100.f);
+    fprintf(stderr, " sep %3.0f%%\x1b[0m\x1b[K\n", separator * 100.f);
+
+    // Restore cursor
+    fprintf(stderr, "\x1b[u");
+    fflush(stderr);
+}
+
+#endif
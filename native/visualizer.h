@@ -0,0 +1,51 @@
+/**
+ * @file visualizer.h
+ * @author Fern Lane
+ * @brief Draws nixie tubes in the terminal (ANSI escape codes) from the words latched into the shift registers
+ *
+ * Each tube shows the brightest number and the whole stack of cathodes below it. Brightness is time-averaged from
+ * what was actually latched during the last frame (so dimming, blinking, animations and ghosting of the other cathodes
+ * are visible) and corrected for the perceived lightness. Display is drawn at the top of the terminal into stderr,
+ * while serial console keeps scrolling below it
+ *
+ * @copyright Copyright (c) 2024 Fern Lane
+ *
+ * This file is part of the in17clock distribution.
+ * See <https://github.com/F33RNI/in17clock> for more info.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * long with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef VISUALIZER_H__
+#define VISUALIZER_H__
+
+#include "mock.h"
+
+// Host time between frames
+#define VISUALIZER_FRAME_US 40000ULL
+
+// Number of terminal lines taken by the display (including the empty one)
+#define VISUALIZER_LINES 6U
+
+// Perceived lightness = brightness ^ VISUALIZER_GAMMA
+#define VISUALIZER_GAMMA 0.45f
+
+// Color of the fully lit cathode and of the unlit one
+#define VISUALIZER_COLOR_LIT   255, 130, 30
+#define VISUALIZER_COLOR_UNLIT 55, 50, 45
+
+void visualizer_init(void);
+void visualizer_draw(void);
+
+#endif
@@ -0,0 +1,99 @@
+/**
+ * @file night.cpp
+ * @author Fern Lane
+ * @brief Scheduled night mode: dims (or turns off) the tubes and shuts converter down during night hours
+ *
+ * @copyright Copyright (c) 2024 Fern Lane
+ *
+ * This file is part of the in17clock distribution.
+ * See <https://github.com/F33RNI/in17clock> for more info.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * long with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "include/night.h"
+
+#include "include/buttons.h"
+#include "include/digits.h"
+#include "include/power.h"
+#include "include/rtc.h"
+#include "include/self_test.h"
+#include "include/settings.h"
+
+// Preinstantiate
+Night night;
+
+/**
+ * @brief Enters or leaves night mode according to the current time, buttons and alarm. Any button wakes display for
+ * NIGHT_WAKE_TIME (the press that wakes it is suppressed). Display also wakes NIGHT_ALARM_ADVANCE minutes before the
+ * alarm and stays awake while alarm is active
+ * NOTE: Must be called in a main loop after RTC is read and before buttons are handled
+ */
+void Night::update(void) {
+    // Restart wake time on every button press (and don't let the press that wakes display do anything else)
+    if (buttons.get_any()) {
+        if (sleeping)
+            buttons.suppress();
+        wake_timer = hal.millis();
+        awake = true;
+    } else if (awake && hal.millis() - wake_timer >= NIGHT_WAKE_TIME)
+        awake = false;
+
+    boolean sleep = !awake && is_night() && !is_alarm_near();
+#ifdef SELF_TEST
+    // Self-test needs converter
+    if (self_test.is_running())
+        sleep = false;
+#endif
+    if (sleep == sleeping)
+        return;
+    sleeping = sleep;
+
+    digits.set_brightness_limit(sleep ? NIGHT_BRIGHTNESS : 255U);
+    if (NIGHT_BRIGHTNESS == 0U)
+        power.set_sleep(sleep);
+}
+
+/**
+ * @return boolean true if display is dimmed (or turned off) by night mode
+ */
+boolean Night::is_sleeping(void) { return sleeping; }
+
+/**
+ * @return boolean true if current hours are within night_on - night_off (false if they are equal)
+ */
+boolean Night::is_night(void) {
+    uint8_t hours = rtc.get_hours();
+    uint8_t on = settings.data.night_on, off = settings.data.night_off;
+    if (on == off)
+        return false;
+    if (on < off)
+        return hours >= on && hours < off;
+    return hours >= on || hours < off;
+}
+
+/**
+ * @return boolean true if alarm is active or if it will be activated within NIGHT_ALARM_ADVANCE minutes
+ */
+boolean Night::is_alarm_near(void) {
+    if (settings.data.alarm_active)
+        return true;
+    if (!buttons.is_alarm_on())
+        return false;
+    int16_t minutes = (int16_t) (settings.data.alarm_hours * 60U + settings.data.alarm_minutes) -
+                      (int16_t) (rtc.get_hours() * 60U + rtc.get_minutes());
+    if (minutes < 0)
+        minutes += 1440;
+    return minutes <= (int16_t) NIGHT_ALARM_ADVANCE;
+}
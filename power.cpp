@@ -32,17 +32,18 @@
 
 #include "include/config.h"
 #include "include/pins.h"
+#include "include/recorder.h"
+#include "include/watchdog.h"
 
 // Preinstantiate
 Power power;
 
 /**
- * @brief Configures analog reference, Timer 1 and PWM on pin 9
+ * @brief Configures analog reference and converter PWM
  */
 void Power::init(void) {
     // Initialize PID class instance
-    pid = PetalPID(PID_P_GAIN, PID_I_GAIN, PID_D_GAIN, PID_MIN_OUT, PID_MAX_OUT);
-    pid.set_min_max_integral(PID_MIN_INTEGRAL, PID_MAX_INTEGRAL);
+    reset_pid();
 
     // Initialize Serial port for auto-tune output
 #ifdef PID_AUTO_TUNE
@@ -51,33 +52,20 @@ void Power::init(void) {
     PID_AUTO_TUNE_SERIAL.println();
 #endif
 
-    // Phase and frequency correct mode, ICR1 as top counter value
-    // See "Table 15-5. Waveform Generation Mode Bit Description" in Atmega328P datasheet for more info
-    TCCR1B = _BV(WGM13);
-    ICR1 = CONVERTER_PERIOD_CYCLES;
-
-    // No prescaler
-    TCCR1B |= _BV(CS10);
-
-    // Reset control register A
-    TCCR1A = 0;
-
-    // Enable PWM
-    pinMode(_TIMER_1_A_PIN, OUTPUT);
-    TCCR1A |= _BV(COM1A1);
-
-    // Enable inverted mode if needed
+    // Phase and frequency correct PWM on pin 9 without prescaler
 #ifdef CONVERTER_PWM_INVERTED
-    TCCR1A |= _BV(COM1A0);
+    hal.converter_pwm_init(CONVERTER_PERIOD_CYCLES, true);
+#else
+    hal.converter_pwm_init(CONVERTER_PERIOD_CYCLES, false);
 #endif
 
     // Initially set output to the lowest value (disable output)
     set_duty_cycle(0U);
 
-    // Set analog reference to internal and wait for it to settle
-    analogReference(INTERNAL);
-    analogRead(CONVERTER_SENSE_PIN);
-    delay(100UL);
+    // Set analog reference to internal. It will settle while the rest is initializing (see regulate())
+    hal.adc_init();
+    hal.adc_read(CONVERTER_SENSE_PIN);
+    time_started = hal.millis();
 
     // Begin auto-tuning
 #ifdef PID_AUTO_TUNE
@@ -93,36 +81,76 @@ void Power::init(void) {
  */
 void Power::set_voltage(uint8_t voltage) { setpoint = voltage; }
 
+/**
+ * @brief Sets voltage that is added to the setpoint (ex. to compensate aging of the tubes). Sum is limited to
+ * CONVERTER_SETPOINT_MAX
+ *
+ * @param volts 0 to disable compensation
+ */
+void Power::set_compensation(uint8_t volts) { compensation = volts; }
+
 /**
  * @return uint8_t target output voltage in Volts (from set_voltage())
  */
 uint8_t Power::get_voltage(void) { return setpoint; }
 
+/**
+ * @return float last measured output voltage in Volts
+ */
+float Power::get_measured_voltage(void) { return voltage; }
+
+/**
+ * @return uint8_t current target output voltage in Volts (lower than get_voltage() during soft start)
+ */
+uint8_t Power::get_setpoint_current(void) { return setpoint_temp; }
+
+/**
+ * @return uint16_t last written duty cycle (0 to 1023)
+ */
+uint16_t Power::get_duty_cycle(void) { return duty_cycle; }
+
+/**
+ * @return uint16_t time from startup to the moment output voltage reached CONVERTER_SETPOINT_MIN in milliseconds
+ * (0 if not yet)
+ */
+uint16_t Power::get_ready_time(void) { return ready_time; }
+
 /**
  * @brief Measures and calculates output voltage, calculates PID controller and writes PWM
  * NOTE: This must called in a main loop without any delays!
  */
 void Power::regulate(void) {
     measure_voltage();
+    uint32_t millis_current = hal.millis();
+    if (!ready_time && voltage >= CONVERTER_SETPOINT_MIN)
+        ready_time = millis_current > 0xFFFFUL ? 0xFFFFU : (millis_current ? millis_current : 1U);
+
+    // Keep converter OFF while it's shut down and until analog reference settles. Soft start is counted from init()
+    // (or wake up), so it overlaps settling
+    if (sleeping || millis_current - time_started < CONVERTER_ADC_SETTLE_TIME) {
+        set_duty_cycle(0U);
+        watchdog.check_in(WATCHDOG_TASK_POWER);
+        return;
+    }
+
+    // Add compensation
+    uint8_t target = (uint16_t) setpoint + compensation > CONVERTER_SETPOINT_MAX ? CONVERTER_SETPOINT_MAX
+                                                                                   : setpoint + compensation;
 
     // Ignore soft-start in PID auto-tuning mode
 #ifdef PID_AUTO_TUNE
-    setpoint_temp = setpoint;
+    setpoint_temp = target;
 #else
-    uint64_t millis_current = millis();
-    // Record initial time for soft start
-    if (time_started == 0)
-        time_started = millis_current;
-
     // Gradually increase setpoint (soft start)
     if (millis_current - time_started > CONVERTER_SOFT_START_TIME)
-        setpoint_temp = setpoint;
+        setpoint_temp = target;
     else
-        setpoint_temp = (float) (millis_current - time_started) / (float) CONVERTER_SOFT_START_TIME * setpoint;
+        setpoint_temp = (float) (millis_current - time_started) / (float) CONVERTER_SOFT_START_TIME * target;
 #endif
 
     // Calculate and write PID controller
-    set_duty_cycle(pid.calculate(voltage, setpoint_temp, micros()));
+    set_duty_cycle(pid.calculate(voltage, setpoint_temp, hal.micros()));
+    watchdog.check_in(WATCHDOG_TASK_POWER);
 
     // Print auto-tune result
 #ifdef PID_AUTO_TUNE
@@ -141,12 +169,54 @@ void Power::regulate(void) {
 #endif
 }
 
+/**
+ * @brief Shuts converter down (disconnects PWM from the pin 9) or starts it again with soft start
+ *
+ * @param sleep true to shut converter down
+ */
+void Power::set_sleep(boolean sleep) {
+    if (sleep == sleeping)
+        return;
+    sleeping = sleep;
+    if (sleep)
+        hal.converter_pwm_stop();
+    else {
+        // Integral from before the shutdown would skip the soft start
+        reset_pid();
+        time_started = hal.millis();
+        set_duty_cycle(0U);
+        ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+            if (!stopped)
+                hal.converter_pwm_start();
+        }
+    }
+}
+
+/**
+ * @brief Creates PID controller without any accumulated state
+ */
+void Power::reset_pid(void) {
+    pid = PetalPID(PID_P_GAIN, PID_I_GAIN, PID_D_GAIN, PID_MIN_OUT, PID_MAX_OUT);
+    pid.set_min_max_integral(PID_MIN_INTEGRAL, PID_MAX_INTEGRAL);
+}
+
+/**
+ * @brief Disconnects PWM from the pin 9 and turns converter OFF. Safe to call from interrupts
+ * NOTE: Converter can be enabled only by restarting MCU
+ */
+void Power::stop(void) {
+    stopped = true;
+    hal.converter_pwm_stop();
+}
+
 /**
  * @brief Measures and calculates output voltage
  * (Result will be in private voltage variable)
  */
 void Power::measure_voltage(void) {
-    voltage = analogRead(CONVERTER_SENSE_PIN) / 1023.f * VREF_ACTUAL_MV;
+    uint16_t adc_value = hal.adc_read(CONVERTER_SENSE_PIN);
+    RECORD_ADC(adc_value);
+    voltage = adc_value / 1023.f * VREF_ACTUAL_MV;
     voltage /= (CONVERTER_R_LOW / (CONVERTER_R_LOW + CONVERTER_R_HIGH));
 }
 
@@ -155,4 +225,7 @@ void Power::measure_voltage(void) {
  *
  * @param duty_cycle 0 to 1023 (1024 - always HIGH)
  */
-void Power::set_duty_cycle(uint16_t duty_cycle) { OCR1A = (CONVERTER_PERIOD_CYCLES * (uint32_t) duty_cycle) >> 10UL; }
+void Power::set_duty_cycle(uint16_t duty_cycle) {
+    this->duty_cycle = duty_cycle;
+    hal.converter_pwm_write((CONVERTER_PERIOD_CYCLES * (uint32_t) duty_cycle) >> 10UL);
+}
@@ -0,0 +1,138 @@
+/**
+ * @file profiler.cpp
+ * @author Fern Lane
+ * @brief Main loop latency profiler with per-section histograms
+ *
+ * @copyright Copyright (c) 2024 Fern Lane
+ *
+ * This file is part of the in17clock distribution.
+ * See <https://github.com/F33RNI/in17clock> for more info.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * long with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "include/profiler.h"
+
+#ifdef PROFILER
+
+#include "include/config.h"
+
+// Section names for the report
+const char PROFILER_NAME_LOOP[] PROGMEM = "loop";
+const char PROFILER_NAME_POWER[] PROGMEM = "power";
+const char PROFILER_NAME_SENSOR[] PROGMEM = "sensor";
+const char PROFILER_NAME_RTC[] PROGMEM = "rtc";
+const char PROFILER_NAME_UI[] PROGMEM = "ui";
+const char PROFILER_NAME_BUZZER[] PROGMEM = "buzzer";
+const char PROFILER_NAME_SETTINGS[] PROGMEM = "settings";
+const char PROFILER_NAME_CONSOLE[] PROGMEM = "console";
+const char *const PROFILER_NAMES[] PROGMEM = {PROFILER_NAME_LOOP,     PROFILER_NAME_POWER,  PROFILER_NAME_SENSOR,
+                                              PROFILER_NAME_RTC,      PROFILER_NAME_UI,     PROFILER_NAME_BUZZER,
+                                              PROFILER_NAME_SETTINGS, PROFILER_NAME_CONSOLE};
+
+// Preinstantiate
+Profiler profiler;
+
+/**
+ * @brief Opens serial port for reports (if there is no console) and clears all histograms
+ */
+void Profiler::init(void) {
+#ifndef CONSOLE
+    PROFILER_SERIAL.begin(PROFILER_BAUD_RATE);
+#endif
+    reset();
+}
+
+/**
+ * @brief Adds measured duration into the section's histogram
+ *
+ * @param section PROFILER_LOOP, PROFILER_POWER, ...
+ * @param duration in microseconds
+ */
+void Profiler::record(uint8_t section, uint32_t duration) {
+    if (duration > duration_max[section])
+        duration_max[section] = duration > 0xFFFFUL ? 0xFFFFU : duration;
+
+    // Find bucket (log2 of duration)
+    uint8_t bucket = 0;
+    duration >>= PROFILER_BUCKET_0_SHIFT;
+    while (duration && bucket < PROFILER_BUCKETS - 1U) {
+        duration >>= 1U;
+        bucket++;
+    }
+
+    // Saturate instead of overflowing
+    if (histogram[section][bucket] != 0xFFFFU)
+        histogram[section][bucket]++;
+}
+
+/**
+ * @brief Prints one line of the report (header or maximum duration and histogram of one section)
+ * (One line at a time, so it can be printed without filling the serial buffer)
+ *
+ * @param output where to print (ex. Serial)
+ * @param line 0 for header, 1 to PROFILER_SECTIONS for sections
+ * @return boolean true if there are more lines to print
+ */
+boolean Profiler::report(Print &output, uint8_t line) {
+    // Header
+    if (line == 0) {
+        output.print(F("section\tmax_us"));
+        for (uint8_t bucket = 0; bucket < PROFILER_BUCKETS - 1U; ++bucket) {
+            output.print(F("\t<"));
+            output.print(64UL << bucket);
+        }
+        output.println(F("\tmore"));
+        return true;
+    }
+
+    // Section
+    uint8_t section = line - 1U;
+    output.print((const __FlashStringHelper *) pgm_read_ptr(&PROFILER_NAMES[section]));
+    output.print('\t');
+    output.print(duration_max[section]);
+    for (uint8_t bucket = 0; bucket < PROFILER_BUCKETS; ++bucket) {
+        output.print('\t');
+        output.print(histogram[section][bucket]);
+    }
+    output.println();
+    return line < PROFILER_SECTIONS;
+}
+
+/**
+ * @brief Clears all histograms and maximum durations
+ */
+void Profiler::reset(void) {
+    memset(histogram, 0, sizeof(histogram));
+    memset(duration_max, 0, sizeof(duration_max));
+}
+
+/**
+ * @brief Prints and clears report if PROFILER_REPORT_CHAR was received
+ * (If CONSOLE is enabled, use "prof" command instead)
+ * NOTE: Must be called in a main loop
+ */
+void Profiler::update(void) {
+#ifndef CONSOLE
+    if (!PROFILER_SERIAL.available())
+        return;
+    if (PROFILER_SERIAL.read() != PROFILER_REPORT_CHAR)
+        return;
+    for (uint8_t line = 0; report(PROFILER_SERIAL, line); ++line)
+        ;
+    reset();
+#endif
+}
+
+#endif
@@ -0,0 +1,209 @@
+/**
+ * @file recorder.cpp
+ * @author Fern Lane
+ * @brief Records timestamped input events into RAM ring for field bug reproduction
+ *
+ * @copyright Copyright (c) 2024 Fern Lane
+ *
+ * This file is part of the in17clock distribution.
+ * See <https://github.com/F33RNI/in17clock> for more info.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * long with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "include/recorder.h"
+
+#ifdef RECORDER
+
+#include "include/config.h"
+
+// Event names for the dump (index is RECORDER_EVENT_... - 1)
+const char RECORDER_NAME_BUTTON[] PROGMEM = "button";
+const char RECORDER_NAME_SQW[] PROGMEM = "sqw";
+const char RECORDER_NAME_SENSOR[] PROGMEM = "sensor";
+const char RECORDER_NAME_ADC[] PROGMEM = "adc";
+const char *const RECORDER_NAMES[] PROGMEM = {RECORDER_NAME_BUTTON, RECORDER_NAME_SQW, RECORDER_NAME_SENSOR,
+                                              RECORDER_NAME_ADC};
+
+// Preinstantiate
+Recorder recorder;
+
+/**
+ * @brief Records debounced button or alarm switch edge
+ *
+ * @param index BUTTON_UP, BUTTON_DOWN, ...
+ * @param state true if pressed (or alarm switch is ON)
+ */
+void Recorder::button(uint8_t index, boolean state) { record(RECORDER_EVENT_BUTTON, index, state, 0U); }
+
+/**
+ * @brief Records SQW tick with the time read after it. Ticks that follow the previous one by about a second are merged
+ * into it (as repeats), so normal clock operation takes only a few events
+ *
+ * @param hours current hours
+ * @param minutes current minutes
+ * @param seconds current seconds
+ */
+void Recorder::sqw(uint8_t hours, uint8_t minutes, uint8_t seconds) {
+    if (count && !dumping) {
+        RecorderEvent *last = &events[(head + RECORDER_EVENTS - 1U) % RECORDER_EVENTS];
+        uint32_t since_last = hal.millis() - time_last;
+        if (last->type == RECORDER_EVENT_SQW && last->repeat < 0xFFU && since_last > RECORDER_SQW_PERIOD / 2U &&
+            since_last < RECORDER_SQW_PERIOD * 3U / 2U) {
+            last->repeat++;
+            time_last += RECORDER_SQW_PERIOD;
+            return;
+        }
+    }
+    record(RECORDER_EVENT_SQW, hours, minutes, seconds);
+}
+
+/**
+ * @brief Records sensor sample if it changed and at least RECORDER_SENSOR_INTERVAL passed since the previous one
+ *
+ * @param temperature_100 temperature in 0.01 degrees Celsius
+ * @param humidity humidity in %
+ */
+void Recorder::sensor(int16_t temperature_100, uint8_t humidity) {
+    if (hal.millis() - sensor_timer < RECORDER_SENSOR_INTERVAL)
+        return;
+    if (temperature_100 == temperature_last && humidity == humidity_last)
+        return;
+    sensor_timer = hal.millis();
+    temperature_last = temperature_100;
+    humidity_last = humidity;
+    record(RECORDER_EVENT_SENSOR, (uint16_t) temperature_100 & 0xFFU, (uint16_t) temperature_100 >> 8U, humidity);
+}
+
+/**
+ * @brief Records converter sense ADC value every RECORDER_ADC_INTERVAL
+ *
+ * @param value raw ADC value
+ */
+void Recorder::adc(uint16_t value) {
+    if (hal.millis() - adc_timer < RECORDER_ADC_INTERVAL)
+        return;
+    adc_timer = hal.millis();
+    record(RECORDER_EVENT_ADC, value & 0xFFU, value >> 8U, 0U);
+}
+
+/**
+ * @brief Prints one line of the dump (header or one event from the oldest to the newest)
+ * Event line: rec <time ms> <name> <data...> where data is:
+ * button: <index> <state>, sqw: <hours> <minutes> <seconds> <repeat>, sensor: <temperature * 100> <humidity>,
+ * adc: <value>. Recording is paused until the last line is printed
+ *
+ * @param output where to print (ex. Serial)
+ * @param line 0 for header, 1 to number of events for events
+ * @return boolean true if there are more lines to print
+ */
+boolean Recorder::dump(Print &output, uint8_t line) {
+    // Header
+    if (line == 0) {
+        dumping = true;
+        output.print(F("events="));
+        output.print(count);
+        output.print(F(" dropped="));
+        output.println(dropped);
+        return dumping = count != 0;
+    }
+
+    // Find event and its time (there are only a few events, so it's easier to walk from the oldest one every time)
+    uint8_t oldest = (head + RECORDER_EVENTS - count) % RECORDER_EVENTS;
+    uint32_t time = time_base;
+    RecorderEvent *event;
+    for (uint8_t i = 0; i < line; ++i) {
+        event = &events[(oldest + i) % RECORDER_EVENTS];
+        if (i)
+            time += (uint32_t) events[(oldest + i - 1U) % RECORDER_EVENTS].repeat * RECORDER_SQW_PERIOD;
+        time += event->delta;
+    }
+
+    output.print(F("rec\t"));
+    output.print(time);
+    output.print('\t');
+    output.print((const __FlashStringHelper *) pgm_read_ptr(&RECORDER_NAMES[event->type - 1U]));
+    output.print('\t');
+    if (event->type == RECORDER_EVENT_BUTTON) {
+        output.print(event->data[0]);
+        output.print('\t');
+        output.println(event->data[1]);
+    } else if (event->type == RECORDER_EVENT_SQW) {
+        for (uint8_t i = 0; i < 3U; ++i) {
+            output.print(event->data[i]);
+            output.print('\t');
+        }
+        output.println(event->repeat);
+    } else if (event->type == RECORDER_EVENT_SENSOR) {
+        output.print((int16_t) (event->data[0] | (event->data[1] << 8U)));
+        output.print('\t');
+        output.println(event->data[2]);
+    } else
+        output.println(event->data[0] | (event->data[1] << 8U));
+
+    return dumping = line < count;
+}
+
+/**
+ * @brief Removes all recorded events
+ */
+void Recorder::clear(void) {
+    head = 0;
+    count = 0;
+    dropped = 0;
+}
+
+/**
+ * @brief Appends event to the ring (overwrites the oldest one if it's full)
+ */
+void Recorder::record(uint8_t type, uint8_t data_0, uint8_t data_1, uint8_t data_2) {
+    // Don't shift lines in the middle of the dump
+    if (dumping) {
+        if (dropped != 0xFFFFU)
+            dropped++;
+        return;
+    }
+
+    // First event starts the timeline
+    uint32_t time = hal.millis();
+    if (!count) {
+        time_base = time;
+        time_last = time;
+    }
+
+    // Delta is never negative (merged SQW ticks can be a bit ahead of millis()) and saturates on long pauses
+    uint32_t delta = (int32_t) (time - time_last) < 0 ? 0UL : time - time_last;
+    if (delta > 0xFFFFUL)
+        delta = 0xFFFFUL;
+    time_last += delta;
+
+    // Drop the oldest event
+    if (count == RECORDER_EVENTS) {
+        time_base += events[head].delta + (uint32_t) events[head].repeat * RECORDER_SQW_PERIOD;
+        if (dropped != 0xFFFFU)
+            dropped++;
+    } else
+        count++;
+
+    RecorderEvent *event = &events[head];
+    event->delta = delta;
+    event->type = type;
+    event->repeat = 0;
+    event->data[0] = data_0;
+    event->data[1] = data_1;
+    event->data[2] = data_2;
+    head = (head + 1U) % RECORDER_EVENTS;
+}
+
+#endif
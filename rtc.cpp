@@ -24,70 +24,113 @@
 
 #include "include/rtc.h"
 
+#include "include/decimal.h"
 #include "include/pins.h"
+#include "include/settings.h"
+#include "include/watchdog.h"
+
+// DST transition as a comparable number: ((month << 5) | day) * 24 + hours
+#define _INSTANT(month, day, hours) ((((uint16_t) (month) << 5U) | (day)) * 24U + (hours))
 
 // Preinstantiate
 RTC rtc;
 
+/**
+ * @brief Initializes I2C bus (if not yet initialized), attaches SQW interrupt and tries to configure DS3231
+ * (call probe() until it succeeds if it's not ready yet)
+ */
 void RTC::init(void) {
-    // Initialize IC2 and wait a bit
-#ifndef _WIRE_INITIALIZED
-#define _WIRE_INITIALIZED
-    Wire.begin();
-    delay(100UL);
-#endif
+    hal.twi_init();
 
     // Attach interrupt to SQW pin
-    pinMode(PIN_SQW, INPUT_PULLUP);
-    attachInterrupt(digitalPinToInterrupt(PIN_SQW), sqw_callback, FALLING);
-
-    // Enable 1Hz SQW output (See "SQUARE-WAVE OUTPUT FREQUENCY" table in DS3231 datasheet)
-    // <https://www.analog.com/media/en/technical-documentation/data-sheets/ds3231.pdf>
-    Wire.beginTransmission(RTC_ADDRESS);
-    Wire.write(REGISTER_CONTROL);
-    Wire.write(0x00);
-    Wire.endTransmission();
+    hal.pin_input_pullup(PIN_SQW);
+    hal.external_interrupt_attach(PIN_SQW, sqw_callback);
+
+    probe();
+}
+
+/**
+ * @brief Enables 1Hz SQW output (See "SQUARE-WAVE OUTPUT FREQUENCY" table in DS3231 datasheet)
+ * <https://www.analog.com/media/en/technical-documentation/data-sheets/ds3231.pdf>
+ *
+ * @return boolean true if DS3231 responded
+ */
+boolean RTC::probe(void) {
+    uint8_t buffer[2] = {REGISTER_CONTROL, 0x00};
+    return hal.twi_write(RTC_ADDRESS, buffer, 2U) == 0;
 }
 
 /**
- * @brief Sets new time (24-hours format) and resets date
+ * @brief Sets new local time (24-hours format). Date stays the same (it's rewritten if DST rule is selected or has
+ * just been changed, because standard time can be on the previous day)
  *
  * @param hours 0-23
  * @param minutes 0-59
  * @param seconds 0-59
  */
 void RTC::set(uint8_t hours, uint8_t minutes, uint8_t seconds) {
-    Wire.beginTransmission(RTC_ADDRESS);
-    Wire.write(REGISTER_TIME);
+    uint8_t day = get_day(), month = get_month(), year = get_year();
+    if (settings.data.dst || dst_rule) {
+        local_to_standard(&hours, &day, &month, &year);
+        uint8_t buffer[4] = {REGISTER_DATE, dec_to_bcd(day), dec_to_bcd(month), dec_to_bcd(year)};
+        if (hal.twi_write(RTC_ADDRESS, buffer, 4U) && bus_errors != 0xFFFFU)
+            bus_errors++;
+    }
 
     // Seconds, minutes, hours
-    Wire.write(dec_to_bcd(seconds));
-    Wire.write(dec_to_bcd(minutes));
-    Wire.write(dec_to_bcd(hours));
-
-    // DOW, DOM, moth, year
-    Wire.write(0x00);
-    Wire.write(0x00);
-    Wire.write(0x00);
-    Wire.write(0x00);
-    Wire.endTransmission();
+    uint8_t buffer[4] = {REGISTER_TIME, dec_to_bcd(seconds), dec_to_bcd(minutes), dec_to_bcd(hours)};
+    if (hal.twi_write(RTC_ADDRESS, buffer, 4U) && bus_errors != 0xFFFFU)
+        bus_errors++;
+    dst_hours_raw = 0xFFU;
 }
 
 /**
- * @brief Retrieves data from DS3231. Call get_hours(), get_minutes(), get_seconds() to get parsed data
+ * @brief Sets new local date
+ *
+ * @param day 1-31
+ * @param month 1-12
+ * @param year 0-99 (2000-2099)
+ */
+void RTC::set_date(uint8_t day, uint8_t month, uint8_t year) {
+    uint8_t hours = get_hours();
+    local_to_standard(&hours, &day, &month, &year);
+
+    // DOM, month, year
+    uint8_t buffer[4] = {REGISTER_DATE, dec_to_bcd(day), dec_to_bcd(month), dec_to_bcd(year)};
+    if (hal.twi_write(RTC_ADDRESS, buffer, 4U) && bus_errors != 0xFFFFU)
+        bus_errors++;
+    dst_hours_raw = 0xFFU;
+}
+
+/**
+ * @brief Retrieves data from DS3231. Call get_hours(), get_minutes(), get_seconds(), get_day(), ... to get parsed data
  */
 void RTC::read(void) {
+    // I2C bus is not stuck
+    watchdog.check_in(WATCHDOG_TASK_RTC);
+
     // Request from time register and check for transmission error
-    Wire.beginTransmission(RTC_ADDRESS);
-    Wire.write(REGISTER_TIME);
-    if (Wire.endTransmission())
+    uint8_t buffer[7] = {REGISTER_TIME};
+    if (hal.twi_write(RTC_ADDRESS, buffer, 1U)) {
+        if (bus_errors != 0xFFFFU)
+            bus_errors++;
+        return;
+    }
+
+    // Request and read 7 bytes (seconds, minutes, hours, DOW, DOM, month, year)
+    if (hal.twi_read(RTC_ADDRESS, buffer, 7U) != 7U) {
+        if (bus_errors != 0xFFFFU)
+            bus_errors++;
         return;
+    }
+    seconds_raw = buffer[0];
+    minutes_raw = buffer[1];
+    hours_raw = buffer[2];
+    day_raw = buffer[4];
+    month_raw = buffer[5];
+    year_raw = buffer[6];
 
-    // Request and read 3 bytes (hours, minutes and seconds)
-    Wire.requestFrom(RTC_ADDRESS, 3);
-    seconds_raw = Wire.read();
-    minutes_raw = Wire.read();
-    hours_raw = Wire.read();
+    apply_dst();
 }
 
 /**
@@ -105,6 +148,41 @@ uint8_t RTC::get_minutes(void) { return rtc.bcd_to_dec(minutes_raw & 0x7F); }
  */
 uint8_t RTC::get_seconds(void) { return rtc.bcd_to_dec(seconds_raw & 0x7F); }
 
+/**
+ * @return uint8_t current day of month (1-31). Call read() before to retrieve new data
+ */
+uint8_t RTC::get_day(void) { return rtc.bcd_to_dec(day_raw & 0x3F); }
+
+/**
+ * @return uint8_t current month (1-12). Call read() before to retrieve new data
+ */
+uint8_t RTC::get_month(void) { return rtc.bcd_to_dec(month_raw & 0x1F); }
+
+/**
+ * @return uint8_t current year (0-99 means 2000-2099). Call read() before to retrieve new data
+ */
+uint8_t RTC::get_year(void) { return rtc.bcd_to_dec(year_raw); }
+
+/**
+ * @return boolean true if DST is in effect (local time is an hour ahead of DS3231)
+ */
+boolean RTC::is_dst(void) { return dst; }
+
+/**
+ * @return boolean true during the hour that is repeated after the end of DST (it was already shown with DST)
+ */
+boolean RTC::is_repeated_hour(void) { return repeated_hour; }
+
+/**
+ * @return uint8_t hour that was skipped by the start of DST (during the next hour only) or 255
+ */
+uint8_t RTC::get_skipped_hour(void) { return skipped_hour; }
+
+/**
+ * @return uint16_t number of failed I2C transactions since startup
+ */
+uint16_t RTC::get_bus_errors(void) { return bus_errors; }
+
 /**
  * @brief Checks if SQW interrupt has been arrived atomically
  * Call clear_interrupt() to reset this flag after handling it
@@ -141,7 +219,142 @@ uint8_t RTC::bcd_to_dec(uint8_t bcd) { return (bcd & 0x0F) + 10 * ((bcd & 0xF0)
  * @param dec decimal number
  * @return uint8_t bcd data
  */
-uint8_t RTC::dec_to_bcd(uint8_t dec) { return ((dec % 10) & 0x0F) | (((dec / 10) << 4) & 0xF0); };
+uint8_t RTC::dec_to_bcd(uint8_t dec) {
+    uint8_t tens = decimal_div10(dec);
+    return ((dec - tens * 10U) & 0x0F) | ((tens << 4) & 0xF0);
+};
+
+/**
+ * @param month 1-12
+ * @param year 0-99 (2000-2099)
+ * @return uint8_t number of days in the month
+ */
+uint8_t RTC::days_in_month(uint8_t month, uint8_t year) {
+    if (month == 2U)
+        return (year & 3U) ? 28U : 29U;
+    return (month == 4U || month == 6U || month == 9U || month == 11U) ? 30U : 31U;
+}
+
+/**
+ * @param day 1-31
+ * @param month 1-12
+ * @param year 0-99 (2000-2099)
+ * @return uint8_t 0 - Sunday, 1 - Monday, ...
+ */
+uint8_t RTC::day_of_week(uint8_t day, uint8_t month, uint8_t year) {
+    // Days since Saturday, 1 January 2000 (every 4th year is leap in 2000-2099)
+    uint16_t days = year * 365U + (year + 3U) / 4U + day - 1U;
+    for (uint8_t i = 1; i < month; ++i)
+        days += days_in_month(i, year);
+    return (days + 6U) % 7U;
+}
+
+/**
+ * @brief Converts standard time from DS3231 into local time. DST rule is evaluated only when standard hour (or the
+ * rule) changes, because all transitions happen at the beginning of an hour
+ */
+void RTC::apply_dst(void) {
+    if (hours_raw != dst_hours_raw || settings.data.dst != dst_rule) {
+        dst_hours_raw = hours_raw;
+        dst_rule = settings.data.dst;
+        dst = false;
+        repeated_hour = false;
+        skipped_hour = 255U;
+        if (dst_rule) {
+            uint8_t hours = get_hours(), year = get_year();
+            uint16_t now = _INSTANT(get_month(), get_day(), hours);
+            dst = is_dst_at(dst_rule - 1U, hours, get_day(), get_month(), year);
+            if (now == rule_instant(dst_rule - 1U, 0, year))
+                skipped_hour = hours;
+            repeated_hour = now == rule_instant(dst_rule - 1U, 1U, year);
+        }
+    }
+    if (!dst)
+        return;
+
+    // Add an hour
+    uint8_t hours = get_hours() + 1U;
+    if (hours == 24U) {
+        hours = 0;
+        uint8_t day = get_day() + 1U, month = get_month(), year = get_year();
+        if (day > days_in_month(month, year)) {
+            day = 1U;
+            if (++month > 12U) {
+                month = 1U;
+                year = year == 99U ? 0 : year + 1U;
+            }
+        }
+        day_raw = dec_to_bcd(day);
+        month_raw = dec_to_bcd(month);
+        year_raw = dec_to_bcd(year);
+    }
+    hours_raw = dec_to_bcd(hours);
+}
+
+/**
+ * @brief Converts local time into standard time for DS3231 (subtracts an hour if DST is in effect). Time in the hour
+ * repeated after the end of DST is taken as DST, time in the hour skipped by the start of DST is taken as standard
+ *
+ * @return boolean true if DST is in effect at this time
+ */
+boolean RTC::local_to_standard(uint8_t *hours, uint8_t *day, uint8_t *month, uint8_t *year) {
+    if (!settings.data.dst)
+        return false;
+
+    // An hour before (previous day at 00:xx)
+    uint8_t hours_std = *hours, day_std = *day, month_std = *month, year_std = *year;
+    if (hours_std)
+        hours_std--;
+    else {
+        hours_std = 23U;
+        if (!--day_std) {
+            if (!--month_std) {
+                month_std = 12U;
+                year_std = year_std ? year_std - 1U : 99U;
+            }
+            day_std = days_in_month(month_std, year_std);
+        }
+    }
+    if (!is_dst_at(settings.data.dst - 1U, hours_std, day_std, month_std, year_std))
+        return false;
+    *hours = hours_std;
+    *day = day_std;
+    *month = month_std;
+    *year = year_std;
+    return true;
+}
+
+/**
+ * @param rule index of DST_RULES
+ * @param hours standard time
+ * @return boolean true if DST is in effect at this standard time
+ */
+boolean RTC::is_dst_at(uint8_t rule, uint8_t hours, uint8_t day, uint8_t month, uint8_t year) {
+    uint16_t now = _INSTANT(month, day, hours);
+    uint16_t start = rule_instant(rule, 0, year), end = rule_instant(rule, 1U, year);
+
+    // Southern hemisphere rules start DST at the end of the year
+    if (start < end)
+        return now >= start && now < end;
+    return now >= start || now < end;
+}
+
+/**
+ * @param rule index of DST_RULES
+ * @param edge 0 - start of DST, 1 - end of DST
+ * @param year 0-99 (2000-2099)
+ * @return uint16_t transition instant of this year (see _INSTANT) in standard time
+ */
+uint16_t RTC::rule_instant(uint8_t rule, uint8_t edge, uint8_t year) {
+    const uint8_t *edge_rule = DST_RULES[rule][edge];
+    uint8_t month = pgm_read_byte(&edge_rule[0]), week = pgm_read_byte(&edge_rule[1]);
+
+    // First such day of week in the month, then the week (the last one if there is no 5th)
+    uint8_t day = 1U + (pgm_read_byte(&edge_rule[2]) + 7U - day_of_week(1U, month, year)) % 7U + (week - 1U) * 7U;
+    if (day > days_in_month(month, year))
+        day -= 7U;
+    return _INSTANT(month, day, pgm_read_byte(&edge_rule[3]));
+}
 
 /**
  * @brief Sets internal non-static variable. Call get_interrupt() to read it atomically
@@ -0,0 +1,238 @@
+"""
+Flash and SRAM footprint report with budget enforcement (PlatformIO extra script for AVR environments)
+
+Links firmware with a map file, sums sizes of all input sections per module and compares them with budgets from the
+[footprint] section of platformio.ini. Fails the build if any module (or the whole firmware) exceeds its budget, unless
+custom_footprint_enforce = no is set in the env (only prints the report, ex. for build profiles comparison)
+
+Run the build with FOOTPRINT_UPDATE=1 environment variable to set budgets of modules from the current report (each
+size plus BUDGET_HEADROOM_PERCENT, rounded up). Modules that are empty or not linked in this env (disabled features,
+ex. profiler in uno) keep their budgets, so update them from the env that enables them. Budget of the whole firmware
+is not changed, because it comes from the chip (flash without bootloader and SRAM without stack)
+
+Module is a source file of the project (each of them contains one class with its global instance, ex. digits.cpp ->
+Digits and digits) or a library archive (FrameworkArduino -> core, PetalPID -> petalpid, gcc and libc -> libc)
+
+Copyright (c) 2024 Fern Lane
+
+This file is part of the in17clock distribution.
+See <https://github.com/F33RNI/in17clock> for more info.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU Affero General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Affero General Public License for more details.
+
+You should have received a copy of the GNU Affero General Public License
+long with this program.  If not, see <http://www.gnu.org/licenses/>.
+"""
+
+import os
+import re
+
+Import("env")  # noqa: F821 (provided by PlatformIO)
+
+# Name of the platformio.ini section with budgets
+BUDGETS_SECTION = "footprint"
+
+# Env option that disables failing the build
+ENFORCE_OPTION = "custom_footprint_enforce"
+
+# Name of the budget for the whole firmware
+TOTAL = "total"
+
+# Environment variable that rewrites budgets from the current report, their headroom and rounding (in bytes)
+UPDATE_VARIABLE = "FOOTPRINT_UPDATE"
+BUDGET_HEADROOM_PERCENT = 10
+BUDGET_ROUND_FLASH = 64
+BUDGET_ROUND_SRAM = 8
+
+# Input sections (by prefix) and where they are placed
+SECTIONS_CODE = (".text", ".init", ".fini", ".vectors", ".trampolines", ".ctors", ".dtors", ".jumptables")
+SECTIONS_PROGMEM = (".progmem",)
+SECTIONS_DATA = (".data", ".rodata")
+SECTIONS_BSS = (".bss", ".noinit", "COMMON")
+
+# Library archives that are reported under a shorter name
+ARCHIVES = {"FrameworkArduino": "core", "gcc": "libc", "c": "libc", "m": "libc", "atmega328p": "libc"}
+
+# " .text.name  0x0000  0x1c  path" or " .text.name" followed by "  0x0000  0x1c  path" on the next line
+_SECTION_FULL = re.compile(r"^ (\S+)\s+0x([0-9a-fA-F]+)\s+0x([0-9a-fA-F]+)\s+(.+)$")
+_SECTION_NAME = re.compile(r"^ (\S+)\s*$")
+_SECTION_REST = re.compile(r"^\s+0x([0-9a-fA-F]+)\s+0x([0-9a-fA-F]+)\s+(.+)$")
+_ARCHIVE = re.compile(r"lib([^/\\]+)\.a\(")
+
+
+def module_name(path):
+    """
+    :param path: object file path from the map file (ex. .pio/build/uno/src/digits.cpp.o or libc.a(strcmp.o))
+    :return: module name in lower case (ex. digits, core, petalpid)
+    """
+    archive = _ARCHIVE.search(path)
+    if archive:
+        return ARCHIVES.get(archive.group(1), archive.group(1)).lower()
+    name = os.path.basename(path.strip())
+    while os.path.splitext(name)[1]:
+        name = os.path.splitext(name)[0]
+    return "libc" if name.startswith("crt") else name.lower()
+
+
+def section_kind(section):
+    """
+    :param section: input section name (ex. .text._ZN6Digits4initEv)
+    :return: code, progmem, data, bss or None if section is not loaded into flash or SRAM
+    """
+    for kind, prefixes in (("progmem", SECTIONS_PROGMEM), ("code", SECTIONS_CODE), ("data", SECTIONS_DATA),
+                           ("bss", SECTIONS_BSS)):
+        if section.startswith(prefixes):
+            return kind
+    return None
+
+
+def parse_map(path):
+    """
+    :param path: path to the map file generated by ld
+    :return: {module: {"code": bytes, "progmem": bytes, "data": bytes, "bss": bytes}}
+    """
+    modules = {}
+    in_memory_map = False
+    pending = None
+    with open(path, "r", encoding="utf-8", errors="replace") as file:
+        for line in file:
+            line = line.rstrip("\n")
+
+            # Skip discarded sections
+            if line.startswith("Linker script and memory map"):
+                in_memory_map = True
+                continue
+            if not in_memory_map:
+                continue
+
+            match = _SECTION_FULL.match(line)
+            if match:
+                section, size, obj = match.group(1), int(match.group(3), 16), match.group(4)
+            elif pending and _SECTION_REST.match(line):
+                match = _SECTION_REST.match(line)
+                section, size, obj = pending, int(match.group(2), 16), match.group(3)
+            else:
+                match = _SECTION_NAME.match(line)
+                pending = match.group(1) if match else None
+                continue
+            pending = None
+
+            kind = section_kind(section)
+            if not kind or not size or obj.startswith("0x"):
+                continue
+            sizes = modules.setdefault(module_name(obj), {"code": 0, "progmem": 0, "data": 0, "bss": 0})
+            sizes[kind] += size
+    return modules
+
+
+def read_budgets(config):
+    """
+    :param config: PlatformIO project config
+    :return: {module: (flash budget, sram budget)}
+    """
+    budgets = {}
+    if not config.has_section(BUDGETS_SECTION):
+        return budgets
+    for module in config.options(BUDGETS_SECTION):
+        flash, sram = config.get(BUDGETS_SECTION, module).split()
+        budgets[module] = (int(flash), int(sram))
+    return budgets
+
+
+def round_budget(size, step):
+    """
+    :param size: measured size in bytes
+    :param step: rounding step in bytes
+    :return: size plus BUDGET_HEADROOM_PERCENT rounded up to the step
+    """
+    size += (size * BUDGET_HEADROOM_PERCENT + 99) // 100
+    return (size + step - 1) // step * step
+
+
+def update_budgets(path, modules, budgets):
+    """
+    Rewrites module budgets in the [footprint] section of platformio.ini (comments, total budget and budgets of
+    modules that are empty in this env are kept)
+
+    :param path: path to platformio.ini
+    :param modules: {module: (flash, sram)} measured sizes
+    :param budgets: {module: (flash budget, sram budget)} current budgets
+    """
+    with open(path, "r", encoding="utf-8") as file:
+        lines = file.read().split("\n")
+    start = lines.index("[{}]".format(BUDGETS_SECTION)) + 1
+    end = start
+    while end < len(lines) and lines[end].strip() and not lines[end].startswith("["):
+        end += 1
+
+    updated = dict(budgets)
+    for module, (flash, sram) in modules.items():
+        if flash or sram:
+            updated[module] = (round_budget(flash, BUDGET_ROUND_FLASH), round_budget(sram, BUDGET_ROUND_SRAM))
+    total = updated.pop(TOTAL, None)
+    section = ["{} = {} {}".format(module, flash, sram)
+               for module, (flash, sram) in sorted(updated.items(), key=lambda item: -item[1][0])]
+    if total:
+        section.append("{} = {} {}".format(TOTAL, *total))
+    lines[start:end] = section
+    with open(path, "w", encoding="utf-8") as file:
+        file.write("\n".join(lines))
+    print("Footprint budgets are saved into [{}] section of {}".format(BUDGETS_SECTION, path))
+
+
+def report(source, target, env):
+    """
+    Prints footprint table and checks budgets (SCons post action)
+
+    :return: 1 if any budget is exceeded and budgets are enforced (fails the build), 0 otherwise
+    """
+    modules = parse_map(env.subst(os.path.join("$BUILD_DIR", "${PROGNAME}.map")))
+    budgets = read_budgets(env.GetProjectConfig())
+
+    total = {"code": 0, "progmem": 0, "data": 0, "bss": 0}
+    for sizes in modules.values():
+        for kind in total:
+            total[kind] += sizes[kind]
+
+    print("Footprint (bytes). Flash = code + progmem + data, SRAM = data + bss")
+    print("{:<14}{:>7}{:>9}{:>6}{:>6}{:>15}{:>13}".format("module", "code", "progmem", "data", "bss", "flash/budget",
+                                                      "sram/budget"))
+    exceeded = []
+    measured = {}
+    rows = sorted(modules.items(), key=lambda item: -sum(item[1].values())) + [(TOTAL, total)]
+    for module, sizes in rows:
+        flash = sizes["code"] + sizes["progmem"] + sizes["data"]
+        sram = sizes["data"] + sizes["bss"]
+        if module != TOTAL:
+            measured[module] = (flash, sram)
+        flash_budget, sram_budget = budgets.get(module, (None, None))
+        over = (flash_budget is not None and flash > flash_budget) or (sram_budget is not None and sram > sram_budget)
+        if over:
+            exceeded.append(module)
+        print("{:<14}{:>7}{:>9}{:>6}{:>6}{:>15}{:>13}{}".format(
+            module, sizes["code"], sizes["progmem"], sizes["data"], sizes["bss"],
+            "{}/{}".format(flash, flash_budget if flash_budget is not None else "-"),
+            "{}/{}".format(sram, sram_budget if sram_budget is not None else "-"), "  OVER BUDGET" if over else ""))
+
+    if os.environ.get(UPDATE_VARIABLE, "") not in ("", "0"):
+        update_budgets(env.subst(os.path.join("$PROJECT_DIR", "platformio.ini")), measured, budgets)
+        return 0
+    if exceeded and str(env.GetProjectOption(ENFORCE_OPTION, "yes")).lower() in ("no", "false", "0"):
+        print("Footprint budget exceeded by: {} (not enforced in this env)".format(", ".join(exceeded)))
+    elif exceeded:
+        print("Footprint budget exceeded by: {}. Optimize it or raise the budget in [{}] section of platformio.ini"
+              .format(", ".join(exceeded), BUDGETS_SECTION))
+        return 1
+    return 0
+
+
+env.Append(LINKFLAGS=["-Wl,-Map,${BUILD_DIR}/${PROGNAME}.map"])  # noqa: F821
+env.AddPostAction("$BUILD_DIR/${PROGNAME}.elf", report)  # noqa: F821
@@ -0,0 +1,243 @@
+/**
+ * @file self_test.cpp
+ * @author Fern Lane
+ * @brief Tube and shift registers self-test: lights every element alone and detects open ones from converter duty cycle
+ *
+ * @copyright Copyright (c) 2024 Fern Lane
+ *
+ * This file is part of the in17clock distribution.
+ * See <https://github.com/F33RNI/in17clock> for more info.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * long with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "include/self_test.h"
+
+#ifdef SELF_TEST
+
+#include "include/decimal.h"
+#include "include/digits.h"
+#include "include/power.h"
+
+// Step 0 measures baseline (nothing is lit), then the separator (right after the baseline, because its current is
+// lower than the one of the tube) and every number of every tube
+#define _STEP_SEPARATOR 1U
+#define _STEP_NUMBERS   2U
+#define _STEPS_NUM      (_STEP_NUMBERS + DIGITS_NUM * 10U)
+
+// Preinstantiate
+SelfTest self_test;
+
+/**
+ * @brief Starts stepping through all elements (restarts if already running)
+ */
+void SelfTest::start(void) {
+    step = 0;
+    running = true;
+    done = false;
+    start_step();
+}
+
+/**
+ * @brief Measures converter duty cycle in the current step and moves to the next one every SELF_TEST_STEP_TIME
+ * NOTE: Must be called in a main loop without any delays (has internal timer)
+ */
+void SelfTest::update(void) {
+    if (!running)
+        return;
+    uint32_t time = hal.millis() - step_timer;
+
+    // Wait for converter soft start (ex. after night mode) before measuring baseline
+    if (step == 0 && power.get_setpoint_current() < power.get_voltage()) {
+        step_timer = hal.millis();
+        return;
+    }
+
+    // Average duty cycle after PID settles
+    if (time >= SELF_TEST_SETTLE_TIME && duty_samples < 0xFFFFU) {
+        duty_sum += power.get_duty_cycle();
+        duty_samples++;
+    }
+    if (time < SELF_TEST_STEP_TIME)
+        return;
+
+    uint16_t duty = duty_samples ? duty_sum / duty_samples : 0U;
+    uint16_t increase = duty > duty_baseline ? duty - duty_baseline : 0U;
+    uint8_t delta = increase > 255U ? 255U : increase;
+    if (step == 0) {
+        duty_baseline = duty;
+        delta_max = 0;
+    } else if (step == _STEP_SEPARATOR)
+        delta_separator = delta;
+    else {
+        uint8_t tube = decimal_div10(step - _STEP_NUMBERS);
+        deltas[tube][step - _STEP_NUMBERS - tube * 10U] = delta;
+        if (delta > delta_max)
+            delta_max = delta;
+    }
+
+    // Next element or show numbers again
+    if (++step < _STEPS_NUM)
+        start_step();
+    else {
+        running = false;
+        done = true;
+        digits.stop_test();
+    }
+}
+
+/**
+ * @return boolean true if elements are being tested (display is used by the self-test)
+ */
+boolean SelfTest::is_running(void) { return running; }
+
+/**
+ * @brief Prints one line of the report: progress or baseline duty, duty increase of each number of each tube and the
+ * separator (with open ones, see is_open()) and fault map. Anode (or its bit) is reported if none of its numbers light,
+ * cathode (or its bit) if the number doesn't light in any tube
+ *
+ * @param output where to print (ex. Serial)
+ * @param line 0 for header, 1 to DIGITS_NUM for tubes, DIGITS_NUM + 1 for separator, DIGITS_NUM + 2 for faults
+ * @return boolean true if there are more lines to print
+ */
+boolean SelfTest::report(Print &output, uint8_t line) {
+    // Header
+    if (line == 0) {
+        if (running) {
+            output.print(F("running "));
+            output.print(step);
+            output.print('/');
+            output.println(_STEPS_NUM);
+        } else if (!done)
+            output.println(F("not started"));
+        else {
+            output.print(F("baseline duty="));
+            output.println(duty_baseline);
+        }
+        return done;
+    }
+
+    // Duty increase of each number and open ones
+    if (line <= DIGITS_NUM) {
+        uint8_t anode = line - 1U;
+        output.print(F("tube"));
+        output.print(line);
+        for (uint8_t number = 0; number < 10U; ++number) {
+            output.print(F(" +"));
+            output.print(deltas[anode][number]);
+        }
+        output.print(F(" open="));
+        boolean any = false;
+        for (uint8_t number = 0; number < 10U; ++number) {
+            if (!is_open(anode, number))
+                continue;
+            output.print(number);
+            any = true;
+        }
+        output.println(any ? F("") : F("none"));
+        return true;
+    }
+
+    if (line == DIGITS_NUM + 1U) {
+        output.print(F("separator +"));
+        output.print(delta_separator);
+        output.println(delta_separator < SELF_TEST_DUTY_THRESHOLD ? F(" open") : F(""));
+        return true;
+    }
+
+    // Fault map: whole anodes, whole cathodes, then single elements that are not explained by them
+    uint16_t anodes_open = 0, cathodes_open = 0;
+    for (uint8_t anode = 0; anode < DIGITS_NUM; ++anode) {
+        uint8_t open = 0;
+        for (uint8_t number = 0; number < 10U; ++number)
+            open += is_open(anode, number);
+        if (open == 10U)
+            anodes_open |= _BV(anode);
+    }
+    for (uint8_t number = 0; number < 10U; ++number) {
+        uint8_t open = 0;
+        for (uint8_t anode = 0; anode < DIGITS_NUM; ++anode)
+            open += is_open(anode, number);
+        if (open == DIGITS_NUM)
+            cathodes_open |= _BV(number);
+    }
+
+    output.print(F("faults:"));
+    boolean any = false;
+    for (uint8_t anode = 0; anode < DIGITS_NUM; ++anode) {
+        if (!(anodes_open & _BV(anode)))
+            continue;
+        output.print(F(" anode"));
+        output.print(anode + 1U);
+        any = true;
+    }
+    for (uint8_t number = 0; number < 10U; ++number) {
+        if (!(cathodes_open & _BV(number)))
+            continue;
+        output.print(F(" cathode"));
+        output.print(number);
+        any = true;
+    }
+    for (uint8_t anode = 0; anode < DIGITS_NUM; ++anode) {
+        for (uint8_t number = 0; number < 10U; ++number) {
+            if (!is_open(anode, number) || (anodes_open & _BV(anode)) ||
+                (cathodes_open & _BV(number)))
+                continue;
+            output.print(F(" tube"));
+            output.print(anode + 1U);
+            output.print('.');
+            output.print(number);
+            any = true;
+        }
+    }
+    if (delta_separator < SELF_TEST_DUTY_THRESHOLD) {
+        output.print(F(" separator"));
+        any = true;
+    }
+    output.println(any ? F("") : F(" none"));
+    return false;
+}
+
+/**
+ * @brief Number is open if it increased duty cycle by less than SELF_TEST_DUTY_THRESHOLD or by less than a half of the
+ * maximum increase among all numbers (PID integral keeps drifting for seconds after each step, so the absolute
+ * increase is not reliable)
+ *
+ * @param anode 0 to DIGITS_NUM - 1
+ * @param number 0-9
+ * @return boolean true if the number of the tube didn't light
+ */
+boolean SelfTest::is_open(uint8_t anode, uint8_t number) {
+    return SELF_TEST_DUTY_THRESHOLD &&
+           (deltas[anode][number] < SELF_TEST_DUTY_THRESHOLD || deltas[anode][number] < delta_max / 2U);
+}
+
+/**
+ * @brief Lights element of the current step and restarts measuring
+ */
+void SelfTest::start_step(void) {
+    if (step == 0)
+        digits.set_test(DIGITS_NUM, 255U, false);
+    else if (step == _STEP_SEPARATOR)
+        digits.set_test(DIGITS_NUM, 255U, true);
+    else {
+        uint8_t tube = decimal_div10(step - _STEP_NUMBERS);
+        digits.set_test(tube, step - _STEP_NUMBERS - tube * 10U, false);
+    }
+    step_timer = hal.millis();
+    duty_sum = 0;
+    duty_samples = 0;
+}
+
+#endif
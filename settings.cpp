@@ -0,0 +1,279 @@
+/**
+ * @file settings.cpp
+ * @author Fern Lane
+ * @brief Wear-levelled, CRC-protected EEPROM settings storage
+ *
+ * @copyright Copyright (c) 2024 Fern Lane
+ *
+ * This file is part of the in17clock distribution.
+ * See <https://github.com/F33RNI/in17clock> for more info.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * long with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "include/settings.h"
+
+#include <stddef.h>
+
+#include "include/config.h"
+
+static_assert(sizeof(SettingsRecord) <= SETTINGS_SLOT_SIZE, "SETTINGS_SLOT_SIZE is too small");
+static_assert(SETTINGS_SLOTS >= 2U && SETTINGS_SLOTS <= 255U, "SETTINGS_EEPROM_SIZE must fit 2 to 255 records");
+
+// Preinstantiate
+Settings settings;
+
+#ifdef CONFIG_OVERLAY
+#define _CONFIG_OVERLAY(constant, name, min, max) {name, constant, min, max},
+const ConfigOverlay Settings::overlay_list[CONFIG_OVERLAY_NUM] PROGMEM = {CONFIG_OVERLAY_LIST(_CONFIG_OVERLAY)};
+#undef _CONFIG_OVERLAY
+#endif
+
+/**
+ * @brief Finds the newest valid record in EEPROM and loads it
+ * (or falls back to the pre-settings EEPROM layout / defaults)
+ */
+void Settings::init(void) {
+    // Nothing is being written
+    write_index = sizeof(SettingsRecord);
+    dirty = false;
+    stored = false;
+
+    // Scan all slots and pick the record with the largest sequence number (with wrap-around)
+    SettingsHeader header;
+    uint8_t size = 0, version = 0;
+    for (uint8_t i = 0; i < SETTINGS_SLOTS; ++i) {
+        if (!read_record(i, &header))
+            continue;
+        if (!stored || (int16_t) (header.sequence - sequence) > 0) {
+            stored = true;
+            sequence = header.sequence;
+            size = header.size;
+            version = header.version;
+            slot = i;
+        }
+    }
+
+    // Load found record. Fields that are missing in older versions will have default values
+    if (stored) {
+        load_defaults();
+        if (size > sizeof(SettingsData))
+            size = sizeof(SettingsData);
+
+        // Overlay was right after the last field of the older version (it's reset)
+        uint8_t size_common = sizeof(SettingsData);
+        if (version < 4U)
+            size_common = offsetof(SettingsData, night_on);
+        else if (version < 5U)
+            size_common = offsetof(SettingsData, tube_lit);
+        else if (version < 6U)
+            size_common = offsetof(SettingsData, tube_trim);
+        else if (version < 7U)
+            size_common = offsetof(SettingsData, heat_base);
+        else if (version < 8U)
+            size_common = offsetof(SettingsData, dst);
+        if (size > size_common)
+            size = size_common;
+        for (uint8_t i = 0; i < size; ++i)
+            ((uint8_t *) &data)[i] = hal.eeprom_read(slot_address(slot) + sizeof(SettingsHeader) + i);
+    }
+
+    // No valid records -> try to restore settings stored by older firmware
+    else {
+        sequence = 0;
+        slot = SETTINGS_SLOTS - 1U;
+        load_legacy();
+    }
+    data_crc = crc_16((const uint8_t *) &data, sizeof(SettingsData));
+
+    // Rewrite older record in the current format on the next commit
+    if (size != sizeof(SettingsData))
+        stored = false;
+
+    // Store fixed values and older records in the current format (nothing is written at a normal boot)
+    sanitize();
+    if (!stored || crc_16((const uint8_t *) &data, sizeof(SettingsData)) != data_crc)
+        mark_dirty();
+}
+
+/**
+ * @brief Schedules commit. Call this after each change of data
+ * Actual writing will start after SETTINGS_COMMIT_DELAY without any new changes
+ */
+void Settings::mark_dirty(void) {
+    dirty = true;
+    dirty_timer = hal.millis();
+}
+
+/**
+ * @brief Handles deferred commit and writes pending record byte by byte without waiting for EEPROM
+ * NOTE: Must be called in a main loop without any delays (has internal timer)
+ */
+void Settings::update(void) {
+    if (write_index < sizeof(SettingsRecord)) {
+        write_next_byte();
+        return;
+    }
+
+    if (dirty && hal.millis() - dirty_timer >= SETTINGS_COMMIT_DELAY)
+        commit();
+}
+
+/**
+ * @brief Starts writing data into the next slot immediately (unless nothing has changed since last commit)
+ */
+void Settings::commit(void) {
+    // Previous record is still being written. Try again later
+    if (write_index < sizeof(SettingsRecord)) {
+        mark_dirty();
+        return;
+    }
+    dirty = false;
+
+    // Nothing changed (ex. voltage was increased and then decreased back)
+    uint16_t crc = crc_16((const uint8_t *) &data, sizeof(SettingsData));
+    if (stored && crc == data_crc)
+        return;
+    data_crc = crc;
+
+    // Prepare snapshot and move to the next slot. Previous record stays valid until this one is fully written
+    pending.header.version = SETTINGS_VERSION;
+    pending.header.size = sizeof(SettingsData);
+    pending.header.sequence = ++sequence;
+    pending.data = data;
+    pending.crc = crc_16((const uint8_t *) &pending, sizeof(SettingsRecord) - sizeof(pending.crc));
+    slot = slot + 1U >= SETTINGS_SLOTS ? 0U : slot + 1U;
+    write_index = 0;
+}
+
+#ifdef CONFIG_OVERLAY
+/**
+ * @param id CONFIG_ID_...
+ * @param value compile-time value
+ * @return uint16_t overridden value or the compile-time one
+ */
+uint16_t Settings::config(uint8_t id, uint16_t value) { return data.overlay[id] ? data.overlay[id] : value; }
+#endif
+
+/**
+ * @brief Checks record's header and CRC
+ *
+ * @param slot index of the record (0 to SETTINGS_SLOTS - 1)
+ * @param header pointer to store record's header
+ * @return boolean true if record is valid
+ */
+boolean Settings::read_record(uint8_t slot, SettingsHeader *header) {
+    uint16_t address = slot_address(slot);
+    for (uint8_t i = 0; i < sizeof(SettingsHeader); ++i)
+        ((uint8_t *) header)[i] = hal.eeprom_read(address + i);
+
+    // Erased EEPROM (0xFF) or record from the newer firmware
+    if (header->version == 0 || header->version > SETTINGS_VERSION ||
+        sizeof(SettingsHeader) + header->size + sizeof(uint16_t) > SETTINGS_SLOT_SIZE)
+        return false;
+
+    // Calculate CRC of header and data and compare it with the stored one
+    uint16_t crc = crc_16((const uint8_t *) header, sizeof(SettingsHeader));
+    address += sizeof(SettingsHeader);
+    for (uint8_t i = 0; i < header->size; ++i)
+        crc = _crc16_update(crc, hal.eeprom_read(address++));
+    return crc == ((uint16_t) hal.eeprom_read(address) | ((uint16_t) hal.eeprom_read(address + 1U) << 8));
+}
+
+/**
+ * @brief Resets data to the default values
+ */
+void Settings::load_defaults(void) {
+    memset(&data, 0, sizeof(SettingsData));
+    data.voltage = ((uint16_t) CONVERTER_SETPOINT_MAX + (uint16_t) CONVERTER_SETPOINT_MIN) / 2;
+    data.heat_base = HEATING_BASE;
+    data.heat_converter = HEATING_CONVERTER;
+    data.heat_display = HEATING_DISPLAY;
+    data.heat_tau = HEATING_TIME_CONSTANT;
+}
+
+/**
+ * @brief Reads values from the old fixed-address layout
+ * (0-3: random seed, 4: voltage, 5: alarm hours, 6: alarm minutes, 7: inverted alarm state)
+ */
+void Settings::load_legacy(void) {
+    load_defaults();
+    data.seed = (uint32_t) hal.eeprom_read(0) | ((uint32_t) hal.eeprom_read(1) << 8) |
+                ((uint32_t) hal.eeprom_read(2) << 16) | ((uint32_t) hal.eeprom_read(3) << 24);
+    data.voltage = hal.eeprom_read(4);
+    data.alarm_hours = hal.eeprom_read(5);
+    data.alarm_minutes = hal.eeprom_read(6);
+    data.alarm_active = !hal.eeprom_read(7);
+}
+
+/**
+ * @brief Brings all values into their valid ranges
+ */
+void Settings::sanitize(void) {
+    if (data.voltage > CONVERTER_SETPOINT_MAX || data.voltage < CONVERTER_SETPOINT_MIN)
+        data.voltage = ((uint16_t) CONVERTER_SETPOINT_MAX + (uint16_t) CONVERTER_SETPOINT_MIN) / 2;
+    if (data.alarm_hours > 23)
+        data.alarm_hours = 0;
+    if (data.alarm_minutes > 59)
+        data.alarm_minutes = 0;
+    data.alarm_active = data.alarm_active ? true : false;
+    if (data.night_on > 23)
+        data.night_on = 0;
+    if (data.night_off > 23)
+        data.night_off = 0;
+    for (uint8_t i = 0; i < sizeof(data.tube_trim); ++i)
+        if (data.tube_trim[i] > TUBE_TRIM_MAX)
+            data.tube_trim[i] = TUBE_TRIM_MAX;
+    if (!data.heat_tau)
+        data.heat_tau = HEATING_TIME_CONSTANT;
+    if (data.dst > DST_RULES_N)
+        data.dst = 0;
+#ifdef CONFIG_OVERLAY
+    for (uint8_t i = 0; i < CONFIG_OVERLAY_NUM; ++i)
+        if (data.overlay[i] < pgm_read_word(&overlay_list[i].min) ||
+            data.overlay[i] > pgm_read_word(&overlay_list[i].max))
+            data.overlay[i] = 0;
+#endif
+}
+
+/**
+ * @brief Writes one byte of pending record if EEPROM is ready
+ * (Writing one byte takes ~3.3ms, so this prevents main loop from being blocked)
+ */
+void Settings::write_next_byte(void) {
+    if (!hal.eeprom_ready())
+        return;
+    hal.eeprom_update(slot_address(slot) + write_index, ((const uint8_t *) &pending)[write_index]);
+    write_index++;
+}
+
+/**
+ * @param slot index of the record (0 to SETTINGS_SLOTS - 1)
+ * @return uint16_t EEPROM address of the first byte of the record
+ */
+uint16_t Settings::slot_address(uint8_t slot) { return SETTINGS_EEPROM_START + slot * SETTINGS_SLOT_SIZE; }
+
+/**
+ * @brief Calculates CRC-16 (0xA001 polynomial) checksum
+ *
+ * @param data pointer to the data
+ * @param length size of data in bytes
+ * @param crc initial value
+ * @return uint16_t result
+ */
+uint16_t Settings::crc_16(const uint8_t *data, uint8_t length, uint16_t crc) {
+    while (length--)
+        crc = _crc16_update(crc, *data++);
+    return crc;
+}
@@ -0,0 +1,60 @@
+#!/usr/bin/env bash
+#
+# Builds native envs and runs simulation scripts (see native/sim.h for commands) against them
+#
+# Usage: sim/run.sh [script.sim ...]
+#   Runs all sim/*.sim scripts if no scripts are given
+#
+# Each script runs in the native env with blank EEPROM. Script that starts with "# env: <name>" line runs in that env
+# instead (ex. native_carousel for features that are disabled by default). Requires PlatformIO (pio) in PATH.
+# Exits with 1 if any script failed
+#
+# Copyright (c) 2024 Fern Lane
+#
+# This file is part of the in17clock distribution.
+# See <https://github.com/F33RNI/in17clock> for more info.
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU Affero General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU Affero General Public License for more details.
+#
+# You should have received a copy of the GNU Affero General Public License
+# long with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+set -euo pipefail
+
+SIM_DIR="$(cd "$(dirname "${BASH_SOURCE[0]}")" && pwd)"
+PROJECT_DIR="$(dirname "$SIM_DIR")"
+
+if (($# > 0)); then
+    scripts=("$@")
+else
+    scripts=("$SIM_DIR"/*.sim)
+fi
+
+declare -A built
+failed=0
+for script in "${scripts[@]}"; do
+    env="$(sed -n '1s/^# env: *//p' "$script")"
+    env="${env:-native}"
+    if [[ -z "${built[$env]:-}" ]]; then
+        pio run -d "$PROJECT_DIR" -e "$env"
+        built[$env]=1
+    fi
+
+    if output="$("$PROJECT_DIR/.pio/build/$env/program" -s "$script" 2>&1)"; then
+        echo "PASS $(basename "$script") ($env)"
+    else
+        echo "FAIL $(basename "$script") ($env)"
+        echo "$output"
+        failed=1
+    fi
+done
+
+exit $failed
@@ -24,7 +24,11 @@
 
 #include "include/temp_humid.h"
 
+#include "include/digits.h"
 #include "include/pins.h"
+#include "include/power.h"
+#include "include/recorder.h"
+#include "include/settings.h"
 
 // Preinstantiate
 TempHumid temp_humid;
@@ -33,22 +37,20 @@ TempHumid temp_humid;
  * @brief Initializes I2C bus (if not yet initialized) and initializes internal variables
  */
 void TempHumid::init(void) {
-    // Initialize IC2 and wait a bit
-#ifndef _WIRE_INITIALIZED
-#define _WIRE_INITIALIZED
-    Wire.begin();
-    delay(100UL);
-#endif
+    hal.twi_init();
 
     // Initialize sensor
-    Wire.beginTransmission(SHT_ADDRESS);
-    Wire.endTransmission();
+    hal.twi_write(SHT_ADDRESS, NULL, 0U);
 
     // For proper filter initialization
     temperature_last = INFINITY;
     temperature_filtered = INFINITY;
     humidity_last = INFINITY;
     humidity_filtered = INFINITY;
+
+    // Case is cold after power-on
+    heating = 0.f;
+    humidity_factor = 1.f;
 }
 
 /**
@@ -56,30 +58,44 @@ void TempHumid::init(void) {
  * NOTE: Must be called in a main loop without any delays (has internal timer)
  */
 void TempHumid::read(void) {
+    // Self-heating model runs even if the sensor doesn't respond
+    if (hal.millis() - heating_timer >= HEATING_UPDATE_INTERVAL) {
+        heating_timer += HEATING_UPDATE_INTERVAL;
+        update_heating();
+    }
+
     // Read only after a delay
-    if (millis() - read_timer < READ_INTERVAL)
+    if (hal.millis() - read_timer < READ_INTERVAL)
         return;
-    read_timer = millis();
+    read_timer = hal.millis();
 
     // Request data and check for transmission error
-    Wire.beginTransmission(SHT_ADDRESS);
-    Wire.write(READ_TEMP_HUMID_0);
-    Wire.write(READ_TEMP_HUMID_1);
-    if (Wire.endTransmission())
+    uint8_t buffer[6] = {READ_TEMP_HUMID_0, READ_TEMP_HUMID_1};
+    if (hal.twi_write(SHT_ADDRESS, buffer, 2U)) {
+        if (bus_errors != 0xFFFFU)
+            bus_errors++;
         return;
+    }
 
     // Request and read 6 bytes
-    Wire.requestFrom(SHT_ADDRESS, 6);
-    uint8_t temp_raw_0 = Wire.read();
-    uint8_t temp_raw_1 = Wire.read();
-    uint8_t temp_crc = Wire.read();
-    uint8_t humid_raw_0 = Wire.read();
-    uint8_t humid_raw_1 = Wire.read();
-    uint8_t humid_crc = Wire.read();
+    if (hal.twi_read(SHT_ADDRESS, buffer, 6U) != 6U) {
+        if (bus_errors != 0xFFFFU)
+            bus_errors++;
+        return;
+    }
+    uint8_t temp_raw_0 = buffer[0];
+    uint8_t temp_raw_1 = buffer[1];
+    uint8_t temp_crc = buffer[2];
+    uint8_t humid_raw_0 = buffer[3];
+    uint8_t humid_raw_1 = buffer[4];
+    uint8_t humid_crc = buffer[5];
 
     // Verify checksums
-    if (crc_8(temp_raw_0, temp_raw_1) != temp_crc || crc_8(humid_raw_0, humid_raw_1) != humid_crc)
+    if (crc_8(temp_raw_0, temp_raw_1) != temp_crc || crc_8(humid_raw_0, humid_raw_1) != humid_crc) {
+        if (crc_errors != 0xFFFFU)
+            crc_errors++;
         return;
+    }
 
     // Parse temperature
     int32_t temp_raw = (int32_t) (((uint32_t) temp_raw_0 << 8) | temp_raw_1);
@@ -111,17 +127,109 @@ void TempHumid::read(void) {
         humidity_filtered = humidity_filtered * TEMP_HUMID_FILTER_K + humidity * (1.f - TEMP_HUMID_FILTER_K) / 2.f +
                             humidity_last * (1.f - TEMP_HUMID_FILTER_K) / 2.f;
     humidity_last = humidity;
+
+    RECORD_SENSOR(temp_raw, (humid_raw + 50U) / 100U);
 }
 
 /**
- * @return float filtered temperature in degrees Celsius
+ * @return float filtered temperature in degrees Celsius compensated for self-heating (0 before the first measurement)
+ */
+float TempHumid::get_temperature(void) { return isinf(temperature_filtered) ? 0.f : temperature_filtered - heating; }
+
+/**
+ * @return float filtered humidity in % recalculated for the compensated temperature (0 before the first measurement)
  */
-float TempHumid::get_temperature(void) { return temperature_filtered == NAN ? 0.f : temperature_filtered; }
+float TempHumid::get_humidity(void) {
+    if (isinf(humidity_filtered))
+        return 0.f;
+    float humidity = humidity_filtered * humidity_factor;
+    return humidity > 100.f ? 100.f : humidity;
+}
 
 /**
- * @return float filtered humidity in %
+ * @return float last unfiltered temperature in degrees Celsius
  */
-float TempHumid::get_humidity(void) { return humidity_filtered == NAN ? 0.f : humidity_filtered; }
+float TempHumid::get_temperature_raw(void) { return temperature_last; }
+
+/**
+ * @return float last unfiltered humidity in %
+ */
+float TempHumid::get_humidity_raw(void) { return humidity_last; }
+
+/**
+ * @return uint16_t number of failed I2C transactions since startup
+ */
+uint16_t TempHumid::get_bus_errors(void) { return bus_errors; }
+
+/**
+ * @return uint16_t number of measurements with wrong checksum since startup
+ */
+uint16_t TempHumid::get_crc_errors(void) { return crc_errors; }
+
+/**
+ * @return float current excess temperature of the sensor caused by self-heating in degrees Celsius
+ */
+float TempHumid::get_heating(void) { return heating; }
+
+/**
+ * @return float excess temperature that current converter and display duties will heat the sensor up to (in degrees
+ * Celsius)
+ */
+float TempHumid::get_heating_target(void) {
+    return (settings.data.heat_base + settings.data.heat_converter * (power.get_duty_cycle() / 1024.f) +
+            settings.data.heat_display * (digits.get_load() / 255.f)) /
+           10.f;
+}
+
+/**
+ * @brief Scales heat_base, heat_conv and heat_disp settings so that compensated temperature matches the reference
+ * (keeping their ratios). If they are all 0, sets only heat_base. Settings are saved after SETTINGS_COMMIT_DELAY
+ *
+ * @param reference actual ambient temperature in degrees Celsius (ex. from the reference thermometer next to the clock)
+ * @return boolean false if there is no measurement yet or model has not settled (clock must work for a few
+ * heat_tau with the usual brightness)
+ */
+boolean TempHumid::calibrate_heating(float reference) {
+    if (temperature_filtered == INFINITY)
+        return false;
+    float excess = temperature_filtered - reference;
+    if (excess < 0.f)
+        excess = 0.f;
+
+    float target = get_heating_target();
+    if (target <= 0.f) {
+        settings.data.heat_base = excess * 10.f > 255.f ? 255U : (uint8_t) (excess * 10.f + .5f);
+    } else {
+        // Heating is far from its steady state -> scale will be overestimated
+        if (heating < target * HEATING_SETTLED)
+            return false;
+        float scale = excess / heating;
+        uint8_t *coefficients[3] = {&settings.data.heat_base, &settings.data.heat_converter,
+                                    &settings.data.heat_display};
+        for (uint8_t i = 0; i < 3U; ++i) {
+            float coefficient = *coefficients[i] * scale + .5f;
+            *coefficients[i] = coefficient > 255.f ? 255U : (uint8_t) coefficient;
+        }
+    }
+    heating = excess;
+    settings.mark_dirty();
+    return true;
+}
+
+/**
+ * @brief Moves excess temperature towards its steady state (first-order lag with heat_tau time constant) and
+ * calculates humidity correction. Sensor and ambient air have the same absolute humidity, so relative humidity scales
+ * with the ratio of saturation vapor pressures: exp(B * T / (C + T)) at the sensor and at the ambient temperatures
+ */
+void TempHumid::update_heating(void) {
+    heating += (get_heating_target() - heating) * (HEATING_UPDATE_INTERVAL / (settings.data.heat_tau * 60000.f));
+
+    if (temperature_filtered == INFINITY)
+        return;
+    float ambient = temperature_filtered - heating;
+    humidity_factor = expf(MAGNUS_B * MAGNUS_C * (temperature_filtered - ambient) /
+                           ((MAGNUS_C + temperature_filtered) * (MAGNUS_C + ambient)));
+}
 
 /**
  * @brief Calculates CRC checksum. Read "4.12 Checksum Calculation" section for more info
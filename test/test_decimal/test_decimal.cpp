@@ -0,0 +1,86 @@
+/**
+ * @file test_decimal.cpp
+ * @author Fern Lane
+ * @brief Checks reciprocal division and digits decomposition of decimal.h against host division (whole ranges)
+ *
+ * @copyright Copyright (c) 2024 Fern Lane
+ *
+ * This file is part of the in17clock distribution.
+ * See <https://github.com/F33RNI/in17clock> for more info.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * long with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <unity.h>
+
+#include "../../include/decimal.h"
+
+void setUp(void) {}
+
+void tearDown(void) {}
+
+static void test_div10(void) {
+    for (uint16_t value = 0; value <= 0xFFU; ++value)
+        TEST_ASSERT_EQUAL_UINT8(value / 10U, decimal_div10((uint8_t) value));
+}
+
+static void test_div10_16(void) {
+    for (uint32_t value = 0; value <= 0xFFFFUL; ++value)
+        TEST_ASSERT_EQUAL_UINT16(value / 10U, decimal_div10_16((uint16_t) value));
+}
+
+static void test_split(void) {
+    uint8_t digits[3];
+    for (uint16_t value = 0; value <= 0xFFU; ++value) {
+        decimal_split((uint8_t) value, digits);
+        TEST_ASSERT_EQUAL_UINT8(value / 100U, digits[0]);
+        TEST_ASSERT_EQUAL_UINT8(value / 10U % 10U, digits[1]);
+        TEST_ASSERT_EQUAL_UINT8(value % 10U, digits[2]);
+    }
+}
+
+static void test_split_16(void) {
+    uint8_t digits[5];
+    for (uint32_t value = 0; value <= 0xFFFFUL; ++value) {
+        decimal_split_16((uint16_t) value, digits);
+        uint32_t rest = value;
+        for (int8_t i = 4; i >= 0; --i) {
+            TEST_ASSERT_EQUAL_UINT8(rest % 10U, digits[i]);
+            rest /= 10U;
+        }
+    }
+}
+
+static void test_split_pair(void) {
+    uint8_t digits[4];
+    for (uint8_t left = 0; left < 100U; ++left) {
+        for (uint8_t right = 0; right < 100U; ++right) {
+            decimal_split_pair(left, right, digits);
+            TEST_ASSERT_EQUAL_UINT8(left / 10U, digits[0]);
+            TEST_ASSERT_EQUAL_UINT8(left % 10U, digits[1]);
+            TEST_ASSERT_EQUAL_UINT8(right / 10U, digits[2]);
+            TEST_ASSERT_EQUAL_UINT8(right % 10U, digits[3]);
+        }
+    }
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_div10);
+    RUN_TEST(test_div10_16);
+    RUN_TEST(test_split);
+    RUN_TEST(test_split_16);
+    RUN_TEST(test_split_pair);
+    return UNITY_END();
+}
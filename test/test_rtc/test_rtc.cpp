@@ -0,0 +1,149 @@
+/**
+ * @file test_rtc.cpp
+ * @author Fern Lane
+ * @brief Calendar math of RTC and DST conversion against the mocked DS3231
+ *
+ * @copyright Copyright (c) 2024 Fern Lane
+ *
+ * This file is part of the in17clock distribution.
+ * See <https://github.com/F33RNI/in17clock> for more info.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * long with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <unity.h>
+
+#include "../../include/rtc.h"
+
+#include "../../include/config.h"
+#include "../../include/pins.h"
+#include "../../include/settings.h"
+#include "../../native/mock.h"
+
+// EU, Central European Time (index of DST_RULES + 1)
+#define _RULE_EU_CET 2U
+
+void setUp(void) { settings.data.dst = _RULE_EU_CET; }
+
+void tearDown(void) {}
+
+/**
+ * @brief Sets DS3231 (standard time) and reads it. Rule is switched OFF and back ON to evaluate DST again, even if
+ * the standard hour is the same as in the previous read
+ */
+static void read_at(uint8_t hours, uint8_t minutes, uint8_t day, uint8_t month, uint8_t year) {
+    native_rtc_set(hours, minutes, 0, day, month, year);
+    uint8_t rule = settings.data.dst;
+    settings.data.dst = 0;
+    rtc.read();
+    settings.data.dst = rule;
+    rtc.read();
+}
+
+/**
+ * @return uint8_t hours register of DS3231 (standard time)
+ */
+static uint8_t standard_hours(void) {
+    uint8_t pointer = 0x02U, hours;
+    hal.twi_write(RTC_ADDRESS, &pointer, 1U);
+    hal.twi_read(RTC_ADDRESS, &hours, 1U);
+    return (hours >> 4) * 10U + (hours & 0x0FU);
+}
+
+static void test_days_in_month(void) {
+    const uint8_t days[12] = {31U, 28U, 31U, 30U, 31U, 30U, 31U, 31U, 30U, 31U, 30U, 31U};
+    for (uint8_t month = 1U; month <= 12U; ++month)
+        TEST_ASSERT_EQUAL_UINT8(days[month - 1U], RTC::days_in_month(month, 25U));
+    TEST_ASSERT_EQUAL_UINT8(29U, RTC::days_in_month(2U, 0));
+    TEST_ASSERT_EQUAL_UINT8(29U, RTC::days_in_month(2U, 24U));
+    TEST_ASSERT_EQUAL_UINT8(28U, RTC::days_in_month(2U, 99U));
+}
+
+static void test_day_of_week(void) {
+    TEST_ASSERT_EQUAL_UINT8(6U, RTC::day_of_week(1U, 1U, 0));
+    TEST_ASSERT_EQUAL_UINT8(4U, RTC::day_of_week(29U, 2U, 24U));
+    TEST_ASSERT_EQUAL_UINT8(6U, RTC::day_of_week(1U, 3U, 25U));
+    TEST_ASSERT_EQUAL_UINT8(6U, RTC::day_of_week(17U, 10U, 26U));
+    TEST_ASSERT_EQUAL_UINT8(4U, RTC::day_of_week(31U, 12U, 99U));
+}
+
+static void test_no_rule(void) {
+    settings.data.dst = 0;
+    read_at(12U, 0, 15U, 7U, 26U);
+    TEST_ASSERT_EQUAL_UINT8(12U, rtc.get_hours());
+    TEST_ASSERT_FALSE(rtc.is_dst());
+}
+
+static void test_spring_forward(void) {
+    // Last Sunday of March 2026 is the 29th. 02:00 standard time is 03:00 DST
+    read_at(1U, 59U, 29U, 3U, 26U);
+    TEST_ASSERT_EQUAL_UINT8(1U, rtc.get_hours());
+    TEST_ASSERT_FALSE(rtc.is_dst());
+    read_at(2U, 0, 29U, 3U, 26U);
+    TEST_ASSERT_EQUAL_UINT8(3U, rtc.get_hours());
+    TEST_ASSERT_TRUE(rtc.is_dst());
+    TEST_ASSERT_EQUAL_UINT8(2U, rtc.get_skipped_hour());
+}
+
+static void test_fall_back(void) {
+    // Last Sunday of October 2026 is the 25th. 02:00-02:59 is shown twice (DST and then standard time)
+    read_at(1U, 30U, 25U, 10U, 26U);
+    TEST_ASSERT_EQUAL_UINT8(2U, rtc.get_hours());
+    TEST_ASSERT_TRUE(rtc.is_dst());
+    TEST_ASSERT_FALSE(rtc.is_repeated_hour());
+    read_at(2U, 30U, 25U, 10U, 26U);
+    TEST_ASSERT_EQUAL_UINT8(2U, rtc.get_hours());
+    TEST_ASSERT_FALSE(rtc.is_dst());
+    TEST_ASSERT_TRUE(rtc.is_repeated_hour());
+    read_at(3U, 0, 25U, 10U, 26U);
+    TEST_ASSERT_EQUAL_UINT8(3U, rtc.get_hours());
+    TEST_ASSERT_FALSE(rtc.is_repeated_hour());
+}
+
+static void test_dst_moves_date(void) {
+    // 23:30 standard time on the last day of June is 00:30 on the 1st of July
+    read_at(23U, 30U, 30U, 6U, 26U);
+    TEST_ASSERT_EQUAL_UINT8(0, rtc.get_hours());
+    TEST_ASSERT_EQUAL_UINT8(1U, rtc.get_day());
+    TEST_ASSERT_EQUAL_UINT8(7U, rtc.get_month());
+}
+
+static void test_set_in_dst(void) {
+    // Local time is written as standard time
+    read_at(9U, 0, 15U, 7U, 26U);
+    rtc.set(12U, 0, 0);
+    TEST_ASSERT_EQUAL_UINT8(11U, standard_hours());
+    rtc.read();
+    TEST_ASSERT_EQUAL_UINT8(12U, rtc.get_hours());
+    TEST_ASSERT_EQUAL_UINT8(15U, rtc.get_day());
+
+    // Midnight in summer is the previous day in standard time
+    rtc.set(0, 30U, 0);
+    TEST_ASSERT_EQUAL_UINT8(23U, standard_hours());
+    rtc.read();
+    TEST_ASSERT_EQUAL_UINT8(0, rtc.get_hours());
+    TEST_ASSERT_EQUAL_UINT8(15U, rtc.get_day());
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_days_in_month);
+    RUN_TEST(test_day_of_week);
+    RUN_TEST(test_no_rule);
+    RUN_TEST(test_spring_forward);
+    RUN_TEST(test_fall_back);
+    RUN_TEST(test_dst_moves_date);
+    RUN_TEST(test_set_in_dst);
+    return UNITY_END();
+}
@@ -0,0 +1,206 @@
+/**
+ * @file test_settings.cpp
+ * @author Fern Lane
+ * @brief Settings store against the mocked EEPROM: CRC check, slot rotation and loading of older records
+ *
+ * @copyright Copyright (c) 2024 Fern Lane
+ *
+ * This file is part of the in17clock distribution.
+ * See <https://github.com/F33RNI/in17clock> for more info.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * long with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stddef.h>
+#include <string.h>
+
+#include <unity.h>
+
+#include "../../include/settings.h"
+
+#include "../../include/config.h"
+
+/**
+ * @brief Erases mocked EEPROM and loads settings from it
+ */
+void setUp(void) {
+    for (uint16_t address = 0; address <= E2END; ++address)
+        hal.eeprom_update(address, 0xFFU);
+    settings.init();
+}
+
+void tearDown(void) {}
+
+/**
+ * @brief Commits settings and writes the whole record (EEPROM is always ready in the mock)
+ */
+static void commit(void) {
+    settings.commit();
+    for (uint8_t i = 0; i < sizeof(SettingsRecord); ++i)
+        settings.update();
+}
+
+static uint16_t slot_address(uint8_t slot) { return SETTINGS_EEPROM_START + slot * SETTINGS_SLOT_SIZE; }
+
+static uint16_t slot_sequence(uint8_t slot) {
+    uint16_t address = slot_address(slot) + offsetof(SettingsHeader, sequence);
+    return (uint16_t) hal.eeprom_read(address) | ((uint16_t) hal.eeprom_read(address + 1U) << 8);
+}
+
+/**
+ * @brief Writes record with any header and data size and valid CRC
+ */
+static void write_record(uint8_t slot, uint8_t version, uint8_t size, uint16_t sequence, const SettingsData *data) {
+    SettingsHeader header = {version, size, sequence};
+    uint16_t address = slot_address(slot), crc = 0xFFFFU;
+    for (uint8_t i = 0; i < sizeof(SettingsHeader); ++i) {
+        crc = _crc16_update(crc, ((const uint8_t *) &header)[i]);
+        hal.eeprom_update(address++, ((const uint8_t *) &header)[i]);
+    }
+    for (uint8_t i = 0; i < size; ++i) {
+        crc = _crc16_update(crc, ((const uint8_t *) data)[i]);
+        hal.eeprom_update(address++, ((const uint8_t *) data)[i]);
+    }
+    hal.eeprom_update(address++, crc & 0xFFU);
+    hal.eeprom_update(address, crc >> 8);
+}
+
+static void test_blank_eeprom_loads_defaults(void) {
+    TEST_ASSERT_EQUAL_UINT8(((uint16_t) CONVERTER_SETPOINT_MAX + CONVERTER_SETPOINT_MIN) / 2U, settings.data.voltage);
+    TEST_ASSERT_EQUAL_UINT8(HEATING_TIME_CONSTANT, settings.data.heat_tau);
+    TEST_ASSERT_EQUAL_UINT8(0, settings.data.dst);
+}
+
+static void test_commit_and_load(void) {
+    settings.data.alarm_hours = 7U;
+    settings.data.alarm_minutes = 30U;
+    settings.data.dst = 2U;
+    commit();
+    TEST_ASSERT_EQUAL_UINT8(SETTINGS_VERSION, hal.eeprom_read(slot_address(0)));
+
+    memset(&settings.data, 0, sizeof(SettingsData));
+    settings.init();
+    TEST_ASSERT_EQUAL_UINT8(7U, settings.data.alarm_hours);
+    TEST_ASSERT_EQUAL_UINT8(30U, settings.data.alarm_minutes);
+    TEST_ASSERT_EQUAL_UINT8(2U, settings.data.dst);
+}
+
+static void test_unchanged_data_is_not_written(void) {
+    commit();
+    settings.init();
+    commit();
+    TEST_ASSERT_EQUAL_UINT16(1U, slot_sequence(0));
+    TEST_ASSERT_EQUAL_UINT8(0xFFU, hal.eeprom_read(slot_address(1)));
+}
+
+static void test_slot_rotation(void) {
+    // Each commit goes into the next slot and wraps around after the last one
+    for (uint8_t i = 0; i < SETTINGS_SLOTS + 2U; ++i) {
+        settings.data.alarm_minutes = i;
+        commit();
+        TEST_ASSERT_EQUAL_UINT16(i + 1U, slot_sequence(i % SETTINGS_SLOTS));
+    }
+
+    // The newest record is loaded (not the one in the last slot)
+    settings.init();
+    TEST_ASSERT_EQUAL_UINT8(SETTINGS_SLOTS + 1U, settings.data.alarm_minutes);
+    settings.data.alarm_minutes = 59U;
+    commit();
+    TEST_ASSERT_EQUAL_UINT16(SETTINGS_SLOTS + 3U, slot_sequence(2));
+}
+
+static void test_sequence_wrap_around(void) {
+    SettingsData data = settings.data;
+    data.alarm_minutes = 1U;
+    write_record(0, SETTINGS_VERSION, sizeof(SettingsData), 0xFFFFU, &data);
+    data.alarm_minutes = 2U;
+    write_record(1, SETTINGS_VERSION, sizeof(SettingsData), 0, &data);
+    settings.init();
+    TEST_ASSERT_EQUAL_UINT8(2U, settings.data.alarm_minutes);
+}
+
+static void test_crc_error_falls_back_to_previous_record(void) {
+    settings.data.alarm_minutes = 10U;
+    commit();
+    settings.data.alarm_minutes = 20U;
+    commit();
+
+    // Flip one bit of the newest record
+    uint16_t address = slot_address(1) + sizeof(SettingsHeader) + offsetof(SettingsData, alarm_minutes);
+    hal.eeprom_update(address, hal.eeprom_read(address) ^ 0x01U);
+    settings.init();
+    TEST_ASSERT_EQUAL_UINT8(10U, settings.data.alarm_minutes);
+
+    // Next commit doesn't overwrite the previous valid record
+    commit();
+    TEST_ASSERT_EQUAL_UINT16(1U, slot_sequence(0));
+    TEST_ASSERT_EQUAL_UINT16(2U, slot_sequence(1));
+}
+
+static void test_migration_from_version_7(void) {
+    // Version 7 record ends before dst, byte after it must not be loaded
+    SettingsData data = settings.data;
+    data.alarm_hours = 6U;
+    data.heat_base = 42U;
+    data.dst = 3U;
+    write_record(3, 7U, offsetof(SettingsData, dst) + 1U, 5U, &data);
+    settings.init();
+    TEST_ASSERT_EQUAL_UINT8(6U, settings.data.alarm_hours);
+    TEST_ASSERT_EQUAL_UINT8(42U, settings.data.heat_base);
+    TEST_ASSERT_EQUAL_UINT8(0, settings.data.dst);
+
+    // Older record is rewritten in the current format into the next slot
+    commit();
+    TEST_ASSERT_EQUAL_UINT8(SETTINGS_VERSION, hal.eeprom_read(slot_address(4)));
+    TEST_ASSERT_EQUAL_UINT16(6U, slot_sequence(4));
+    settings.init();
+    TEST_ASSERT_EQUAL_UINT8(6U, settings.data.alarm_hours);
+}
+
+static void test_record_from_newer_firmware_is_skipped(void) {
+    SettingsData data = settings.data;
+    data.alarm_hours = 9U;
+    write_record(0, SETTINGS_VERSION, sizeof(SettingsData), 1U, &data);
+    data.alarm_hours = 10U;
+    write_record(1, SETTINGS_VERSION + 1U, sizeof(SettingsData), 2U, &data);
+    settings.init();
+    TEST_ASSERT_EQUAL_UINT8(9U, settings.data.alarm_hours);
+}
+
+static void test_legacy_layout(void) {
+    // 0-3: seed, 4: voltage, 5: alarm hours, 6: alarm minutes, 7: inverted alarm state
+    const uint8_t legacy[8] = {0x78U, 0x56U, 0x34U, 0x12U, CONVERTER_SETPOINT_MIN + 1U, 23U, 45U, 0};
+    for (uint8_t i = 0; i < sizeof(legacy); ++i)
+        hal.eeprom_update(i, legacy[i]);
+    settings.init();
+    TEST_ASSERT_EQUAL_UINT32(0x12345678UL, settings.data.seed);
+    TEST_ASSERT_EQUAL_UINT8(CONVERTER_SETPOINT_MIN + 1U, settings.data.voltage);
+    TEST_ASSERT_EQUAL_UINT8(23U, settings.data.alarm_hours);
+    TEST_ASSERT_EQUAL_UINT8(45U, settings.data.alarm_minutes);
+    TEST_ASSERT_TRUE(settings.data.alarm_active);
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_blank_eeprom_loads_defaults);
+    RUN_TEST(test_commit_and_load);
+    RUN_TEST(test_unchanged_data_is_not_written);
+    RUN_TEST(test_slot_rotation);
+    RUN_TEST(test_sequence_wrap_around);
+    RUN_TEST(test_crc_error_falls_back_to_previous_record);
+    RUN_TEST(test_migration_from_version_7);
+    RUN_TEST(test_record_from_newer_firmware_is_skipped);
+    RUN_TEST(test_legacy_layout);
+    return UNITY_END();
+}
@@ -0,0 +1,118 @@
+/**
+ * @file tube_hours.cpp
+ * @author Fern Lane
+ * @brief Lit time of each tube (from multiplexing slots), end of life report and aging compensation
+ *
+ * @copyright Copyright (c) 2024 Fern Lane
+ *
+ * This file is part of the in17clock distribution.
+ * See <https://github.com/F33RNI/in17clock> for more info.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * long with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "include/tube_hours.h"
+
+#include "include/digits.h"
+#include "include/power.h"
+#include "include/settings.h"
+
+static_assert(sizeof(SettingsData::tube_lit) / sizeof(uint32_t) == DIGITS_NUM, "SettingsData::tube_lit size mismatch");
+static_assert(TUBE_HOURS_SAMPLE_INTERVAL * HAL_MULTIPLEX_FREQUENCY / 1000.f / DIGITS_NUM < 65536.f,
+              "TUBE_HOURS_SAMPLE_INTERVAL is too long for 16-bit slot counters");
+
+// Fractions of the second per 1 lit second (slots at full brightness are counted as 256)
+#define _FRACTIONS_PER_SECOND ((uint32_t) (HAL_MULTIPLEX_FREQUENCY * 256.f))
+
+// Preinstantiate
+TubeHours tube_hours;
+
+/**
+ * @brief Accumulates lit time every TUBE_HOURS_SAMPLE_INTERVAL and schedules saving it every TUBE_HOURS_SAVE_INTERVAL
+ * NOTE: Must be called in a main loop without any delays (has internal timer)
+ */
+void TubeHours::update(void) {
+    uint32_t millis_current = hal.millis();
+    if (millis_current - sample_timer < TUBE_HOURS_SAMPLE_INTERVAL)
+        return;
+    sample_timer = millis_current;
+
+    // Slot is ON for (on time + 1) / 256 of its time (255 - whole slot)
+    for (uint8_t tube = 0; tube < DIGITS_NUM; ++tube) {
+        fractions[tube] += (uint32_t) digits.take_lit_slots(tube) * (digits.get_on_time(tube) + 1U);
+        while (fractions[tube] >= _FRACTIONS_PER_SECOND) {
+            fractions[tube] -= _FRACTIONS_PER_SECOND;
+            settings.data.tube_lit[tube]++;
+        }
+    }
+
+#ifdef TUBE_HOURS_COMPENSATION
+    power.set_compensation(get_compensation());
+#endif
+
+    if (millis_current - save_timer >= TUBE_HOURS_SAVE_INTERVAL) {
+        save_timer = millis_current;
+        settings.mark_dirty();
+    }
+}
+
+/**
+ * @param tube 0 to DIGITS_NUM - 1
+ * @return uint16_t lit time of the tube in 0.1 hours
+ */
+uint16_t TubeHours::get_hours_10(uint8_t tube) {
+    uint32_t hours_10 = settings.data.tube_lit[tube] / 360UL;
+    return hours_10 > 0xFFFFUL ? 0xFFFFU : hours_10;
+}
+
+/**
+ * @param tube 0 to DIGITS_NUM - 1
+ * @return uint8_t lit time of the tube in % of TUBE_HOURS_LIFETIME (up to 255)
+ */
+uint8_t TubeHours::get_wear(uint8_t tube) {
+    uint32_t wear = settings.data.tube_lit[tube] / (TUBE_HOURS_LIFETIME * 36UL);
+    return wear > 255UL ? 255U : wear;
+}
+
+/**
+ * @param tube 0 to DIGITS_NUM - 1
+ * @return boolean true if the tube reached TUBE_HOURS_WORN_PERCENT of its lifetime
+ */
+boolean TubeHours::is_worn(uint8_t tube) { return get_wear(tube) >= TUBE_HOURS_WORN_PERCENT; }
+
+/**
+ * @return uint8_t voltage that is added to the converter setpoint in Volts (0 if TUBE_HOURS_COMPENSATION is disabled)
+ */
+uint8_t TubeHours::get_compensation(void) {
+#ifdef TUBE_HOURS_COMPENSATION
+    uint32_t average = 0;
+    for (uint8_t tube = 0; tube < DIGITS_NUM; ++tube)
+        average += settings.data.tube_lit[tube] / DIGITS_NUM;
+    uint32_t volts = average / (TUBE_HOURS_COMPENSATION_HOURS * 3600UL) * TUBE_HOURS_COMPENSATION_STEP;
+    return volts > TUBE_HOURS_COMPENSATION_MAX ? TUBE_HOURS_COMPENSATION_MAX : volts;
+#else
+    return 0;
+#endif
+}
+
+/**
+ * @brief Resets lit time of the tube (ex. after replacing it) and schedules saving it
+ *
+ * @param tube 0 to DIGITS_NUM - 1
+ */
+void TubeHours::reset(uint8_t tube) {
+    settings.data.tube_lit[tube] = 0;
+    fractions[tube] = 0;
+    settings.mark_dirty();
+}
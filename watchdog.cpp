@@ -0,0 +1,138 @@
+/**
+ * @file watchdog.cpp
+ * @author Fern Lane
+ * @brief Hardware watchdog supervisor with per-task heartbeats
+ *
+ * @copyright Copyright (c) 2024 Fern Lane
+ *
+ * This file is part of the in17clock distribution.
+ * See <https://github.com/F33RNI/in17clock> for more info.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * long with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "include/watchdog.h"
+
+#include "include/config.h"
+
+#include "include/power.h"
+#include "include/settings.h"
+
+// Preinstantiate
+Watchdog watchdog;
+
+// Survive reset (not cleared by startup code)
+uint8_t missing_tasks __attribute__((section(".noinit")));
+uint8_t missing_tasks_magic __attribute__((section(".noinit")));
+
+/**
+ * @brief Records reset cause into settings (if it's a fault or differs from the stored one) and enables watchdog
+ * Call this at the end of setup() (after settings are loaded)
+ */
+void Watchdog::init(void) {
+    // Save only faults (or a new cause), so normal power-ups don't write EEPROM
+    uint8_t cause = hal.reset_cause();
+    if ((cause & (HAL_RESET_WATCHDOG | HAL_RESET_BROWN_OUT)) || cause != settings.data.reset_cause) {
+        settings.data.reset_cause = cause;
+        if (cause & HAL_RESET_WATCHDOG) {
+            if (settings.data.watchdog_resets != 0xFFU)
+                settings.data.watchdog_resets++;
+            settings.data.watchdog_tasks = missing_tasks_magic == _WATCHDOG_MAGIC ? missing_tasks : 0U;
+        }
+        settings.mark_dirty();
+    }
+    missing_tasks_magic = 0;
+
+#ifdef CONSOLE
+    report(CONSOLE_SERIAL);
+#endif
+
+#ifdef WATCHDOG
+    // Reset and enable interrupt (first timeout) and system reset (next timeout) modes
+    tasks = 0;
+    hal.watchdog_enable(WATCHDOG_TIMEOUT, _isr);
+#endif
+}
+
+/**
+ * @brief Marks task as alive. Call this from the main loop
+ *
+ * @param task WATCHDOG_TASK_...
+ */
+void Watchdog::check_in(uint8_t task) {
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) { tasks |= task; }
+}
+
+/**
+ * @brief Marks task as alive. Call this from interrupts
+ *
+ * @param task WATCHDOG_TASK_...
+ */
+void Watchdog::check_in_isr(uint8_t task) { tasks |= task; }
+
+/**
+ * @brief Resets watchdog timer only if all tasks checked in since the previous reset
+ * NOTE: Must be called in a main loop
+ */
+void Watchdog::supervise(void) {
+#ifdef WATCHDOG
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        if (tasks == WATCHDOG_TASKS_ALL) {
+            hal.watchdog_reset();
+            tasks = 0;
+        }
+    }
+#endif
+}
+
+/**
+ * @brief Prints cause of the last reset, number of watchdog resets and tasks that didn't check in before the last one
+ *
+ * @param output where to print (ex. Serial)
+ */
+void Watchdog::report(Print &output) {
+    uint8_t cause = settings.data.reset_cause;
+    output.print(F("reset="));
+    if (cause & HAL_RESET_POWER)
+        output.print(F("power "));
+    if (cause & HAL_RESET_EXTERNAL)
+        output.print(F("external "));
+    if (cause & HAL_RESET_BROWN_OUT)
+        output.print(F("brown-out "));
+    if (cause & HAL_RESET_WATCHDOG)
+        output.print(F("watchdog "));
+    output.print(F("wdt="));
+    output.print(settings.data.watchdog_resets);
+
+    uint8_t tasks_missing = settings.data.watchdog_tasks;
+    if (tasks_missing)
+        output.print(F(" missing="));
+    if (tasks_missing & WATCHDOG_TASK_POWER)
+        output.print(F("power "));
+    if (tasks_missing & WATCHDOG_TASK_DISPLAY)
+        output.print(F("display "));
+    if (tasks_missing & WATCHDOG_TASK_RTC)
+        output.print(F("rtc"));
+    output.println();
+}
+
+/**
+ * @brief Called on the first watchdog timeout. Turns converter OFF, saves missing tasks and resets immediately
+ */
+void Watchdog::_isr(void) {
+    power.stop();
+    missing_tasks = ~watchdog.tasks & WATCHDOG_TASKS_ALL;
+    missing_tasks_magic = _WATCHDOG_MAGIC;
+    hal.watchdog_restart();
+}